@@ -68,12 +68,35 @@ namespace ngsbem
     typedef Base_FMM_Operator<typename KERNEL::value_type> BASE;
     using BASE::xpts, BASE::ypts, BASE::xnv, BASE::ynv, BASE::cx, BASE::cy, BASE::rx, BASE::ry;
     using BASE::fmm_params;
+
+    // the trees and translation plans depend only on the points,
+    // they are built once and reused with new coefficients by every Mult
+    typedef decltype(declval<KERNEL>().CreateMultipoleExpansion(Vec<3>(), 0.0, FMM_Parameters())) T_SingMP;
+    typedef decltype(declval<KERNEL>().CreateLocalExpansion(Vec<3>(), 0.0, FMM_Parameters())) T_RegMP;
+    mutable T_SingMP singmp, singmp_trans;
+    mutable T_RegMP regmp, regmp_trans;
+    mutable mutex mult_mutex;
   public:
     FMM_Operator(KERNEL _kernel, Array<Vec<3>> _xpts, Array<Vec<3>> _ypts,
                  Array<Vec<3>> _xnv, Array<Vec<3>> _ynv, const FMM_Parameters & fmm_params)
       : BASE(std::move(_xpts), std::move( _ypts), std::move(_xnv), std::move(_ynv), KERNEL::Shape(), fmm_params),
       kernel(_kernel)
     {
+      static Timer tsetup("ngbem fmm setup "+KERNEL::Name()); RegionTimer reg(tsetup);
+
+      // record the translations with zero sources
+      Vector<typename KERNEL::value_type> zero(KERNEL::Shape()[1]);
+      zero = 0.0;
+      singmp = kernel.CreateMultipoleExpansion (cx, rx, fmm_params);
+      ParallelFor (xpts.Size(), [&](int i){
+        kernel.AddSource(*singmp, xpts[i], xnv[i], zero);
+      });
+      singmp->CalcMP();
+      regmp = kernel.CreateLocalExpansion (cy, ry, fmm_params);
+      ParallelFor (ypts.Size(), [&](int i){
+        regmp->AddTarget(ypts[i]);
+      });
+      regmp->CalcMP(singmp);
 
       /*
       // build matrix block for testing
@@ -121,19 +144,13 @@ namespace ngsbem
       auto matx = x.FV<typename KERNEL::value_type>().AsMatrix(xpts.Size(), shape[1]);
       auto maty = y.FV<typename KERNEL::value_type>().AsMatrix(ypts.Size(), shape[0]);      
       
+      lock_guard<mutex> guard(mult_mutex);
       maty = 0;
-      auto singmp = kernel.CreateMultipoleExpansion (cx, rx, fmm_params);
+      singmp->ResetSources();
       ParallelFor (xpts.Size(), [&](int i){
         kernel.AddSource(*singmp, xpts[i], xnv[i], matx.Row(i));
       });
       singmp->CalcMP();
-      static Timer taddlocal("ngbem fmm add local");
-      taddlocal.Start();
-      auto regmp = kernel.CreateLocalExpansion (cy, ry, fmm_params);
-      ParallelFor (ypts.Size(), [&](int i){
-        regmp->AddTarget(ypts[i]);
-      });
-      taddlocal.Stop();
       regmp->CalcMP(singmp);
 
       static Timer teval("ngbem fmm apply "+KERNEL::Name() + " eval"); 
@@ -152,19 +169,35 @@ namespace ngsbem
         auto matx = x.FV<typename KERNEL::value_type>().AsMatrix(xpts.Size(), shape[0]);
         auto maty = y.FV<typename KERNEL::value_type>().AsMatrix(ypts.Size(), shape[1]);
 
+        lock_guard<mutex> guard(mult_mutex);
         maty = 0;
-        auto singmp = kernel.CreateMultipoleExpansion (cy, ry, fmm_params);
-        ParallelFor (ypts.Size(), [&](int i){
-          kernel.AddSourceTrans(*singmp, ypts[i], ynv[i], matx.Row(i));
-        });
-        singmp->CalcMP();
-        auto regmp = kernel.CreateLocalExpansion (cx, rx, fmm_params);
-        ParallelFor (xpts.Size(), [&](int i){
-          regmp->AddTarget(xpts[i]);
-        });
-        regmp->CalcMP(singmp);
+        if (singmp_trans)
+          {
+            singmp_trans->ResetSources();
+            ParallelFor (ypts.Size(), [&](int i){
+              kernel.AddSourceTrans(*singmp_trans, ypts[i], ynv[i], matx.Row(i));
+            });
+            singmp_trans->CalcMP();
+            regmp_trans->CalcMP(singmp_trans);
+          }
+        else
+          {
+            // built at the first call, not all kernels provide the transpose
+            auto smp = kernel.CreateMultipoleExpansion (cy, ry, fmm_params);
+            ParallelFor (ypts.Size(), [&](int i){
+              kernel.AddSourceTrans(*smp, ypts[i], ynv[i], matx.Row(i));
+            });
+            smp->CalcMP();
+            auto rmp = kernel.CreateLocalExpansion (cx, rx, fmm_params);
+            ParallelFor (xpts.Size(), [&](int i){
+              rmp->AddTarget(xpts[i]);
+            });
+            rmp->CalcMP(smp);
+            singmp_trans = smp;
+            regmp_trans = rmp;
+          }
         ParallelFor (xpts.Size(), [&](int i) {
-          kernel.EvaluateMPTrans(*regmp, xpts[i], xnv[i], maty.Row(i));
+          kernel.EvaluateMPTrans(*regmp_trans, xpts[i], xnv[i], maty.Row(i));
         });
     }
 
@@ -175,6 +208,422 @@ namespace ngsbem
     
   };
 
+
+
+#ifdef PARALLEL
+
+  /*
+    FMM for points distributed over the processes of a communicator.
+    Every process holds its own sources and targets, Mult computes the
+    field at the local targets caused by the sources on all processes.
+
+    The bounding box is divided into cells, every process tells the others
+    which cells contain its targets. For the targets of another process,
+    subtrees of the local singular tree well separated from all its cells
+    are sent as multipole expansions, the sources of the remaining leaves
+    are sent directly. So only the neighbourhood of the process boundary
+    is exchanged in detail.
+  */
+  template <typename KERNEL>
+  class Distributed_FMM_Operator : public Base_FMM_Operator<typename KERNEL::value_type>
+  {
+    typedef typename KERNEL::value_type value_type;
+    typedef Base_FMM_Operator<value_type> BASE;
+    using BASE::xpts, BASE::ypts, BASE::xnv, BASE::ynv;
+    using BASE::fmm_params;
+
+    typedef decltype(declval<KERNEL>().CreateMultipoleExpansion(Vec<3>(), 0.0, FMM_Parameters())) T_SingMP;
+    typedef decltype(declval<KERNEL>().CreateLocalExpansion(Vec<3>(), 0.0, FMM_Parameters())) T_RegMP;
+    typedef typename T_SingMP::element_type::T_Node T_Node;
+
+    // trees and communication pattern for one direction
+    struct Plan
+    {
+      T_SingMP singmp;                    // local sources, with the remote expansions
+      T_SingMP ghostmp;                   // sources of other processes taken directly
+      T_RegMP regmp;
+      Table<int> send_sources;            // local sources sent to process p
+      Table<const T_Node*> send_nodes;    // local multipoles sent to process p
+      Table<int> recv_sources;            // ghost sources received from process p
+      Table<T_Node*> recv_nodes;          // remote multipoles received from process p
+      Array<Vec<3>> ghost_pts, ghost_nv;
+    };
+
+    KERNEL kernel;
+    NgMPI_Comm comm;
+    mutable unique_ptr<Plan> plan, plan_trans;
+    mutable mutex mult_mutex;
+
+  public:
+    Distributed_FMM_Operator(KERNEL _kernel, Array<Vec<3>> _xpts, Array<Vec<3>> _ypts,
+                             Array<Vec<3>> _xnv, Array<Vec<3>> _ynv, const FMM_Parameters & fmm_params,
+                             NgMPI_Comm _comm)
+      : BASE(std::move(_xpts), std::move( _ypts), std::move(_xnv), std::move(_ynv), KERNEL::Shape(), fmm_params),
+      kernel(_kernel), comm(_comm)
+    {
+      static Timer tsetup("ngbem distributed fmm setup "+KERNEL::Name()); RegionTimer reg(tsetup);
+      plan = CreatePlan (xpts, xnv, ypts, false);
+    }
+
+    void Mult(const BaseVector & x, BaseVector & y) const override
+    {
+      static Timer tall("ngbem distributed fmm apply "+KERNEL::Name()); RegionTimer reg(tall);
+      auto shape = KERNEL::Shape();
+      auto matx = x.FV<value_type>().AsMatrix(xpts.Size(), shape[1]);
+      auto maty = y.FV<value_type>().AsMatrix(ypts.Size(), shape[0]);
+
+      lock_guard<mutex> guard(mult_mutex);
+      Apply (*plan, xpts, xnv, matx, ypts, ynv, maty, false);
+    }
+
+    void MultTrans(const BaseVector & x, BaseVector & y) const override
+    {
+      static Timer tall("ngbem distributed fmm apply Trans "+KERNEL::Name()); RegionTimer reg(tall);
+      auto shape = KERNEL::Shape();
+      auto matx = x.FV<value_type>().AsMatrix(ypts.Size(), shape[0]);
+      auto maty = y.FV<value_type>().AsMatrix(xpts.Size(), shape[1]);
+
+      lock_guard<mutex> guard(mult_mutex);
+      // collective, all processes call MultTrans the first time together
+      if (!plan_trans)
+        plan_trans = CreatePlan (ypts, ynv, xpts, true);
+      Apply (*plan_trans, ypts, ynv, matx, xpts, xnv, maty, true);
+    }
+
+    BaseMatrix::OperatorInfo GetOperatorInfo () const override
+    {
+      return { string("Distributed_FMM_Operator ")+KERNEL::Name(), this->Height(), this->Width() };
+    }
+
+  private:
+    template <typename TMP>
+    void AddSource (TMP & mp, Vec<3> x, Vec<3> nv, FlatVector<value_type> val, bool trans) const
+    {
+      if (trans)
+        kernel.AddSourceTrans(mp, x, nv, val);
+      else
+        kernel.AddSource(mp, x, nv, val);
+    }
+
+    static tuple<Vec<3>, double> CenterAndRadius (const Array<Vec<3>> & pts)
+    {
+      if (pts.Size() == 0) return { Vec<3>(0.0), 1.0 };
+      return GetCenterAndRadius(pts);
+    }
+
+    unique_ptr<Plan> CreatePlan (const Array<Vec<3>> & spts, const Array<Vec<3>> & snv,
+                                 const Array<Vec<3>> & tpts, bool trans) const
+    {
+      static Timer t("ngbem distributed fmm plan "+KERNEL::Name()); RegionTimer reg(t);
+      int ntasks = comm.Size();
+      int rank = comm.Rank();
+      auto newplan = make_unique<Plan>();
+
+      int ncomp = trans ? KERNEL::Shape()[0] : KERNEL::Shape()[1];
+      Vector<value_type> zero(ncomp);
+      zero = 0.0;
+
+      // common grid of cells
+      Vec<3> pmin(1e99, 1e99, 1e99), pmax(-1e99, -1e99, -1e99);
+      for (auto & pts : { &spts, &tpts })
+        for (auto p : *pts)
+          for (int k = 0; k < 3; k++)
+            {
+              pmin(k) = min(pmin(k), p(k));
+              pmax(k) = max(pmax(k), p(k));
+            }
+      for (int k = 0; k < 3; k++)
+        {
+          pmin(k) = comm.AllReduce(pmin(k), NG_MPI_MIN);
+          pmax(k) = comm.AllReduce(pmax(k), NG_MPI_MAX);
+        }
+      Vec<3> center = 0.5*(pmin+pmax);
+      double r = 0.5*MaxNorm(pmax-pmin)*(1+1e-8) + 1e-12;
+
+      int level = 1;
+      while ( (1 << (3*level)) < 8*ntasks && level < 6) level++;
+      int n = 1 << level;
+      double rc = r / n;     // half side of a cell
+
+      auto cellnr = [&] (Vec<3> p)
+      {
+        int nr = 0;
+        for (int k = 0; k < 3; k++)
+          nr = nr*n + clamp(int((p(k)-center(k)+r)/(2*rc)), 0, n-1);
+        return nr;
+      };
+      auto cellcenter = [&] (int nr)
+      {
+        Vec<3> c;
+        for (int k = 2; k >= 0; k--, nr /= n)
+          c(k) = center(k)-r + (2*(nr%n)+1)*rc;
+        return c;
+      };
+
+      Array<int> mycells;
+      for (auto p : tpts)
+        mycells.Append (cellnr(p));
+      QuickSort (mycells);
+      mycells.SetSize (std::unique(mycells.Data(), mycells.Data()+mycells.Size()) - mycells.Data());
+
+      NgMPI_Requests requests;
+      for (int p = 0; p < ntasks; p++)
+        if (p != rank)
+          requests += comm.ISend (mycells, p, NG_MPI_TAG_SOLVE);
+      Array<Array<Vec<3>>> remote_cells(ntasks);
+      for (int p = 0; p < ntasks; p++)
+        if (p != rank)
+          {
+            Array<int> cells;
+            comm.Recv (cells, p, NG_MPI_TAG_SOLVE);
+            for (auto c : cells)
+              remote_cells[p].Append (cellcenter(c));
+          }
+      requests.WaitAll();
+
+
+      // local singular tree
+      auto [sc, sr] = CenterAndRadius(spts);
+      newplan->singmp = kernel.CreateMultipoleExpansion (sc, sr, fmm_params);
+      ParallelFor (spts.Size(), [&](int i){
+        AddSource(*newplan->singmp, spts[i], snv[i], zero, trans);
+      });
+      newplan->singmp->CalcMP();
+      auto & root = newplan->singmp->Root();
+
+      // the multipole of the node is accurate in all cells
+      auto separated = [&] (const T_Node & node, FlatArray<Vec<3>> cells)
+      {
+        for (auto c : cells)
+          if (L2Norm(node.center-c) <= 3*node.r + sqrt(3.)*rc)
+            return false;
+        return true;
+      };
+
+      TableCreator<const T_Node*> creator_nodes(ntasks);
+      TableCreator<int> creator_sources(ntasks);
+      Array<const T_Node*> nodes;
+      bool have_leaves;
+      for ( ; !creator_nodes.Done(); creator_nodes++, creator_sources++)
+        for (int p = 0; p < ntasks; p++)
+          {
+            if (p == rank || remote_cells[p].Size() == 0) continue;
+
+            nodes.SetSize0();
+            have_leaves = false;
+            auto classify = [&] (auto & self, const T_Node & node) -> void
+            {
+              if (node.total_sources == 0) return;
+              if (separated(node, remote_cells[p]))
+                {
+                  nodes.Append (&node);
+                  return;
+                }
+              if (!node.childs[0])
+                {
+                  have_leaves = true;
+                  return;
+                }
+              for (auto & child : node.childs)
+                self (self, *child);
+            };
+            classify (classify, root);
+            for (auto node : nodes)
+              creator_nodes.Add (p, node);
+            if (!have_leaves) continue;
+
+            // sources in leaves not covered by a multipole are sent directly
+            QuickSort (nodes);
+            for (size_t i : Range(spts))
+              for (const T_Node * node = &root; ; node = node->childs[node->GetChildNum(spts[i])].get())
+                {
+                  if (std::binary_search(nodes.Data(), nodes.Data()+nodes.Size(), node)) break;
+                  if (!node->childs[0])
+                    {
+                      creator_sources.Add (p, i);
+                      break;
+                    }
+                }
+          }
+      newplan->send_nodes = creator_nodes.MoveTable();
+      newplan->send_sources = creator_sources.MoveTable();
+
+
+      // send node geometry and source positions
+      Array<Array<double>> send_nodedata(ntasks), send_sourcedata(ntasks);
+      for (int p = 0; p < ntasks; p++)
+        if (p != rank)
+          {
+            for (auto node : newplan->send_nodes[p])
+              {
+                for (int k = 0; k < 3; k++)
+                  send_nodedata[p].Append (node->center(k));
+                send_nodedata[p].Append (node->r);
+              }
+            for (auto i : newplan->send_sources[p])
+              for (int k = 0; k < 3; k++)
+                {
+                  send_sourcedata[p].Append (spts[i](k));
+                  send_sourcedata[p].Append (snv[i](k));
+                }
+            requests += comm.ISend (send_nodedata[p], p, NG_MPI_TAG_SOLVE);
+            requests += comm.ISend (send_sourcedata[p], p, NG_MPI_TAG_SOLVE);
+          }
+
+      TableCreator<T_Node*> creator_recv_nodes(ntasks);
+      TableCreator<int> creator_recv_sources(ntasks);
+      for (int p = 0; p < ntasks; p++)
+        if (p != rank)
+          {
+            Array<double> nodedata, sourcedata;
+            comm.Recv (nodedata, p, NG_MPI_TAG_SOLVE);
+            comm.Recv (sourcedata, p, NG_MPI_TAG_SOLVE);
+            for (size_t j = 0; j < nodedata.Size(); j += 4)
+              {
+                Vec<3> c(nodedata[j], nodedata[j+1], nodedata[j+2]);
+                creator_recv_nodes.Add (p, &newplan->singmp->AddRemoteNode (c, nodedata[j+3]));
+              }
+            for (size_t j = 0; j < sourcedata.Size(); j += 6)
+              {
+                creator_recv_sources.Add (p, newplan->ghost_pts.Size());
+                newplan->ghost_pts.Append (Vec<3>(sourcedata[j], sourcedata[j+2], sourcedata[j+4]));
+                newplan->ghost_nv.Append (Vec<3>(sourcedata[j+1], sourcedata[j+3], sourcedata[j+5]));
+              }
+          }
+      newplan->recv_nodes = creator_recv_nodes.MoveTable();
+      newplan->recv_sources = creator_recv_sources.MoveTable();
+      requests.WaitAll();
+
+      if (newplan->ghost_pts.Size())
+        {
+          auto [gc, gr] = CenterAndRadius(newplan->ghost_pts);
+          newplan->ghostmp = kernel.CreateMultipoleExpansion (gc, gr, fmm_params);
+          ParallelFor (newplan->ghost_pts.Size(), [&](int i){
+            AddSource(*newplan->ghostmp, newplan->ghost_pts[i], newplan->ghost_nv[i], zero, trans);
+          });
+          newplan->ghostmp->CalcMP();
+          newplan->singmp->AddRemoteTree (newplan->ghostmp);
+        }
+
+      // record the S->R translations
+      auto [tc, tr] = CenterAndRadius(tpts);
+      newplan->regmp = kernel.CreateLocalExpansion (tc, tr, fmm_params);
+      ParallelFor (tpts.Size(), [&](int i){
+        newplan->regmp->AddTarget(tpts[i]);
+      });
+      newplan->regmp->CalcMP(newplan->singmp);
+      return newplan;
+    }
+
+
+    void Apply (Plan & plan,
+                FlatArray<Vec<3>> spts, FlatArray<Vec<3>> snv, FlatMatrix<value_type> svals,
+                FlatArray<Vec<3>> tpts, FlatArray<Vec<3>> tnv, FlatMatrix<value_type> tvals,
+                bool trans) const
+    {
+      int ntasks = comm.Size();
+      int rank = comm.Rank();
+      int ncomp = svals.Width();
+
+      plan.singmp->ResetSources();
+      ParallelFor (spts.Size(), [&](int i){
+        AddSource(*plan.singmp, spts[i], snv[i], svals.Row(i), trans);
+      });
+
+      // values of sources taken directly by other processes
+      Array<int> nsend(ntasks), nrecv(ntasks);
+      for (int p = 0; p < ntasks; p++)
+        {
+          nsend[p] = plan.send_sources[p].Size()*ncomp;
+          nrecv[p] = plan.recv_sources[p].Size()*ncomp;
+        }
+      Table<value_type> send_values(nsend), recv_values(nrecv);
+      NgMPI_Requests send_requests, recv_requests, recv_coef_requests;
+      for (int p = 0; p < ntasks; p++)
+        {
+          for (auto [k,i] : Enumerate(plan.send_sources[p]))
+            FlatVector<value_type>(ncomp, &send_values[p][k*ncomp]) = svals.Row(i);
+          if (nsend[p])
+            send_requests += comm.ISend (send_values[p], p, NG_MPI_TAG_SOLVE);
+          if (nrecv[p])
+            recv_requests += comm.IRecv (recv_values[p], p, NG_MPI_TAG_SOLVE);
+        }
+
+      plan.singmp->CalcMP();
+
+      // multipoles of the local tree
+      for (int p = 0; p < ntasks; p++)
+        {
+          nsend[p] = 0;
+          for (auto node : plan.send_nodes[p])
+            {
+              auto coefs = VecVector2Matrix (node->mp.SH().Coefs());
+              nsend[p] += coefs.Height()*coefs.Width();
+            }
+          nrecv[p] = 0;
+          for (auto node : plan.recv_nodes[p])
+            {
+              auto coefs = VecVector2Matrix (node->mp.SH().Coefs());
+              nrecv[p] += coefs.Height()*coefs.Width();
+            }
+        }
+      Table<Complex> send_coefs(nsend), recv_coefs(nrecv);
+      for (int p = 0; p < ntasks; p++)
+        {
+          size_t cnt = 0;
+          for (auto node : plan.send_nodes[p])
+            {
+              auto coefs = VecVector2Matrix (node->mp.SH().Coefs());
+              for (size_t i = 0; i < coefs.Height(); i++)
+                for (size_t j = 0; j < coefs.Width(); j++)
+                  send_coefs[p][cnt++] = coefs(i,j);
+            }
+          if (nsend[p])
+            send_requests += comm.ISend (send_coefs[p], p, NG_MPI_TAG_SOLVE+1);
+          if (nrecv[p])
+            recv_coef_requests += comm.IRecv (recv_coefs[p], p, NG_MPI_TAG_SOLVE+1);
+        }
+
+      recv_requests.WaitAll();
+      if (plan.ghostmp)
+        {
+          for (int p = 0; p < ntasks; p++)
+            ParallelFor (plan.recv_sources[p].Size(), [&](int k){
+              int i = plan.recv_sources[p][k];
+              AddSource(*plan.ghostmp, plan.ghost_pts[i], plan.ghost_nv[i],
+                        FlatVector<value_type>(ncomp, &recv_values[p][k*ncomp]), trans);
+            });
+          plan.ghostmp->CalcMP();
+        }
+
+      recv_coef_requests.WaitAll();
+      for (int p = 0; p < ntasks; p++)
+        {
+          size_t cnt = 0;
+          for (auto node : plan.recv_nodes[p])
+            {
+              auto coefs = VecVector2Matrix (node->mp.SH().Coefs());
+              for (size_t i = 0; i < coefs.Height(); i++)
+                for (size_t j = 0; j < coefs.Width(); j++)
+                  coefs(i,j) = recv_coefs[p][cnt++];
+            }
+        }
+      send_requests.WaitAll();
+
+      plan.regmp->CalcMP(plan.singmp);
+
+      tvals = 0.0;
+      ParallelFor (tpts.Size(), [&](int i) {
+        if (trans)
+          kernel.EvaluateMPTrans(*plan.regmp, tpts[i], tnv[i], tvals.Row(i));
+        else
+          kernel.EvaluateMP(*plan.regmp, tpts[i], tnv[i], tvals.Row(i));
+      });
+    }
+  };
+
+#endif  // PARALLEL
+
 }
 
 
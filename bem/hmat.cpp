@@ -0,0 +1,955 @@
+#include "hmat.hpp"
+#include <algorithm>
+
+
+namespace ngsbem
+{
+
+  static Array<int> AllIndices (size_t n)
+  {
+    Array<int> ind(n);
+    for (size_t i : Range(n))
+      ind[i] = i;
+    return ind;
+  }
+
+  ClusterTree :: ClusterTree (FlatArray<Vec<3>> bbmin, FlatArray<Vec<3>> bbmax, int leafsize)
+    : ClusterTree (AllIndices(bbmin.Size()), bbmin, bbmax, leafsize) { }
+
+
+  ClusterTree :: ClusterTree (FlatArray<int> indices,
+                              FlatArray<Vec<3>> bbmin, FlatArray<Vec<3>> bbmax, int leafsize)
+    : size(bbmin.Size()), perm(indices)
+  {
+    size_t n = perm.Size();
+
+    Array<Vec<3>> centers(size);
+    for (size_t i : Range(size))
+      centers[i] = 0.5 * (bbmin[i]+bbmax[i]);
+
+    auto build = [&] (auto & self, IntRange r) -> int
+      {
+        Cluster c;
+        c.range = r;
+        c.pmin = 1e99;
+        c.pmax = -1e99;
+        Vec<3> cmin = 1e99, cmax = -1e99;
+        for (auto k : r)
+          for (int j = 0; j < 3; j++)
+            {
+              c.pmin(j) = min(c.pmin(j), bbmin[perm[k]](j));
+              c.pmax(j) = max(c.pmax(j), bbmax[perm[k]](j));
+              cmin(j) = min(cmin(j), centers[perm[k]](j));
+              cmax(j) = max(cmax(j), centers[perm[k]](j));
+            }
+
+        int nr = clusters.Size();
+        clusters.Append (c);
+        if (r.Size() <= size_t(leafsize)) return nr;
+
+        int dir = 0;
+        for (int j = 1; j < 3; j++)
+          if (cmax(j)-cmin(j) > cmax(dir)-cmin(dir)) dir = j;
+        if (cmax(dir) == cmin(dir)) return nr;   // all centers coincide
+
+        size_t mid = r.First() + r.Size()/2;
+        std::nth_element (perm.Data()+r.First(), perm.Data()+mid, perm.Data()+r.Next(),
+                          [&] (int a, int b) { return centers[a](dir) < centers[b](dir); });
+
+        int c0 = self (self, IntRange(r.First(), mid));
+        int c1 = self (self, IntRange(mid, r.Next()));
+        clusters[nr].child[0] = c0;
+        clusters[nr].child[1] = c1;
+        return nr;
+      };
+
+    if (n > 0)
+      build (build, IntRange(0, n));
+  }
+
+
+  double ClusterTree :: Distance (const Cluster & c1, const Cluster & c2)
+  {
+    double sum = 0;
+    for (int j = 0; j < 3; j++)
+      {
+        double d = max(0.0, max(c1.pmin(j)-c2.pmax(j), c2.pmin(j)-c1.pmax(j)));
+        sum += d*d;
+      }
+    return sqrt(sum);
+  }
+
+
+
+  template <typename T>
+  HMatrix<T> :: HMatrix (shared_ptr<ClusterTree> _rowtree, shared_ptr<ClusterTree> _coltree,
+                         const T_Generator & generator, const HMatrix_Parameters & _params)
+    : rowtree(_rowtree), coltree(_coltree), params(_params)
+  {
+    static Timer t("HMatrix setup"); RegionTimer reg(t);
+#ifndef LAPACK
+    throw Exception("HMatrix needs LAPACK for the low-rank truncation");
+#endif
+    if (rowtree->Perm().Size() == 0 || coltree->Perm().Size() == 0) return;
+
+    root = BuildBlock (0, 0);
+
+    auto collect = [&] (auto & self, Block & b) -> void
+      {
+        if (b.type == HIERARCHICAL)
+          {
+            for (int i = 0; i < 2; i++)
+              for (int j = 0; j < 2; j++)
+                self (self, *b.children[i][j]);
+          }
+        else
+          leaves.Append (&b);
+      };
+    collect (collect, *root);
+
+    ParallelForRange (IntRange(leaves.Size()), [&](IntRange r)
+      {
+        for (auto i : r)
+          {
+            auto & b = *leaves[i];
+            if (b.type == LOWRANK)
+              ACA (b, generator);
+            else
+              {
+                b.mat.SetSize (b.rows.Size(), b.cols.Size());
+                generator (rowtree->Indices(b.rows), coltree->Indices(b.cols), b.mat);
+              }
+          }
+      }, TasksPerThread(4));
+  }
+
+
+  template <typename T>
+  auto HMatrix<T> :: BuildBlock (int rowcluster, int colcluster) -> unique_ptr<Block>
+  {
+    auto & cr = (*rowtree)[rowcluster];
+    auto & cc = (*coltree)[colcluster];
+
+    auto b = make_unique<Block>();
+    b->rows = cr.range;
+    b->cols = cc.range;
+    b->rowcluster = rowcluster;
+    b->colcluster = colcluster;
+
+    double dist = ClusterTree::Distance (cr, cc);
+    if (dist > 0 && min(cr.Diam(), cc.Diam()) <= params.eta * dist)
+      b->type = LOWRANK;
+    else if (cr.IsLeaf() || cc.IsLeaf())
+      b->type = DENSE;
+    else
+      {
+        b->type = HIERARCHICAL;
+        for (int i = 0; i < 2; i++)
+          for (int j = 0; j < 2; j++)
+            b->children[i][j] = BuildBlock (cr.child[i], cc.child[j]);
+      }
+    return b;
+  }
+
+
+  /*
+    ACA with partial pivoting:
+    the next pivot row is the maximal entry of the last residual column,
+    stop if the new cross is below eps times the norm of the approximation.
+  */
+  template <typename T>
+  void HMatrix<T> :: ACA (Block & b, const T_Generator & generator) const
+  {
+    auto rows = rowtree->Indices(b.rows);
+    auto cols = coltree->Indices(b.cols);
+    size_t m = rows.Size(), n = cols.Size();
+
+    auto dot = [] (FlatVector<T> v1, FlatVector<T> v2)
+      {
+        T sum = 0.0;
+        for (size_t k : Range(v1))
+          sum += Conj(v1(k)) * v2(k);
+        return sum;
+      };
+
+    Array<Vector<T>> us, vs;
+    Vector<T> rowvec(n), colvec(m);
+    Array<bool> usedrow(m);
+    usedrow = false;
+    double norm2 = 0;    // squared Frobenius norm of the approximation
+    size_t i = 0;        // pivot row
+    bool converged = false;
+
+    // give up when the low-rank representation gets more expensive than the dense block
+    while ((us.Size()+1)*(m+n) < m*n)
+      {
+        usedrow[i] = true;
+        generator (rows.Range(i, i+1), cols, rowvec.AsMatrix(1, n));
+        for (size_t l : Range(us))
+          rowvec -= us[l](i) * vs[l];
+
+        size_t j = 0;
+        for (size_t k : Range(n))
+          if (abs(rowvec(k)) > abs(rowvec(j))) j = k;
+
+        if (abs(rowvec(j)) == 0)
+          {
+            // residual row vanishes, continue with some unused row
+            auto pos = usedrow.Pos(false);
+            if (pos == usedrow.ILLEGAL_POSITION)
+              {
+                converged = true;
+                break;
+              }
+            i = pos;
+            continue;
+          }
+
+        generator (rows, cols.Range(j, j+1), colvec.AsMatrix(m, 1));
+        for (size_t l : Range(us))
+          colvec -= vs[l](j) * us[l];
+
+        T pivot = rowvec(j);
+        rowvec *= T(1.0) / pivot;
+
+        double nu2 = L2Norm2(colvec) * L2Norm2(rowvec);
+        for (size_t l : Range(us))
+          norm2 += 2 * std::real (dot(us[l], colvec) * dot(vs[l], rowvec));
+        norm2 += nu2;
+        us.Append (colvec);
+        vs.Append (rowvec);
+
+        if (nu2 <= sqr(params.eps) * norm2)
+          {
+            converged = true;
+            break;
+          }
+
+        double maxval = -1;
+        for (size_t k : Range(m))
+          if (!usedrow[k] && abs(colvec(k)) > maxval)
+            {
+              maxval = abs(colvec(k));
+              i = k;
+            }
+        if (maxval < 0)
+          {
+            converged = true;
+            break;
+          }
+      }
+
+    if (!converged)
+      {
+        b.type = DENSE;
+        b.mat.SetSize (m, n);
+        generator (rows, cols, b.mat);
+        return;
+      }
+
+    b.U.SetSize (m, us.Size());
+    b.V.SetSize (n, vs.Size());
+    for (size_t l : Range(us))
+      {
+        b.U.Col(l) = us[l];
+        b.V.Col(l) = vs[l];
+      }
+    TruncateLowRank (b.U, b.V, params.eps);
+  }
+
+
+
+  template <typename T> template <typename TS>
+  void HMatrix<T> :: MultAddImpl (TS s, const BaseVector & x, BaseVector & y, bool trans) const
+  {
+    static Timer t("HMatrix::MultAdd"); RegionTimer reg(t);
+
+    auto fx = x.FV<T>();
+    auto fy = y.FV<T>();
+    auto & xtree = trans ? *rowtree : *coltree;
+    auto & ytree = trans ? *coltree : *rowtree;
+    auto xperm = xtree.Perm();
+    auto yperm = ytree.Perm();
+
+    Vector<T> xp(xperm.Size()), yp(yperm.Size());
+    ParallelFor (xperm.Size(), [&](size_t k) { xp(k) = fx(xperm[k]); });
+    yp = 0.0;
+
+    ParallelForRange (IntRange(leaves.Size()), [&](IntRange r)
+      {
+        Vector<T> hx, hy;
+        for (auto i : r)
+          {
+            auto & b = *leaves[i];
+            IntRange in = trans ? b.rows : b.cols;
+            IntRange out = trans ? b.cols : b.rows;
+            hy.SetSize (out.Size());
+            if (b.type == DENSE)
+              {
+                if (trans)
+                  hy = Trans(b.mat) * xp.Range(in);
+                else
+                  hy = b.mat * xp.Range(in);
+              }
+            else
+              {
+                hx.SetSize (b.Rank());
+                if (trans)
+                  {
+                    hx = Trans(b.U) * xp.Range(in);
+                    hy = b.V * hx;
+                  }
+                else
+                  {
+                    hx = Trans(b.V) * xp.Range(in);
+                    hy = b.U * hx;
+                  }
+              }
+            for (size_t k : Range(out))
+              AtomicAdd (yp(out.First()+k), hy(k));
+          }
+      }, TasksPerThread(4));
+
+    ParallelFor (yperm.Size(), [&](size_t k) { fy(yperm[k]) += s * yp(k); });
+  }
+
+
+  template <typename T>
+  void HMatrix<T> :: Mult (const BaseVector & x, BaseVector & y) const
+  {
+    y = 0.0;
+    MultAddImpl (1.0, x, y, false);
+  }
+
+  template <typename T>
+  void HMatrix<T> :: MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    MultAddImpl (s, x, y, false);
+  }
+
+  template <typename T>
+  void HMatrix<T> :: MultAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    if constexpr (is_same<T,Complex>())
+      MultAddImpl (s, x, y, false);
+    else
+      BaseMatrix::MultAdd (s, x, y);
+  }
+
+  template <typename T>
+  void HMatrix<T> :: MultTrans (const BaseVector & x, BaseVector & y) const
+  {
+    y = 0.0;
+    MultAddImpl (1.0, x, y, true);
+  }
+
+  template <typename T>
+  void HMatrix<T> :: MultTransAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    MultAddImpl (s, x, y, true);
+  }
+
+  template <typename T>
+  void HMatrix<T> :: MultTransAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    if constexpr (is_same<T,Complex>())
+      MultAddImpl (s, x, y, true);
+    else
+      BaseMatrix::MultTransAdd (s, x, y);
+  }
+
+
+  template <typename T>
+  size_t HMatrix<T> :: NZE () const
+  {
+    size_t nze = 0;
+    for (auto b : leaves)
+      if (b->type == DENSE)
+        nze += b->rows.Size() * b->cols.Size();
+      else
+        nze += b->Rank() * (b->rows.Size() + b->cols.Size());
+    return nze;
+  }
+
+  template <typename T>
+  BaseMatrix::OperatorInfo HMatrix<T> :: GetOperatorInfo () const
+  {
+    return { string("HMatrix, compression = ")+ToString(CompressionRate()), this->Height(), this->Width() };
+  }
+
+
+
+  template <typename T>
+  void TruncateLowRank (Matrix<T> & U, Matrix<T> & V, double eps)
+  {
+#ifdef LAPACK
+    size_t m = U.Height(), n = V.Height(), k = U.Width();
+    if (k == 0) return;
+    size_t ku = min(m, k), kv = min(n, k);
+
+    // U = QU * diag(SU) * WU,   V = QV * diag(SV) * WV
+    Matrix<T> hU = U, hV = V;
+    Matrix<T> QU(m, ku), WU(ku, k), QV(n, kv), WV(kv, k);
+    Vector<double> SU(ku), SV(kv);
+    LapackSVD (hU, QU, WU, SU, false);
+    LapackSVD (hV, QV, WV, SV, false);
+
+    // U * Trans(V) = QU * C * Trans(QV)
+    Matrix<T> C = WU * Trans(WV);
+    for (size_t i : Range(ku))
+      C.Row(i) *= SU(i);
+    for (size_t j : Range(kv))
+      C.Col(j) *= SV(j);
+
+    size_t kc = min(ku, kv);
+    Matrix<T> P(ku, kc), Q(kc, kv);
+    Vector<double> S(kc);
+    LapackSVD (C, P, Q, S, false);
+
+    double total = 0, tail = 0;
+    for (size_t i : Range(kc))
+      total += sqr(S(i));
+    size_t r = kc;
+    while (r > 0 && tail + sqr(S(r-1)) <= sqr(eps) * total)
+      tail += sqr(S(--r));
+
+    Matrix<T> newU = QU * P.Cols(0, r);
+    for (size_t j : Range(r))
+      newU.Col(j) *= S(j);
+    Matrix<T> newV = QV * Trans(Q.Rows(0, r));
+    U = std::move(newU);
+    V = std::move(newV);
+#else
+    throw Exception("TruncateLowRank needs LAPACK");
+#endif
+  }
+
+
+
+  /*
+    Block arithmetic for the H-LU factorization.
+    All blocks belong to one H-matrix with identical row and column trees,
+    so the children of blocks with the same clusters match.
+    op(B) is B or Trans(B).
+  */
+  template <typename T>
+  class HArithmetic
+  {
+    typedef typename HMatrix<T>::Block Block;
+    static constexpr auto DENSE = HMatrix<T>::DENSE;
+    static constexpr auto LOWRANK = HMatrix<T>::LOWRANK;
+    static constexpr auto HIERARCHICAL = HMatrix<T>::HIERARCHICAL;
+
+    double eps;
+
+    // dense LU and Cholesky do not pivot, smaller pivots (relative to the
+    // block) are rejected
+    static constexpr double pivot_tol = 1e-12;
+
+    // range of the sub-cluster relative to the cluster
+    static IntRange Local (IntRange sub, IntRange r)
+    { return IntRange(sub.First()-r.First(), sub.Next()-r.First()); }
+
+    static Matrix<T> Identity (size_t n)
+    {
+      Matrix<T> id(n, n);
+      id = T(0.0);
+      id.Diag() = T(1.0);
+      return id;
+    }
+
+    static IntRange OpRows (const Block & b, bool trans) { return trans ? b.cols : b.rows; }
+    static IntRange OpCols (const Block & b, bool trans) { return trans ? b.rows : b.cols; }
+    static const Block & OpChild (const Block & b, bool trans, int i, int j)
+    { return trans ? *b.children[j][i] : *b.children[i][j]; }
+
+  public:
+    HArithmetic (double _eps) : eps(_eps) { }
+
+    // Y += s * op(A) * X
+    static void MultAddMat (const Block & a, bool trans, T s, SliceMatrix<T> x, SliceMatrix<T> y)
+    {
+      switch (a.type)
+        {
+        case DENSE:
+          if (trans)
+            y += s * Trans(a.mat) * x;
+          else
+            y += s * a.mat * x;
+          break;
+        case LOWRANK:
+          {
+            if (a.Rank() == 0) break;
+            Matrix<T> tmp = Trans(trans ? a.U : a.V) * x;
+            y += s * (trans ? a.V : a.U) * tmp;
+            break;
+          }
+        case HIERARCHICAL:
+          for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++)
+              {
+                auto & c = OpChild(a, trans, i, j);
+                MultAddMat (c, trans, s, x.Rows(Local(OpCols(c, trans), OpCols(a, trans))),
+                            y.Rows(Local(OpRows(c, trans), OpRows(a, trans))));
+              }
+          break;
+        }
+    }
+
+    // C += s * U * Trans(V)
+    void AddLowRank (Block & c, T s, SliceMatrix<T> u, SliceMatrix<T> v) const
+    {
+      if (u.Width() == 0) return;
+      switch (c.type)
+        {
+        case DENSE:
+          c.mat += s * u * Trans(v);
+          break;
+        case LOWRANK:
+          {
+            size_t k = c.Rank();
+            Matrix<T> newU(u.Height(), k+u.Width()), newV(v.Height(), k+v.Width());
+            newU.Cols(0, k) = c.U;
+            newU.Cols(k, k+u.Width()) = s * u;
+            newV.Cols(0, k) = c.V;
+            newV.Cols(k, k+v.Width()) = v;
+            TruncateLowRank (newU, newV, eps);
+            c.U = std::move(newU);
+            c.V = std::move(newV);
+            break;
+          }
+        case HIERARCHICAL:
+          for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++)
+              {
+                auto & ch = *c.children[i][j];
+                AddLowRank (ch, s, u.Rows(Local(ch.rows, c.rows)), v.Rows(Local(ch.cols, c.cols)));
+              }
+          break;
+        }
+    }
+
+    // A * op(B) = U * Trans(V), truncated
+    void LowRankProduct (const Block & a, const Block & b, bool transb,
+                         Matrix<T> & u, Matrix<T> & v) const
+    {
+      size_t m = a.rows.Size(), n = OpCols(b, transb).Size(), inner = a.cols.Size();
+
+      if (b.type == LOWRANK)
+        {
+          auto & bu = transb ? b.V : b.U;
+          auto & bv = transb ? b.U : b.V;
+          u.SetSize (m, bu.Width());
+          u = T(0.0);
+          MultAddMat (a, false, 1.0, bu, u);
+          v = bv;
+        }
+      else if (a.type == LOWRANK)
+        {
+          u = a.U;
+          v.SetSize (n, a.Rank());
+          v = T(0.0);
+          MultAddMat (b, !transb, 1.0, a.V, v);
+        }
+      else if (a.type == DENSE)
+        {
+          if (inner <= m)
+            {
+              // U = A,  Trans(V) = op(B)
+              u = a.mat;
+              v.SetSize (n, inner);
+              v = T(0.0);
+              MultAddMat (b, !transb, 1.0, Identity(inner), v);
+            }
+          else
+            {
+              // U = I,  V = Trans(op(B)) * Trans(A)
+              Matrix<T> at = Trans(a.mat);
+              u = Identity(m);
+              v.SetSize (n, m);
+              v = T(0.0);
+              MultAddMat (b, !transb, 1.0, at, v);
+            }
+        }
+      else if (b.type == DENSE)
+        {
+          Matrix<T> bmat = transb ? Matrix<T>(Trans(b.mat)) : b.mat;
+          if (inner <= n)
+            {
+              // U = A,  Trans(V) = op(B)
+              u.SetSize (m, inner);
+              u = T(0.0);
+              MultAddMat (a, false, 1.0, Identity(inner), u);
+              v = Trans(bmat);
+            }
+          else
+            {
+              // U = A * op(B),  V = I
+              u.SetSize (m, n);
+              u = T(0.0);
+              MultAddMat (a, false, 1.0, bmat, u);
+              v = Identity(n);
+            }
+        }
+      else
+        {
+          // both hierarchical: collect the low-rank products of the children
+          Array<Matrix<T>> us, vs;
+          Array<IntRange> urows, vrows;
+          size_t rank = 0;
+          for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++)
+              for (int k = 0; k < 2; k++)
+                {
+                  auto & ca = *a.children[i][k];
+                  auto & cb = OpChild(b, transb, k, j);
+                  Matrix<T> hu, hv;
+                  LowRankProduct (ca, cb, transb, hu, hv);
+                  rank += hu.Width();
+                  us.Append (std::move(hu));
+                  vs.Append (std::move(hv));
+                  urows.Append (Local(ca.rows, a.rows));
+                  vrows.Append (Local(OpCols(cb, transb), OpCols(b, transb)));
+                }
+          u.SetSize (m, rank);
+          v.SetSize (n, rank);
+          u = T(0.0);
+          v = T(0.0);
+          size_t first = 0;
+          for (size_t l : Range(us))
+            {
+              IntRange cols(first, first+us[l].Width());
+              u.Rows(urows[l]).Cols(cols) = us[l];
+              v.Rows(vrows[l]).Cols(cols) = vs[l];
+              first = cols.Next();
+            }
+        }
+      TruncateLowRank (u, v, eps);
+    }
+
+    /*
+      C += s * A * op(B)
+      lower: C is a symmetric diagonal block, only its lower part is needed
+    */
+    void AddProduct (Block & c, T s, const Block & a, const Block & b, bool transb, bool lower = false) const
+    {
+      if (c.type == HIERARCHICAL && a.type == HIERARCHICAL && b.type == HIERARCHICAL)
+        {
+          for (int i = 0; i < 2; i++)
+            for (int j = 0; j < 2; j++)
+              {
+                if (lower && j > i) continue;
+                for (int k = 0; k < 2; k++)
+                  AddProduct (*c.children[i][j], s, *a.children[i][k], OpChild(b, transb, k, j),
+                              transb, lower && i == j);
+              }
+          return;
+        }
+
+      Matrix<T> u, v;
+      LowRankProduct (a, b, transb, u, v);
+      AddLowRank (c, s, u, v);
+    }
+
+
+    // X <- L^{-1} X,  L lower part of the diagonal block l
+    static void SolveL (const Block & l, SliceMatrix<T> x, bool unit)
+    {
+      if (l.type == DENSE)
+        {
+          if (unit)
+            TriangularSolve<LowerLeft,Normalized> (l.mat, x);
+          else
+            TriangularSolve<LowerLeft,NonNormalized> (l.mat, x);
+          return;
+        }
+      auto & l00 = *l.children[0][0];
+      auto & l10 = *l.children[1][0];
+      auto & l11 = *l.children[1][1];
+      auto x0 = x.Rows(Local(l00.rows, l.rows));
+      auto x1 = x.Rows(Local(l11.rows, l.rows));
+      SolveL (l00, x0, unit);
+      MultAddMat (l10, false, -1.0, x0, x1);
+      SolveL (l11, x1, unit);
+    }
+
+    // X <- L^{-T} X
+    static void SolveLTrans (const Block & l, SliceMatrix<T> x, bool unit)
+    {
+      if (l.type == DENSE)
+        {
+          Matrix<T> lt = Trans(l.mat);
+          if (unit)
+            TriangularSolve<UpperRight,Normalized> (lt, x);
+          else
+            TriangularSolve<UpperRight,NonNormalized> (lt, x);
+          return;
+        }
+      auto & l00 = *l.children[0][0];
+      auto & l10 = *l.children[1][0];
+      auto & l11 = *l.children[1][1];
+      auto x0 = x.Rows(Local(l00.rows, l.rows));
+      auto x1 = x.Rows(Local(l11.rows, l.rows));
+      SolveLTrans (l11, x1, unit);
+      MultAddMat (l10, true, -1.0, x1, x0);
+      SolveLTrans (l00, x0, unit);
+    }
+
+    // X <- U^{-1} X,  U upper part of the diagonal block u
+    static void SolveU (const Block & u, SliceMatrix<T> x)
+    {
+      if (u.type == DENSE)
+        {
+          TriangularSolve<UpperRight,NonNormalized> (u.mat, x);
+          return;
+        }
+      auto & u00 = *u.children[0][0];
+      auto & u01 = *u.children[0][1];
+      auto & u11 = *u.children[1][1];
+      auto x0 = x.Rows(Local(u00.rows, u.rows));
+      auto x1 = x.Rows(Local(u11.rows, u.rows));
+      SolveU (u11, x1);
+      MultAddMat (u01, false, -1.0, x1, x0);
+      SolveU (u00, x0);
+    }
+
+    // X <- U^{-T} X
+    static void SolveUTrans (const Block & u, SliceMatrix<T> x)
+    {
+      if (u.type == DENSE)
+        {
+          Matrix<T> ut = Trans(u.mat);
+          TriangularSolve<LowerLeft,NonNormalized> (ut, x);
+          return;
+        }
+      auto & u00 = *u.children[0][0];
+      auto & u01 = *u.children[0][1];
+      auto & u11 = *u.children[1][1];
+      auto x0 = x.Rows(Local(u00.rows, u.rows));
+      auto x1 = x.Rows(Local(u11.rows, u.rows));
+      SolveUTrans (u00, x0);
+      MultAddMat (u01, true, -1.0, x0, x1);
+      SolveUTrans (u11, x1);
+    }
+
+
+    // B <- L^{-1} B
+    void SolveLBlock (const Block & l, Block & b, bool unit) const
+    {
+      switch (b.type)
+        {
+        case DENSE: SolveL (l, b.mat, unit); break;
+        case LOWRANK: SolveL (l, b.U, unit); break;
+        case HIERARCHICAL:
+          for (int j = 0; j < 2; j++)
+            {
+              SolveLBlock (*l.children[0][0], *b.children[0][j], unit);
+              AddProduct (*b.children[1][j], -1.0, *l.children[1][0], *b.children[0][j], false);
+              SolveLBlock (*l.children[1][1], *b.children[1][j], unit);
+            }
+          break;
+        }
+    }
+
+    // B <- B U^{-1}
+    void SolveUBlockRight (const Block & u, Block & b) const
+    {
+      switch (b.type)
+        {
+        case DENSE:
+          {
+            Matrix<T> bt = Trans(b.mat);
+            SolveUTrans (u, bt);
+            b.mat = Trans(bt);
+            break;
+          }
+        case LOWRANK: SolveUTrans (u, b.V); break;
+        case HIERARCHICAL:
+          for (int i = 0; i < 2; i++)
+            {
+              SolveUBlockRight (*u.children[0][0], *b.children[i][0]);
+              AddProduct (*b.children[i][1], -1.0, *b.children[i][0], *u.children[0][1], false);
+              SolveUBlockRight (*u.children[1][1], *b.children[i][1]);
+            }
+          break;
+        }
+    }
+
+    // B <- B L^{-T}
+    void SolveLTransBlockRight (const Block & l, Block & b) const
+    {
+      switch (b.type)
+        {
+        case DENSE:
+          {
+            Matrix<T> bt = Trans(b.mat);
+            SolveL (l, bt, false);
+            b.mat = Trans(bt);
+            break;
+          }
+        case LOWRANK: SolveL (l, b.V, false); break;
+        case HIERARCHICAL:
+          for (int i = 0; i < 2; i++)
+            {
+              SolveLTransBlockRight (*l.children[0][0], *b.children[i][0]);
+              AddProduct (*b.children[i][1], -1.0, *b.children[i][0], *l.children[1][0], true);
+              SolveLTransBlockRight (*l.children[1][1], *b.children[i][1]);
+            }
+          break;
+        }
+    }
+
+
+    // A = L U, L with unit diagonal, both stored in A
+    void LU (Block & a) const
+    {
+      if (a.type == DENSE)
+        {
+          FlatMatrix<T> mat = a.mat;
+          size_t n = mat.Height();
+          double nrm = L2Norm (mat);
+          for (size_t k = 0; k < n; k++)
+            {
+              if (abs (mat(k,k)) <= pivot_tol * nrm)
+                throw Exception ("H-LU: pivot " + ToString(abs(mat(k,k))) + " in permuted row " +
+                                 ToString(a.rows.First()+k) + " is too small relative to the block norm " +
+                                 ToString(nrm) + ", the matrix is singular or needs pivoting");
+              T inv = T(1.0) / mat(k,k);
+              for (size_t i = k+1; i < n; i++)
+                {
+                  mat(i,k) *= inv;
+                  mat.Row(i).Range(k+1, n) -= mat(i,k) * mat.Row(k).Range(k+1, n);
+                }
+            }
+          return;
+        }
+      LU (*a.children[0][0]);
+      SolveLBlock (*a.children[0][0], *a.children[0][1], true);
+      SolveUBlockRight (*a.children[0][0], *a.children[1][0]);
+      AddProduct (*a.children[1][1], -1.0, *a.children[1][0], *a.children[0][1], false);
+      LU (*a.children[1][1]);
+    }
+
+    // A = L Trans(L), L stored in the lower part of A, the upper part is released
+    void Cholesky (Block & a) const
+    {
+      if (a.type == DENSE)
+        {
+          auto & mat = a.mat;
+          size_t n = mat.Height();
+          double maxdiag = 0;
+          for (size_t k = 0; k < n; k++)
+            maxdiag = max2 (maxdiag, abs (mat(k,k)));
+          for (size_t k = 0; k < n; k++)
+            {
+              // complex symmetric matrices have no sign, only the size is checked
+              bool positive = true;
+              if constexpr (is_same<T,double>::value)
+                positive = mat(k,k) > pivot_tol * maxdiag;
+              else
+                positive = abs (mat(k,k)) > pivot_tol * maxdiag;
+              if (!positive)
+                throw Exception ("H-Cholesky: pivot " + ToString(mat(k,k)) + " in permuted row " +
+                                 ToString(a.rows.First()+k) +
+                                 " is not positive or too small, the matrix is not positive definite");
+              mat(k,k) = sqrt(mat(k,k));
+              T inv = T(1.0) / mat(k,k);
+              for (size_t i = k+1; i < n; i++)
+                mat(i,k) *= inv;
+              for (size_t j = k+1; j < n; j++)
+                for (size_t i = j; i < n; i++)
+                  mat(i,j) -= mat(i,k) * mat(j,k);
+            }
+          for (size_t i = 0; i < n; i++)
+            mat.Row(i).Range(i+1, n) = T(0.0);
+          return;
+        }
+      Cholesky (*a.children[0][0]);
+      SolveLTransBlockRight (*a.children[0][0], *a.children[1][0]);
+      AddProduct (*a.children[1][1], -1.0, *a.children[1][0], *a.children[1][0], true, true);
+      Cholesky (*a.children[1][1]);
+      Release (*a.children[0][1]);
+    }
+
+    static void Release (Block & b)
+    {
+      b.mat = Matrix<T>();
+      b.U = Matrix<T>();
+      b.V = Matrix<T>();
+      if (b.type == HIERARCHICAL)
+        for (int i = 0; i < 2; i++)
+          for (int j = 0; j < 2; j++)
+            Release (*b.children[i][j]);
+    }
+  };
+
+
+
+  template <typename T>
+  HLUMatrix<T> :: HLUMatrix (shared_ptr<HMatrix<T>> _mat, double _eps, bool _cholesky)
+    : mat(_mat), eps(_eps), cholesky(_cholesky)
+  {
+    static Timer t("HMatrix LU"); RegionTimer reg(t);
+#ifndef LAPACK
+    throw Exception("H-LU needs LAPACK for the low-rank truncation");
+#endif
+    if (&mat->RowTree() != &mat->ColTree())
+      throw Exception("H-LU needs the same cluster tree for rows and columns");
+    if (!mat->Root()) return;
+
+    HArithmetic<T> arith(eps);
+    if (cholesky)
+      arith.Cholesky (*mat->Root());
+    else
+      arith.LU (*mat->Root());
+  }
+
+
+  template <typename T>
+  void HLUMatrix<T> :: Mult (const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("HMatrix LU solve"); RegionTimer reg(t);
+
+    auto fx = x.FV<T>();
+    auto fy = y.FV<T>();
+    auto perm = mat->RowTree().Perm();
+
+    y = 0.0;
+    if (!mat->Root()) return;
+
+    Matrix<T> hx(perm.Size(), 1);
+    for (size_t k : Range(perm))
+      hx(k,0) = fx(perm[k]);
+
+    auto & root = *mat->Root();
+    if (cholesky)
+      {
+        HArithmetic<T>::SolveL (root, hx, false);
+        HArithmetic<T>::SolveLTrans (root, hx, false);
+      }
+    else
+      {
+        HArithmetic<T>::SolveL (root, hx, true);
+        HArithmetic<T>::SolveU (root, hx);
+      }
+
+    for (size_t k : Range(perm))
+      fy(perm[k]) = hx(k,0);
+  }
+
+
+  template <typename T>
+  BaseMatrix::OperatorInfo HLUMatrix<T> :: GetOperatorInfo () const
+  {
+    return { string(cholesky ? "H-Cholesky" : "H-LU")+", eps = "+ToString(eps), this->Height(), this->Width() };
+  }
+
+
+  template void TruncateLowRank (Matrix<double> & U, Matrix<double> & V, double eps);
+  template void TruncateLowRank (Matrix<Complex> & U, Matrix<Complex> & V, double eps);
+
+  template class HMatrix<double>;
+  template class HMatrix<Complex>;
+  template class HLUMatrix<double>;
+  template class HLUMatrix<Complex>;
+}
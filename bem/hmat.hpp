@@ -0,0 +1,279 @@
+#ifndef FILE_HMAT
+#define FILE_HMAT
+
+/*
+  Hierarchical matrices (H-matrices)
+
+  The row and column index sets are organized in binary cluster trees.
+  Blocks of well separated clusters are approximated by low-rank
+  matrices computed by adaptive cross approximation (ACA), the
+  remaining leaf blocks are stored dense.
+
+  Matrix entries are requested from a generator function, so the
+  construction works for any kernel.
+*/
+
+#include <bla.hpp>
+#include <la.hpp>
+
+namespace ngsbem
+{
+  using namespace ngla;
+
+
+  class HMatrix_Parameters
+  {
+  public:
+    double eps = 1e-6;   // relative accuracy of low-rank blocks
+    double eta = 2;      // admissibility:  min(diam) <= eta * dist
+    int leafsize = 64;   // clusters up to this size are not split
+  };
+
+
+
+  /*
+    Binary cluster tree over an index set.
+    Every index comes with a bounding box: a point for quadrature points,
+    the support of a basis function for dofs.
+    A cluster is bisected at the median of the box centers along the
+    longest side. Clusters are contiguous ranges of perm.
+  */
+  class NGS_DLL_HEADER ClusterTree
+  {
+  public:
+    struct Cluster
+    {
+      IntRange range;         // range in perm
+      Vec<3> pmin, pmax;      // bounding box of all indices in the cluster
+      int child[2] = { -1, -1 };
+
+      bool IsLeaf() const { return child[0] == -1; }
+      double Diam() const { return L2Norm(pmax-pmin); }
+    };
+
+  private:
+    size_t size;               // size of the original index set
+    Array<int> perm;           // perm[k] .. original index at position k
+    Array<Cluster> clusters;   // clusters[0] is the root
+
+  public:
+    // only the given indices are clustered, the others do not take part
+    ClusterTree (FlatArray<int> indices,
+                 FlatArray<Vec<3>> bbmin, FlatArray<Vec<3>> bbmax, int leafsize);
+    ClusterTree (FlatArray<Vec<3>> bbmin, FlatArray<Vec<3>> bbmax, int leafsize);
+    ClusterTree (FlatArray<Vec<3>> pts, int leafsize)
+      : ClusterTree (pts, pts, leafsize) { }
+
+    size_t Size() const { return size; }
+    size_t NumClusters() const { return clusters.Size(); }
+    const Cluster & operator[] (size_t i) const { return clusters[i]; }
+    FlatArray<int> Perm() const { return perm; }
+    FlatArray<int> Indices (IntRange r) const { return perm.Range(r); }
+
+    static double Distance (const Cluster & c1, const Cluster & c2);
+  };
+
+
+
+  /*
+    H-matrix with blocks organized in a quad-tree.
+    Rows and columns of blocks refer to the permuted numbering of the
+    cluster trees, the matrix acts on vectors in original numbering.
+  */
+  template <typename T>
+  class HMatrix : public BaseMatrix
+  {
+  public:
+    /*
+      Computes the sub-matrix for the given rows and columns (in original numbering).
+      Called concurrently from several threads.
+    */
+    typedef std::function<void(FlatArray<int> rows, FlatArray<int> cols, SliceMatrix<T> block)> T_Generator;
+
+    enum BlockType { DENSE, LOWRANK, HIERARCHICAL };
+
+    struct Block
+    {
+      BlockType type = DENSE;
+      IntRange rows, cols;      // ranges in the permuted numbering
+      int rowcluster, colcluster;
+      Matrix<T> mat;            // dense block
+      Matrix<T> U, V;           // low-rank block mat = U * Trans(V)
+      unique_ptr<Block> children[2][2];
+
+      size_t Rank() const { return U.Width(); }
+    };
+
+  protected:
+    shared_ptr<ClusterTree> rowtree, coltree;
+    HMatrix_Parameters params;
+    unique_ptr<Block> root;
+    Array<Block*> leaves;
+
+  public:
+    HMatrix (shared_ptr<ClusterTree> _rowtree, shared_ptr<ClusterTree> _coltree,
+             const T_Generator & generator, const HMatrix_Parameters & _params);
+
+    int VHeight() const override { return rowtree->Size(); }
+    int VWidth() const override { return coltree->Size(); }
+    bool IsComplex() const override { return is_same<T,Complex>(); }
+
+    AutoVector CreateRowVector () const override { return make_unique<VVector<T>>(VWidth()); }
+    AutoVector CreateColVector () const override { return make_unique<VVector<T>>(VHeight()); }
+
+    void Mult (const BaseVector & x, BaseVector & y) const override;
+    void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    void MultAdd (Complex s, const BaseVector & x, BaseVector & y) const override;
+    void MultTrans (const BaseVector & x, BaseVector & y) const override;
+    void MultTransAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    void MultTransAdd (Complex s, const BaseVector & x, BaseVector & y) const override;
+
+    size_t NZE () const override;
+    BaseMatrix::OperatorInfo GetOperatorInfo () const override;
+
+    const ClusterTree & RowTree() const { return *rowtree; }
+    const ClusterTree & ColTree() const { return *coltree; }
+    const HMatrix_Parameters & Parameters() const { return params; }
+    Block * Root() const { return root.get(); }
+    FlatArray<Block*> Leaves() const { return leaves; }
+    // relative storage compared to the dense matrix
+    double CompressionRate() const { return double(NZE()) / (double(Height())*Width()); }
+
+  protected:
+    unique_ptr<Block> BuildBlock (int rowcluster, int colcluster);
+    void ACA (Block & block, const T_Generator & generator) const;
+    template <typename TS>
+    void MultAddImpl (TS s, const BaseVector & x, BaseVector & y, bool trans) const;
+  };
+
+
+  /*
+    Truncates U*Trans(V) to the smallest rank with relative error below eps.
+    Throws if compiled without LAPACK.
+  */
+  template <typename T>
+  void TruncateLowRank (Matrix<T> & U, Matrix<T> & V, double eps);
+
+  extern template class HMatrix<double>;
+  extern template class HMatrix<Complex>;
+
+
+
+  /*
+    H-LU factorization A = L U with unit lower L, or H-Cholesky A = L Trans(L)
+    for symmetric A (no conjugation, also for complex symmetric matrices).
+    The factors overwrite the blocks of the H-matrix, all block operations
+    are truncated to the relative accuracy eps.
+    Mult applies the approximate inverse, for direct solves or as preconditioner.
+  */
+  template <typename T>
+  class HLUMatrix : public BaseMatrix
+  {
+    shared_ptr<HMatrix<T>> mat;
+    double eps;
+    bool cholesky;
+
+  public:
+    HLUMatrix (shared_ptr<HMatrix<T>> _mat, double _eps, bool _cholesky);
+
+    int VHeight() const override { return mat->Height(); }
+    int VWidth() const override { return mat->Width(); }
+    bool IsComplex() const override { return is_same<T,Complex>(); }
+    xbool IsSymmetric() const override { return cholesky ? xbool(true) : xbool(maybe); }
+
+    AutoVector CreateRowVector () const override { return mat->CreateRowVector(); }
+    AutoVector CreateColVector () const override { return mat->CreateColVector(); }
+
+    void Mult (const BaseVector & x, BaseVector & y) const override;
+    size_t NZE () const override { return mat->NZE(); }
+    BaseMatrix::OperatorInfo GetOperatorInfo () const override;
+  };
+
+  extern template class HLUMatrix<double>;
+  extern template class HLUMatrix<Complex>;
+
+
+
+  /*
+    Entries of the point-to-point kernel matrix
+      A(iy*shape[0]+test_comp, ix*shape[1]+trial_comp) =
+           sum_terms  fac * kernel(ypts[iy], xpts[ix], ynv[iy], xnv[ix])(kernel_comp)
+    with the same layout as the FMM_Operator.
+    Only kernel.Evaluate and kernel.terms are used, so it works for kernels
+    without multipole expansions. Coinciding points give zero entries.
+  */
+  template <typename KERNEL>
+  class PointKernelEntries
+  {
+    const KERNEL & kernel;
+    FlatArray<Vec<3>> xpts, ypts, xnv, ynv;
+    IVec<2> shape;
+    Array<Array<int>> comp_terms;   // kernel terms sorted by the component pair they contribute to
+  public:
+    PointKernelEntries (const KERNEL & _kernel,
+                        FlatArray<Vec<3>> _xpts, FlatArray<Vec<3>> _ypts,
+                        FlatArray<Vec<3>> _xnv, FlatArray<Vec<3>> _ynv)
+      : kernel(_kernel), xpts(_xpts), ypts(_ypts), xnv(_xnv), ynv(_ynv), shape(KERNEL::Shape()),
+        comp_terms(shape[0]*shape[1])
+    {
+      for (auto i : Range(kernel.terms))
+        comp_terms[kernel.terms[i].test_comp*shape[1]+kernel.terms[i].trial_comp].Append(i);
+    }
+
+    size_t Height() const { return ypts.Size()*shape[0]; }
+    size_t Width() const { return xpts.Size()*shape[1]; }
+
+    void operator() (FlatArray<int> rows, FlatArray<int> cols,
+                     SliceMatrix<typename KERNEL::value_type> block) const
+    {
+      for (size_t i : Range(rows))
+        {
+          int iy = rows[i] / shape[0];
+          int cy = rows[i] % shape[0];
+          for (size_t j : Range(cols))
+            {
+              int ix = cols[j] / shape[1];
+              int cx = cols[j] % shape[1];
+              typename KERNEL::value_type val = 0.0;
+              if (L2Norm2(ypts[iy]-xpts[ix]) > 0)
+                {
+                  auto kernel_ = kernel.Evaluate(ypts[iy], xpts[ix], ynv[iy], xnv[ix]);
+                  for (auto nr : comp_terms[cy*shape[1]+cx])
+                    val += kernel.terms[nr].fac * kernel_(kernel.terms[nr].kernel_comp);
+                }
+              block(i,j) = val;
+            }
+        }
+    }
+  };
+
+
+  /*
+    H-matrix approximation of the point-to-point kernel matrix.
+  */
+  template <typename KERNEL>
+  shared_ptr<HMatrix<typename KERNEL::value_type>>
+  CreateKernelHMatrix (const KERNEL & kernel,
+                       FlatArray<Vec<3>> xpts, FlatArray<Vec<3>> ypts,
+                       FlatArray<Vec<3>> xnv, FlatArray<Vec<3>> ynv,
+                       const HMatrix_Parameters & params)
+  {
+    static Timer t("ngbem hmatrix setup "+KERNEL::Name()); RegionTimer reg(t);
+    auto shape = KERNEL::Shape();
+
+    Array<Vec<3>> rowpts(ypts.Size()*shape[0]), colpts(xpts.Size()*shape[1]);
+    for (size_t i : Range(ypts))
+      rowpts.Range(i*shape[0], (i+1)*shape[0]) = ypts[i];
+    for (size_t i : Range(xpts))
+      colpts.Range(i*shape[1], (i+1)*shape[1]) = xpts[i];
+
+    auto rowtree = make_shared<ClusterTree> (rowpts, params.leafsize);
+    auto coltree = make_shared<ClusterTree> (colpts, params.leafsize);
+
+    PointKernelEntries<KERNEL> entries(kernel, xpts, ypts, xnv, ynv);
+    return make_shared<HMatrix<typename KERNEL::value_type>> (rowtree, coltree, entries, params);
+  }
+
+}
+
+#endif
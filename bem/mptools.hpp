@@ -1138,6 +1138,62 @@ namespace ngsbem
             }
       }
       
+      // pack the sources of a leaf into SIMD-tuples, for direct evaluation
+      void MakeSimdSources()
+      {
+        simd_charges.SetSize( (charges.Size()+FMM_SW-1)/FMM_SW);
+        size_t i = 0, ii = 0;
+        for ( ; i+FMM_SW <= charges.Size(); i+=FMM_SW, ii++)
+          {
+            std::array<tuple<Vec<3>,entry_type>, FMM_SW> ca;
+            for (int j = 0; j < FMM_SW; j++) ca[j] = charges[i+j];
+            simd_charges[ii] = MakeSimd(ca);
+          }
+        if (i < charges.Size())
+          {
+            std::array<tuple<Vec<3>,entry_type>, FMM_SW> ca;
+            int j = 0;
+            for ( ; i+j < charges.Size(); j++) ca[j] = charges[i+j];
+            for ( ; j < FMM_SW; j++) ca[j] = tuple( get<0>(ca[0]), entry_type{0.0} );
+            simd_charges[ii] = MakeSimd(ca);                
+          }
+
+        simd_dipoles.SetSize( (dipoles.Size()+FMM_SW-1)/FMM_SW);
+        i = 0, ii = 0;
+        for ( ; i+FMM_SW <= dipoles.Size(); i+=FMM_SW, ii++)
+          {
+            std::array<tuple<Vec<3>,Vec<3>,entry_type>, FMM_SW> di;
+            for (int j = 0; j < FMM_SW; j++) di[j] = dipoles[i+j];
+            simd_dipoles[ii] = MakeSimd(di);
+          }
+        if (i < dipoles.Size())
+          {
+            std::array<tuple<Vec<3>,Vec<3>,entry_type>, FMM_SW> di;
+            int j = 0;
+            for ( ; i+j < dipoles.Size(); j++) di[j] = dipoles[i+j];
+            for ( ; j < FMM_SW; j++) di[j] = tuple( get<0>(di[0]), get<1>(di[0]), entry_type{0.0} );
+            simd_dipoles[ii] = MakeSimd(di);
+          }
+
+
+        simd_chargedipoles.SetSize( (chargedipoles.Size()+FMM_SW-1)/FMM_SW);
+        i = 0, ii = 0;
+        for ( ; i+FMM_SW <= chargedipoles.Size(); i+=FMM_SW, ii++)
+          {
+            std::array<tuple<Vec<3>,entry_type,Vec<3>,entry_type>, FMM_SW> di;
+            for (int j = 0; j < FMM_SW; j++) di[j] = chargedipoles[i+j];
+            simd_chargedipoles[ii] = MakeSimd(di);
+          }
+        if (i < chargedipoles.Size())
+          {
+            std::array<tuple<Vec<3>,entry_type,Vec<3>,entry_type>, FMM_SW> di;
+            int j = 0;
+            for ( ; i+j < chargedipoles.Size(); j++) di[j] = chargedipoles[i+j];
+            for ( ; j < FMM_SW; j++) di[j] = tuple( get<0>(di[0]), entry_type{0.0}, get<2>(di[0]), entry_type{0.0} );
+            simd_chargedipoles[ii] = MakeSimd(di);
+          }
+      }
+
       void CalcMP(Array<RecordingSS> * recording, Array<Node*> * nodes_to_process)
       {
         // mp.SH().Coefs() = 0.0;
@@ -1168,60 +1224,8 @@ namespace ngsbem
                 return;
               }
 
-            // make simd charges, comment this block for testing ...
-            simd_charges.SetSize( (charges.Size()+FMM_SW-1)/FMM_SW);
-            size_t i = 0, ii = 0;
-            for ( ; i+FMM_SW <= charges.Size(); i+=FMM_SW, ii++)
-              {
-                std::array<tuple<Vec<3>,entry_type>, FMM_SW> ca;
-                for (int j = 0; j < FMM_SW; j++) ca[j] = charges[i+j];
-                simd_charges[ii] = MakeSimd(ca);
-              }
-            if (i < charges.Size())
-              {
-                std::array<tuple<Vec<3>,entry_type>, FMM_SW> ca;
-                int j = 0;
-                for ( ; i+j < charges.Size(); j++) ca[j] = charges[i+j];
-                for ( ; j < FMM_SW; j++) ca[j] = tuple( get<0>(ca[0]), entry_type{0.0} );
-                simd_charges[ii] = MakeSimd(ca);                
-              }
-
-            simd_dipoles.SetSize( (dipoles.Size()+FMM_SW-1)/FMM_SW);
-            i = 0, ii = 0;
-            for ( ; i+FMM_SW <= dipoles.Size(); i+=FMM_SW, ii++)
-              {
-                std::array<tuple<Vec<3>,Vec<3>,entry_type>, FMM_SW> di;
-                for (int j = 0; j < FMM_SW; j++) di[j] = dipoles[i+j];
-                simd_dipoles[ii] = MakeSimd(di);
-              }
-            if (i < dipoles.Size())
-              {
-                std::array<tuple<Vec<3>,Vec<3>,entry_type>, FMM_SW> di;
-                int j = 0;
-                for ( ; i+j < dipoles.Size(); j++) di[j] = dipoles[i+j];
-                for ( ; j < FMM_SW; j++) di[j] = tuple( get<0>(di[0]), get<1>(di[0]), entry_type{0.0} );
-                simd_dipoles[ii] = MakeSimd(di);
-              }
-
-
-            simd_chargedipoles.SetSize( (chargedipoles.Size()+FMM_SW-1)/FMM_SW);
-            i = 0, ii = 0;
-            for ( ; i+FMM_SW <= chargedipoles.Size(); i+=FMM_SW, ii++)
-              {
-                std::array<tuple<Vec<3>,entry_type,Vec<3>,entry_type>, FMM_SW> di;
-                for (int j = 0; j < FMM_SW; j++) di[j] = chargedipoles[i+j];
-                simd_chargedipoles[ii] = MakeSimd(di);
-              }
-            if (i < chargedipoles.Size())
-              {
-                std::array<tuple<Vec<3>,entry_type,Vec<3>,entry_type>, FMM_SW> di;
-                int j = 0;
-                for ( ; i+j < chargedipoles.Size(); j++) di[j] = chargedipoles[i+j];
-                for ( ; j < FMM_SW; j++) di[j] = tuple( get<0>(di[0]), entry_type{0.0}, get<2>(di[0]), entry_type{0.0} );
-                simd_chargedipoles[ii] = MakeSimd(di);
-              }
+            MakeSimdSources();
 
-            
             if (nodes_to_process)
                 *nodes_to_process += this;
             else {
@@ -1322,8 +1326,25 @@ namespace ngsbem
     FMM_Parameters fmm_params;
     Node root;    
     bool havemp = false;
+
+    // translation plan of the tree, kept for calls with new source values
+    bool have_recording = false;
+    bool sources_reset = false;
+    size_t recording_version = 0;   // changes whenever the plan is recorded
+    Array<RecordingSS> recording;
+    Array<Node*> nodes_to_process;
+    Array<Array<RecordingSS*>> batch_group;
+    Array<double> group_lengths;
+    Array<double> group_thetas;
+
+    // sources held by other processes: multipoles received as single nodes,
+    // and trees of sources received directly
+    Array<unique_ptr<Node>> remote_nodes;
+    Array<shared_ptr<SingularMLExpansion>> remote_trees;
     
   public:
+    typedef Node T_Node;
+    
     SingularMLExpansion (Vec<3> center, double r, T_Kappa kappa, FMM_Parameters _params = FMM_Parameters())
       : fmm_params(_params), root(center, r, 0, kappa, fmm_params)
     {
@@ -1332,6 +1353,59 @@ namespace ngsbem
     }
 
     T_Kappa Kappa() const { return root.mp.Kappa(); }
+
+    /*
+      Removes all sources and expansion coefficients, but keeps the tree.
+      Adding sources at the same positions again, CalcMP reuses the
+      recorded translations.
+    */
+    void ResetSources()
+    {
+      root.TraverseTree( [&](Node & node) {
+        node.charges.SetSize0();
+        node.dipoles.SetSize0();
+        node.chargedipoles.SetSize0();
+        node.currents.SetSize0();
+        node.mp.SH().Coefs() = 0.0;
+      });
+      for (auto & node : remote_nodes)
+        node->mp.SH().Coefs() = 0.0;
+      for (auto & tree : remote_trees)
+        tree->ResetSources();
+      havemp = false;
+      sources_reset = true;
+    }
+
+    const Node & Root() const { return root; }
+
+    // changes whenever the S->S plan, or the remote expansions change
+    size_t RecordingVersion() const
+    {
+      size_t version = recording_version + remote_nodes.Size();
+      for (auto & tree : remote_trees)
+        version += tree->RecordingVersion();
+      return version;
+    }
+
+    /*
+      Multipole expansion of sources on another process, centered at a
+      node of its tree. The coefficients are set by the caller after CalcMP
+      of the remote tree, the node takes part in the S->R translations.
+    */
+    Node & AddRemoteNode (Vec<3> center, double r)
+    {
+      remote_nodes.Append (make_unique<Node> (center, r, 0, Kappa(), fmm_params));
+      return *remote_nodes.Last();
+    }
+
+    /*
+      Sources of other processes close to the local targets.
+      CalcMP of the remote tree is called by the owner.
+    */
+    void AddRemoteTree (shared_ptr<SingularMLExpansion> tree)
+    {
+      remote_trees.Append (tree);
+    }
     
     void AddCharge(Vec<3> x, entry_type c)
     {
@@ -1407,19 +1481,35 @@ namespace ngsbem
       
       root.CalcTotalSources();
 
+      if (!sources_reset && have_recording)
+        {
+          // sources were added to the tree, record again
+          have_recording = false;
+          recording.SetSize0();
+          nodes_to_process.SetSize0();
+          batch_group.SetSize0();
+          group_lengths.SetSize0();
+          group_thetas.SetSize0();
+        }
+      sources_reset = false;
+
       if constexpr (false)
         // direct evaluation of S->S
         root.CalcMP(nullptr, nullptr);
       else
         {
           
-          Array<RecordingSS> recording;
-          Array<Node*> nodes_to_process;
-
-          {
-            RegionTimer reg(trec);
-            root.CalcMP(&recording, &nodes_to_process);
-          }
+          if (!have_recording)
+            {
+              RegionTimer reg(trec);
+              root.CalcMP(&recording, &nodes_to_process);
+            }
+          else
+            // same tree, only new source values
+            ParallelFor(nodes_to_process.Size(), [&](int i)
+            {
+              nodes_to_process[i]->MakeSimdSources();
+            }, TasksPerThread(4));
       
           {
             RegionTimer rs2mp(ts2mp);
@@ -1437,43 +1527,45 @@ namespace ngsbem
             }, TasksPerThread(4));
           }
           
-          {
-            RegionTimer reg(tsort);
-            QuickSort (recording, [] (auto & a, auto & b)
+          if (!have_recording)
             {
-              if (a.len < (1-1e-8) * b.len) return true;
-              if (a.len > (1+1e-8) * b.len) return false;
-              return a.theta < b.theta;
-            });
-          }
+              {
+                RegionTimer reg(tsort);
+                QuickSort (recording, [] (auto & a, auto & b)
+                {
+                  if (a.len < (1-1e-8) * b.len) return true;
+                  if (a.len > (1+1e-8) * b.len) return false;
+                  return a.theta < b.theta;
+                });
+              }
       
-          double current_len = -1e100;
-          double current_theta = -1e100;
-          Array<RecordingSS*> current_batch;
-          Array<Array<RecordingSS*>> batch_group;
-          Array<double> group_lengths;
-          Array<double> group_thetas;
-          for (auto & record : recording)
-            {
-              bool len_changed = fabs(record.len - current_len) > 1e-8;
-              bool theta_changed = fabs(record.theta - current_theta) > 1e-8;
-              if ((len_changed || theta_changed) && current_batch.Size() > 0) {
+              double current_len = -1e100;
+              double current_theta = -1e100;
+              Array<RecordingSS*> current_batch;
+              for (auto & record : recording)
+                {
+                  bool len_changed = fabs(record.len - current_len) > 1e-8;
+                  bool theta_changed = fabs(record.theta - current_theta) > 1e-8;
+                  if ((len_changed || theta_changed) && current_batch.Size() > 0) {
+                    batch_group.Append(current_batch);
+                    group_lengths.Append(current_len);
+                    group_thetas.Append(current_theta);
+                    current_batch.SetSize(0);
+                  }
+              
+                  current_len = record.len;
+                  current_theta = record.theta;
+                  current_batch.Append(&record);
+                }
+          
+              if (current_batch.Size() > 0) {
                 batch_group.Append(current_batch);
                 group_lengths.Append(current_len);
                 group_thetas.Append(current_theta);
-                current_batch.SetSize(0);
               }
-              
-              current_len = record.len;
-              current_theta = record.theta;
-              current_batch.Append(&record);
+              have_recording = true;
+              recording_version++;
             }
-          
-          if (current_batch.Size() > 0) {
-            batch_group.Append(current_batch);
-            group_lengths.Append(current_len);
-            group_thetas.Append(current_theta);
-          }
 
           {
             RegionTimer rS2S(tS2S);
@@ -2079,6 +2171,24 @@ namespace ngsbem
     FMM_Parameters fmm_params;
     Node root;
     shared_ptr<SingularMLExpansion<elem_type,T_Kappa>> singmp;
+
+    // S->R translations, kept for calls with the same singular expansion
+    bool have_recording = false;
+    size_t singmp_version = 0;
+    Array<RecordingRS> recording;
+    Array<Array<RecordingRS*>> batch_group;
+    Array<double> group_lengths;
+    Array<double> group_thetas;
+
+    // local and remote singular expansions
+    void AddSingularNodes (bool allow_refine, Array<RecordingRS> * rec)
+    {
+      root.AddSingularNode(singmp->root, allow_refine, rec);
+      for (auto & node : singmp->remote_nodes)
+        root.AddSingularNode(*node, allow_refine, rec);
+      for (auto & tree : singmp->remote_trees)
+        root.AddSingularNode(tree->root, allow_refine, rec);
+    }
     
   public:
   RegularMLExpansion (shared_ptr<SingularMLExpansion<elem_type,T_Kappa>> asingmp, Vec<3> center, double r,
@@ -2092,7 +2202,7 @@ namespace ngsbem
       nodes_on_level[0] = 1;
       {
         static Timer t("mptool compute regular MLMP"); RegionTimer rg(t);
-        root.AddSingularNode(singmp->root, true, nullptr);
+        AddSingularNodes(true, nullptr);
         // cout << "norm after S->R conversion: " << root.Norm() << endl;
       }
 
@@ -2136,9 +2246,28 @@ namespace ngsbem
       static Timer tremove("removeempty");
       static Timer trec("mptool regular MLMP - recording");
       static Timer tsort("mptool regular MLMP - sort");       
+      static Timer tloc("mptool regular localize expansion");
       
-      singmp = asingmp;
+      if (have_recording && onlytargets && asingmp == singmp &&
+          singmp->RecordingVersion() == singmp_version)
+        {
+          // same trees, only new coefficients of the singular expansion
+          root.AllocateMemory();
+          ParallelFor(batch_group.Size(), [&](int i) {
+            ProcessBatchRS(batch_group[i], group_lengths[i], group_thetas[i]);
+          }, TasksPerThread(4));
 
+          RegionTimer rloc(tloc);
+          root.LocalizeExpansion(!onlytargets);
+          return;
+        }
+
+      singmp = asingmp;
+      recording.SetSize0();
+      batch_group.SetSize0();
+      group_lengths.SetSize0();
+      group_thetas.SetSize0();
+      root.TraverseTree( [&](Node & node) { node.singnodes.SetSize0(); });
       
       root.CalcTotalTargets();
       // cout << "before remove empty trees:" << endl;
@@ -2166,10 +2295,9 @@ namespace ngsbem
         }
       else
         {  // use recording
-          Array<RecordingRS> recording;
           {
             RegionTimer rrec(trec);
-            root.AddSingularNode(singmp->root, !onlytargets, &recording);
+            AddSingularNodes(!onlytargets, &recording);
           }
           
           // cout << "recorded: " << recording.Size() << endl;
@@ -2186,9 +2314,6 @@ namespace ngsbem
           double current_len = -1e100;
           double current_theta = -1e100;
           Array<RecordingRS*> current_batch;
-          Array<Array<RecordingRS*>> batch_group;
-          Array<double> group_lengths;
-          Array<double> group_thetas;
           for (auto & record : recording)
             {
               bool len_changed = fabs(record.len - current_len) > 1e-8;
@@ -2215,6 +2340,9 @@ namespace ngsbem
           ParallelFor(batch_group.Size(), [&](int i) {
             ProcessBatchRS(batch_group[i], group_lengths[i], group_thetas[i]);
           }, TasksPerThread(4));
+          // the refined tree depends on the coefficients, don't reuse it
+          have_recording = onlytargets;
+          singmp_version = singmp->RecordingVersion();
         }
           
       
@@ -2230,7 +2358,7 @@ namespace ngsbem
       // cout << "starting R-R converion" << endl;
       // PrintStatistics(cout);
       
-      static Timer tloc("mptool regular localize expansion"); RegionTimer rloc(tloc);
+      RegionTimer rloc(tloc);
       root.LocalizeExpansion(!onlytargets);
 
 
@@ -1,9 +1,10 @@
 #include <solve.hpp>        // everything from ngsolve
 #include <cmath>
+#include <unordered_map>
 
 #include "intrules_SauterSchwab.hpp"
 #include "ngbem.hpp"
-// #include "hmat.hpp"
+#include "hmat.hpp"
 #include "fmmoperator.hpp"
 
 
@@ -19,6 +20,14 @@ namespace ngsbem
 
     fmm_maxdirect = int(flags.GetNumFlag("fmm_maxdirect", fmm_maxdirect));
     fmm_minorder = int(flags.GetNumFlag("fmm_minorder", fmm_minorder));
+
+    auto use_hmatrix_flag = flags.GetDefineFlagX("use_hmatrix");
+    if (use_hmatrix_flag.IsTrue()) use_hmatrix = true;
+    if (use_hmatrix_flag.IsFalse()) use_hmatrix = false;
+
+    hmatrix_eps = flags.GetNumFlag("hmatrix_eps", hmatrix_eps);
+    hmatrix_eta = flags.GetNumFlag("hmatrix_eta", hmatrix_eta);
+    hmatrix_leafsize = int(flags.GetNumFlag("hmatrix_leafsize", hmatrix_leafsize));
   }
   
   
@@ -48,6 +57,59 @@ namespace ngsbem
     tie(identic_panel_x, identic_panel_y, identic_panel_weight) = IdenticPanelIntegrationRule(intorder);
     tie(common_vertex_x, common_vertex_y, common_vertex_weight) = CommonVertexIntegrationRule(intorder);
     tie(common_edge_x, common_edge_y, common_edge_weight) = CommonEdgeIntegrationRule(intorder);
+
+    auto setup_rule = [] (FlatArray<Vec<2>> ptsx, FlatArray<Vec<2>> ptsy, FlatArray<double> weight,
+                          const int * vpermx, const int * vpermy, SingularRule & rule)
+    {
+      auto permute = [] (Vec<2> p, const int * vperm)
+      {
+        if (!vperm) return p;
+        Vec<3> lam (1-p(0)-p(1), p(0), p(1) );
+        Vec<3> plam;
+        for (int i = 0; i < 3; i++)
+          plam(vperm[i]) = lam(i);
+        return Vec<2> (plam(0), plam(1));
+      };
+
+      constexpr int BS = 128;
+      for (size_t k = 0; k < weight.Size(); k+=BS)
+        {
+          size_t num = std::min(size_t(BS), weight.Size()-k);
+          IntegrationRule irx, iry;
+          for (size_t k2 = 0; k2 < num; k2++)
+            {
+              Vec<2> xk = permute(ptsx[k+k2], vpermx);
+              Vec<2> yk = permute(ptsy[k+k2], vpermy);
+              irx.Append (IntegrationPoint(xk(0), xk(1), 0, weight[k+k2]));
+              iry.Append (IntegrationPoint(yk(0), yk(1), 0, 0));
+            }
+          rule.irx.Append (make_unique<SIMD_IntegrationRule>(irx));
+          rule.iry.Append (make_unique<SIMD_IntegrationRule>(iry));
+        }
+    };
+
+    setup_rule (identic_panel_x, identic_panel_y, identic_panel_weight, nullptr, nullptr, identic_panel_rule);
+
+    const EDGE * edges = ElementTopology::GetEdges (ET_TRIG); // 0 1 | 1 2 | 2 0
+    for (int cex = 0; cex < 3; cex++)
+      for (int cey = 0; cey < 3; cey++)
+        {
+          int vpermx[3] = { edges[cex][0], edges[cex][1], -1 }; // common edge gets first
+          vpermx[2] = 3-vpermx[0]-vpermx[1];
+          int vpermy[3] = { edges[cey][1], edges[cey][0], -1 }; // common edge gets first
+          vpermy[2] = 3-vpermy[0]-vpermy[1];
+          setup_rule (common_edge_x, common_edge_y, common_edge_weight, vpermx, vpermy,
+                      common_edge_rule[cex][cey]);
+        }
+
+    for (int cvx = 0; cvx < 3; cvx++)
+      for (int cvy = 0; cvy < 3; cvy++)
+        {
+          int vpermx[3] = { cvx, (cvx+1)%3, (cvx+2)%3 };
+          int vpermy[3] = { cvy, (cvy+1)%3, (cvy+2)%3 };
+          setup_rule (common_vertex_x, common_vertex_y, common_vertex_weight, vpermx, vpermy,
+                      common_vertex_rule[cvx][cvy]);
+        }
   }
 
 
@@ -230,14 +292,50 @@ namespace ngsbem
       return diagmat*evalx;
     };
 
-    auto evalx = create_eval(*trial_space, compress_trial_els, *trial_evaluator);
-    auto evaly = create_eval(*test_space, compress_test_els, *test_evaluator);    
-    auto fmmop = make_shared<FMM_Operator<KERNEL>> (kernel, std::move(xpts), std::move(ypts),
+    // far field of the point kernel: H-matrix or FMM,
+    // without compression the whole matrix is assembled as nearfield
+    bool parallel = trial_space->IsParallel();
+    bool compress = io_params.UseFMM() || io_params.UseHMatrix() || trial_mesh != test_mesh || parallel;
+    shared_ptr<BaseMatrix> farfield;
+    if (io_params.UseHMatrix())
+      {
+        if (parallel)
+          throw Exception("H-matrix not available for distributed meshes, use the FMM");
+        HMatrix_Parameters hmat_params;
+        hmat_params.eps = io_params.HMatrixEps();
+        hmat_params.eta = io_params.HMatrixEta();
+        hmat_params.leafsize = io_params.HMatrixLeafSize();
+        farfield = CreateKernelHMatrix (kernel, xpts, ypts, xnv, ynv, hmat_params);
+      }
+#ifdef PARALLEL
+    else if (parallel)
+      farfield = make_shared<Distributed_FMM_Operator<KERNEL>> (kernel, std::move(xpts), std::move(ypts),
+                                                                std::move(xnv), std::move(ynv), io_params,
+                                                                trial_mesh->GetCommunicator());
+#endif
+    else if (compress)
+      farfield = make_shared<FMM_Operator<KERNEL>> (kernel, std::move(xpts), std::move(ypts),
                                                     std::move(xnv), std::move(ynv), io_params);
 
+    shared_ptr<BaseMatrix> farfield_op;
+    if (compress)
+      {
+        auto evalx = create_eval(*trial_space, compress_trial_els, *trial_evaluator);
+        auto evaly = create_eval(*test_space, compress_test_els, *test_evaluator);    
+        farfield_op = TransposeOperator(evaly) * farfield * evalx;
+      }
+
+    // local points on every process, the nearfield contains the local element pairs,
+    // the ghost nearfield the pairs across processes: a cumulated vector is mapped to a distributed one
+    auto distribute = [&] (shared_ptr<BaseMatrix> mat) -> shared_ptr<BaseMatrix>
+    {
+      if (!parallel) return mat;
+      return make_shared<ParallelMatrix> (mat, trial_space->GetParallelDofs(),
+                                          test_space->GetParallelDofs(), C2D);
+    };
 
     if (trial_mesh != test_mesh)
-      return TransposeOperator(evaly) * fmmop * evalx;
+      return distribute(farfield_op);
 
     
     // **************   nearfield operator *****************
@@ -271,7 +369,7 @@ namespace ngsbem
         }
 
 
-    if (!io_params.UseFMM())
+    if (!compress)
       {
         pairs.SetSize0();
         for (ElementId ei : trial_mesh->Elements(BND))
@@ -320,104 +418,797 @@ namespace ngsbem
     tsetupgraph.Stop();
     tassemble.Start();
     nearfield_correction->SetZero();
+    nearfield = nearfield_correction;
+    compressed = compress;
 
 
 
-    TableCreator<int> create_nbels(trial_mesh->GetNE(BND));
+    // neighbours by test element. Elements of one colour of the test space share no dofs,
+    // so their rows of the nearfield matrix are assembled concurrently without atomics
+    TableCreator<int> create_nbels(test_mesh->GetNE(BND));
     for ( ; !create_nbels.Done(); create_nbels++)    
       for (auto i : Range(pairs))
-        create_nbels.Add (get<0>(pairs[i]), get<1>(pairs[i]));
+        create_nbels.Add (get<1>(pairs[i]), get<0>(pairs[i]));
     Table<int> nbels = create_nbels.MoveTable();
 
-    trial_mesh->IterateElements
-      (BND, lh, [&](auto ei_trial, LocalHeap & lh)
+    bool atomic = test_space->HasAtomicDofs();
+    LocalHeap & clh = lh;
+    for (FlatArray<int> els_of_col : test_space->ElementColoring(BND))
       {
-        for (auto nrtest : nbels[ei_trial.Nr()])
+        SharedLoop2 sl(els_of_col.Range());
+        ParallelJob
+          ( [&] (const TaskInfo & ti)
           {
-            HeapReset hr(lh);            
-            ElementId ei_test(BND, nrtest);
-            
-            auto & trial_trafo = trial_mesh -> GetTrafo(ei_trial, lh);
-            auto & test_trafo = test_mesh -> GetTrafo(ei_test, lh);
-            auto & trial_fel = trial_space->GetFE(ei_trial, lh);
-            auto & test_fel = test_space->GetFE(ei_test, lh);
-            
-            Array<DofId> trial_dnums(trial_fel.GetNDof(), lh);
-            Array<DofId> test_dnums(test_fel.GetNDof(), lh);
-            
-            trial_space->GetDofNrs (ei_trial, trial_dnums);        
-            test_space->GetDofNrs (ei_test, test_dnums);
-            
-            FlatMatrix<value_type> elmat(test_dnums.Size(), trial_dnums.Size(), lh);
-            // tassSS.Start();
-            CalcElementMatrix (elmat, ei_trial, ei_test, lh);
-            // tassSS.Stop();
-            // tasscorr.Start();        
-            
-            // subtract terms from fmm:
-            
-            MappedIntegrationRule<2,3> trial_mir(ir, trial_trafo, lh);
-            MappedIntegrationRule<2,3> test_mir(ir, test_trafo, lh);
-            
-            FlatMatrix<> shapesi(test_fel.GetNDof(), test_evaluator->Dim()*ir.Size(), lh);
-            FlatMatrix<> shapesj(trial_fel.GetNDof(), trial_evaluator->Dim()*ir.Size(), lh);
-            // shapesi = 0.;
-            // shapesj = 0.;
-
-            IntRange test_range = test_evaluator->UsedDofs(test_fel);  
-            IntRange trial_range = trial_evaluator->UsedDofs(trial_fel);  
-            
-            test_evaluator -> CalcMatrix(test_fel, test_mir, Trans(shapesi), lh);
-            trial_evaluator-> CalcMatrix(trial_fel, trial_mir, Trans(shapesj), lh);
-            
-            for (auto term : kernel.terms)
+            LocalHeap lh = clh.Split(ti.thread_nr, ti.nthreads);
+            for (int mynr : sl)
               {
+                ElementId ei_test(BND, els_of_col[mynr]);
+                if (nbels[ei_test.Nr()].Size() == 0) continue;
                 HeapReset hr(lh);
-                FlatMatrix<value_type> kernel_ixiy(ir.Size(), ir.Size(), lh);
-                for (int ix = 0; ix < ir.Size(); ix++)
+
+                // test element part of the fmm correction, shared by all neighbours
+                auto & test_trafo = test_mesh -> GetTrafo(ei_test, lh);
+                auto & test_fel = test_space->GetFE(ei_test, lh);
+                Array<DofId> test_dnums(test_fel.GetNDof(), lh);
+                test_space->GetDofNrs (ei_test, test_dnums);
+                IntRange test_range = test_evaluator->UsedDofs(test_fel);  
+
+                MappedIntegrationRule<2,3> test_mir(ir, test_trafo, lh);
+                FlatMatrix<> shapesi(test_fel.GetNDof(), test_evaluator->Dim()*ir.Size(), lh);
+                test_evaluator -> CalcMatrix(test_fel, test_mir, Trans(shapesi), lh);
+
+                for (auto nrtrial : nbels[ei_test.Nr()])
                   {
-                    for (int iy = 0; iy < ir.Size(); iy++)
+                    HeapReset hr(lh);
+                    ElementId ei_trial(BND, nrtrial);
+
+                    auto & trial_trafo = trial_mesh -> GetTrafo(ei_trial, lh);
+                    auto & trial_fel = trial_space->GetFE(ei_trial, lh);
+                    Array<DofId> trial_dnums(trial_fel.GetNDof(), lh);
+                    trial_space->GetDofNrs (ei_trial, trial_dnums);
+            
+                    FlatMatrix<value_type> elmat(test_dnums.Size(), trial_dnums.Size(), lh);
+                    CalcElementMatrix (elmat, ei_trial, ei_test, lh);
+
+                    // subtract terms from fmm:
+                    if (compress)
                       {
-                        Vec<3> x = test_mir[ix].GetPoint();
-                        Vec<3> y = trial_mir[iy].GetPoint();
+                        MappedIntegrationRule<2,3> trial_mir(ir, trial_trafo, lh);
+                        FlatMatrix<> shapesj(trial_fel.GetNDof(), trial_evaluator->Dim()*ir.Size(), lh);
+                        IntRange trial_range = trial_evaluator->UsedDofs(trial_fel);  
+                        trial_evaluator-> CalcMatrix(trial_fel, trial_mir, Trans(shapesj), lh);
+            
+                        for (auto term : kernel.terms)
+                          {
+                            HeapReset hr(lh);
+                            FlatMatrix<value_type> kernel_ixiy(ir.Size(), ir.Size(), lh);
+                            for (int ix = 0; ix < ir.Size(); ix++)
+                              {
+                                for (int iy = 0; iy < ir.Size(); iy++)
+                                  {
+                                    Vec<3> x = test_mir[ix].GetPoint();
+                                    Vec<3> y = trial_mir[iy].GetPoint();
                         
-                        Vec<3> nx = test_mir[ix].GetNV();
-                        Vec<3> ny = trial_mir[iy].GetNV();
-                        value_type kernel_ = 0.0;
-                        if (L2Norm2(x-y) > 0)
-                          kernel_ = kernel.Evaluate(x, y, nx, ny)(term.kernel_comp);
+                                    Vec<3> nx = test_mir[ix].GetNV();
+                                    Vec<3> ny = trial_mir[iy].GetNV();
+                                    value_type kernel_ = 0.0;
+                                    if (L2Norm2(x-y) > 0)
+                                      kernel_ = kernel.Evaluate(x, y, nx, ny)(term.kernel_comp);
                         
-                        double fac = test_mir[ix].GetWeight()*trial_mir[iy].GetWeight();
-                        kernel_ixiy(ix, iy) = term.fac*fac*kernel_;
-                      }
-                  }
+                                    double fac = test_mir[ix].GetWeight()*trial_mir[iy].GetWeight();
+                                    kernel_ixiy(ix, iy) = term.fac*fac*kernel_;
+                                  }
+                              }
                 
-                FlatMatrix<value_type> kernel_shapesj(ir.Size(), trial_fel.GetNDof(), lh);
-                FlatMatrix<> shapesi1(test_fel.GetNDof(), ir.Size(), lh);
-                FlatMatrix<> shapesj1(trial_fel.GetNDof(), ir.Size(), lh);
+                            FlatMatrix<value_type> kernel_shapesj(ir.Size(), trial_fel.GetNDof(), lh);
+                            FlatMatrix<> shapesi1(test_fel.GetNDof(), ir.Size(), lh);
+                            FlatMatrix<> shapesj1(trial_fel.GetNDof(), ir.Size(), lh);
                 
-                for (int j = 0; j < ir.Size(); j++)
-                  {
-                    shapesi1.Col(j) = shapesi.Col(test_evaluator->Dim()*j+term.test_comp);
-                    shapesj1.Col(j) = shapesj.Col(trial_evaluator->Dim()*j+term.trial_comp);
+                            for (int j = 0; j < ir.Size(); j++)
+                              {
+                                shapesi1.Col(j) = shapesi.Col(test_evaluator->Dim()*j+term.test_comp);
+                                shapesj1.Col(j) = shapesj.Col(trial_evaluator->Dim()*j+term.trial_comp);
+                              }
+                            kernel_shapesj = kernel_ixiy * Trans(shapesj1);
+
+                            elmat.Rows(test_range).Cols(trial_range) -= shapesi1.Rows(test_range) * kernel_shapesj.Cols(trial_range);
+                          }
+                      }
+                    nearfield_correction -> AddElementMatrix (test_dnums, trial_dnums, elmat, atomic);
                   }
-                kernel_shapesj = kernel_ixiy * Trans(shapesj1);
-
-                if (io_params.UseFMM())
-                  elmat.Rows(test_range).Cols(trial_range) -= shapesi1.Rows(test_range) * kernel_shapesj.Cols(trial_range);
               }
-            // tasscorr.Stop();        
-            nearfield_correction -> AddElementMatrix (test_dnums, trial_dnums, elmat, true);
-          }
-      });
+          });
+      }
 
     
     tassemble.Stop();
-    if (io_params.UseFMM())
-      return TransposeOperator(evaly) * fmmop * evalx + nearfield_correction;
+    if (parallel)
+      return distribute(farfield_op + nearfield_correction + CreateGhostNearfield(lh));
+    if (compress)
+      return farfield_op + nearfield_correction;
     else
       return nearfield_correction;
   }
+
+
+#ifdef PARALLEL
+  /*
+    Nearfield of element pairs on different processes. The rows are the
+    local test dofs, the columns are copies of trial dofs of other
+    processes (ghost dofs). Mult receives the values of the ghost dofs
+    from their owners, MultTrans sends the results back to them.
+  */
+  template <typename T>
+  class GhostNearfieldMatrix : public BaseMatrix
+  {
+    NgMPI_Comm comm;
+    shared_ptr<SparseMatrix<T>> mat;   // local test dofs x ghost dofs
+    Table<int> send_dofs;              // local trial dofs, their values are sent to process p
+    Array<int> nsend;
+    Array<IntRange> ghost_range;       // ghost dofs received from process p
+    size_t height, width;
+  public:
+    GhostNearfieldMatrix (NgMPI_Comm _comm, shared_ptr<SparseMatrix<T>> _mat,
+                          Table<int> && _send_dofs, Array<IntRange> && _ghost_range,
+                          size_t _height, size_t _width)
+      : comm(_comm), mat(_mat), send_dofs(std::move(_send_dofs)),
+        ghost_range(std::move(_ghost_range)), height(_height), width(_width)
+    {
+      nsend.SetSize (send_dofs.Size());
+      for (auto p : Range(nsend))
+        nsend[p] = send_dofs[p].Size();
+    }
+
+    bool IsComplex() const override { return is_same<T,Complex>(); }
+    int VHeight() const override { return height; }
+    int VWidth() const override { return width; }
+    AutoVector CreateRowVector () const override { return make_unique<VVector<T>>(width); }
+    AutoVector CreateColVector () const override { return make_unique<VVector<T>>(height); }
+
+    void Mult (const BaseVector & x, BaseVector & y) const override
+    {
+      y = 0.0;
+      MultAdd (1, x, y);
+    }
+
+    void MultTrans (const BaseVector & x, BaseVector & y) const override
+    {
+      y = 0.0;
+      MultTransAdd (1, x, y);
+    }
+
+    void MultAdd (double s, const BaseVector & x, BaseVector & y) const override
+    {
+      static Timer t("ngbem ghost nearfield"); RegionTimer reg(t);
+      auto fx = x.FV<T>();
+      VVector<T> xg(mat->Width());
+      auto fxg = xg.FV();
+
+      Table<T> send_values(nsend);
+      NgMPI_Requests requests;
+      for (int p = 0; p < comm.Size(); p++)
+        {
+          for (auto [i,d] : Enumerate(send_dofs[p]))
+            send_values[p][i] = (d >= 0) ? fx(d) : T(0.0);
+          if (send_dofs[p].Size())
+            requests += comm.ISend (send_values[p], p, NG_MPI_TAG_SOLVE+2);
+          if (ghost_range[p].Size())
+            requests += comm.IRecv (FlatArray<T>(ghost_range[p].Size(), fxg.Data()+ghost_range[p].First()),
+                                    p, NG_MPI_TAG_SOLVE+2);
+        }
+      requests.WaitAll();
+      mat->MultAdd (s, xg, y);
+    }
+
+    void MultTransAdd (double s, const BaseVector & x, BaseVector & y) const override
+    {
+      static Timer t("ngbem ghost nearfield trans"); RegionTimer reg(t);
+      VVector<T> yg(mat->Width());
+      yg = 0.0;
+      mat->MultTransAdd (1, x, yg);
+      auto fyg = yg.FV();
+
+      Table<T> recv_values(nsend);
+      NgMPI_Requests requests;
+      for (int p = 0; p < comm.Size(); p++)
+        {
+          if (ghost_range[p].Size())
+            requests += comm.ISend (FlatArray<T>(ghost_range[p].Size(), fyg.Data()+ghost_range[p].First()),
+                                    p, NG_MPI_TAG_SOLVE+2);
+          if (send_dofs[p].Size())
+            requests += comm.IRecv (recv_values[p], p, NG_MPI_TAG_SOLVE+2);
+        }
+      requests.WaitAll();
+
+      auto fy = y.FV<T>();
+      for (int p = 0; p < comm.Size(); p++)
+        for (auto [i,d] : Enumerate(send_dofs[p]))
+          if (d >= 0)
+            fy(d) += s * recv_values[p][i];
+    }
+
+    BaseMatrix::OperatorInfo GetOperatorInfo () const override
+    {
+      return { "GhostNearfieldMatrix", this->Height(), this->Width() };
+    }
+  };
+#endif // PARALLEL
+
+
+  /*
+    Sauter-Schwab corrections for pairs of a local test element and a
+    trial element of another process sharing a vertex or an edge.
+    The owner of the trial element evaluates its geometry and shape
+    functions in the points of the singular rules and of the regular rule,
+    the block of the pair is computed by the owner of the test element.
+    Only the values of the trial dofs are exchanged in every Mult.
+  */
+  template <typename KERNEL>
+  shared_ptr<BaseMatrix> GenericIntegralOperator<KERNEL> ::
+  CreateGhostNearfield(LocalHeap & lh) const
+  {
+#ifdef PARALLEL
+    static Timer t("ngbem ghost nearfield setup"); RegionTimer reg(t);
+    auto mesh = trial_space->GetMeshAccess();
+    NgMPI_Comm comm = mesh->GetCommunicator();
+    int ntasks = comm.Size();
+    IntegrationRule ir(ET_TRIG, intorder);
+    constexpr int SW = SIMD<double>::Size();
+    int trial_dim = trial_evaluator->Dim();
+    int test_dim = test_evaluator->Dim();
+
+    auto is_trial = [&] (ElementId ei)
+    {
+      return trial_space->DefinedOn(ei) &&
+        (!trial_definedon || (*trial_definedon).Mask().Test(mesh->GetElIndex(ei)));
+    };
+    auto is_test = [&] (ElementId ei)
+    {
+      return test_space->DefinedOn(ei) &&
+        (!test_definedon || (*test_definedon).Mask().Test(mesh->GetElIndex(ei)));
+    };
+
+    // the trial points of the singular rules depend only on the common vertex or edge
+    // in the trial element: variants 0,1,2 for vertices, 3,4,5 for edges
+    auto trial_rule = [&] (int variant) -> const SingularRule &
+    {
+      return variant < 3 ? common_vertex_rule[0][variant] : common_edge_rule[0][variant-3];
+    };
+    auto rule_size = [&] (const SingularRule & rule)
+    {
+      size_t npts = 0;
+      for (auto & iry : rule.iry)
+        npts += iry->Size();
+      return npts;
+    };
+
+    Array<bool> is_neighbour(ntasks);
+    is_neighbour = false;
+    for (auto v : Range(mesh->GetNV()))
+      for (auto p : mesh->GetDistantProcs(NodeId(NT_VERTEX, v)))
+        is_neighbour[p] = true;
+
+    // trial elements at the interface to process p, and their global vertex numbers
+    TableCreator<int> creator_interface(ntasks);
+    Array<int> procs;
+    for ( ; !creator_interface.Done(); creator_interface++)
+      for (ElementId ei : mesh->Elements(BND))
+        if (is_trial(ei))
+          {
+            procs.SetSize0();
+            for (auto v : mesh->GetElement(ei).Vertices())
+              for (auto p : mesh->GetDistantProcs(NodeId(NT_VERTEX, v)))
+                if (!procs.Contains(p))
+                  procs.Append (p);
+            for (auto p : procs)
+              creator_interface.Add (p, ei.Nr());
+          }
+    Table<int> interface_els = creator_interface.MoveTable();
+
+    NgMPI_Requests requests_verts, requests_variants, requests_data;
+    Array<Array<int>> send_verts(ntasks);
+    for (int p = 0; p < ntasks; p++)
+      if (is_neighbour[p])
+        {
+          for (auto nr : interface_els[p])
+            for (auto v : mesh->GetElement(ElementId(BND, nr)).Vertices())
+              send_verts[p].Append (mesh->GetGlobalVertexNum(v));
+          requests_verts += comm.ISend (send_verts[p], p, NG_MPI_TAG_SOLVE);
+        }
+    Array<Array<int>> remote_verts(ntasks);
+    for (int p = 0; p < ntasks; p++)
+      if (is_neighbour[p])
+        comm.Recv (remote_verts[p], p, NG_MPI_TAG_SOLVE);
+    requests_verts.WaitAll();
+
+    std::unordered_map<int,int> glob2loc;
+    for (auto v : Range(mesh->GetNV()))
+      if (mesh->GetDistantProcs(NodeId(NT_VERTEX, v)).Size())
+        glob2loc[mesh->GetGlobalVertexNum(v)] = v;
+
+    // pairs of local test elements and remote trial elements with common vertices
+    struct GhostPair { int test_el, proc, remote_el, cx, variant; };
+    Array<GhostPair> pairs;
+    Array<Array<int>> variants(ntasks);     // requested variants of the remote elements, as bits
+    Array<int> candidates;
+    for (int p = 0; p < ntasks; p++)
+      {
+        variants[p].SetSize (remote_verts[p].Size()/3);
+        variants[p] = 0;
+        for (size_t j : Range(variants[p]))
+          {
+            FlatArray<int> vertj = remote_verts[p].Range(3*j, 3*j+3);
+            candidates.SetSize0();
+            for (auto gv : vertj)
+              if (auto pos = glob2loc.find(gv); pos != glob2loc.end())
+                for (auto ej : mesh->GetVertexElements(pos->second, BND))
+                  if (is_test(ElementId(BND, ej)) && !candidates.Contains(ej))
+                    candidates.Append (ej);
+
+            for (auto ej : candidates)
+              {
+                auto vert = mesh->GetElement(ElementId(BND, ej)).Vertices();
+                int verti[3];
+                for (int k = 0; k < 3; k++)
+                  verti[k] = mesh->GetGlobalVertexNum(vert[k]);
+                int n_common = 0, cx = -1, cy = -1;
+                for (int k = 0; k < 3; k++)
+                  if (vertj.Contains(verti[k]))
+                    n_common++;
+                if (n_common == 1)
+                  {
+                    for (int kx = 0; kx < 3; kx++)
+                      for (int ky = 0; ky < 3; ky++)
+                        if (verti[kx] == vertj[ky])
+                          { cx = kx; cy = ky; }
+                  }
+                else if (n_common == 2)
+                  {
+                    const EDGE * edges = ElementTopology::GetEdges (ET_TRIG);
+                    for (int kx = 0; kx < 3; kx++)
+                      for (int ky = 0; ky < 3; ky++)
+                        {
+                          IVec<2> ex (verti[edges[kx][0]], verti[edges[kx][1]]);
+                          IVec<2> ey (vertj[edges[ky][0]], vertj[edges[ky][1]]);
+                          if (ex.Sort() == ey.Sort())
+                            { cx = kx; cy = 3+ky; }
+                        }
+                  }
+                else
+                  throw Exception("ghost nearfield: element on two processes");
+                pairs.Append ( { ej, p, int(j), cx, cy } );
+                variants[p][j] |= 1 << cy;
+              }
+          }
+        if (is_neighbour[p])
+          requests_variants += comm.ISend (variants[p], p, NG_MPI_TAG_SOLVE);
+      }
+
+    // evaluate the requested trial elements
+    Array<Array<int>> send_header(ntasks);
+    Array<Array<double>> send_data(ntasks);
+    TableCreator<int> creator_send_dofs(ntasks);
+    Array<Array<int>> requested(ntasks);
+    for (int p = 0; p < ntasks; p++)
+      if (is_neighbour[p])
+        comm.Recv (requested[p], p, NG_MPI_TAG_SOLVE);
+    requests_variants.WaitAll();
+
+    for ( ; !creator_send_dofs.Done(); creator_send_dofs++)
+      for (int p = 0; p < ntasks; p++)
+        for (auto [j,mask] : Enumerate(requested[p]))
+          if (mask)
+            {
+              HeapReset hr(lh);
+              ElementId ei(BND, interface_els[p][j]);
+              Array<DofId> dnums;
+              trial_space->GetDofNrs (ei, dnums);
+              for (auto d : dnums)
+                creator_send_dofs.Add (p, IsRegularDof(d) ? int(d) : -1);
+            }
+    Table<int> send_dofs = creator_send_dofs.MoveTable();
+
+    for (int p = 0; p < ntasks; p++)
+      {
+        for (auto [j,mask] : Enumerate(requested[p]))
+          {
+            if (!mask) continue;
+            HeapReset hr(lh);
+            ElementId ei(BND, interface_els[p][j]);
+            auto & trafo = mesh->GetTrafo(ei, lh);
+            auto & fel = trial_space->GetFE(ei, lh);
+            IntRange range = trial_evaluator->UsedDofs(fel);
+            send_header[p].Append (fel.GetNDof());
+            send_header[p].Append (range.First());
+            send_header[p].Append (range.Next());
+            auto & data = send_data[p];
+
+            // regular rule, for the subtraction of the point kernel
+            MappedIntegrationRule<2,3> mir(ir, trafo, lh);
+            FlatMatrix<> shapes(fel.GetNDof(), trial_dim*ir.Size(), lh);
+            shapes = 0.0;
+            trial_evaluator->CalcMatrix(fel, mir, Trans(shapes), lh);
+            for (auto & mip : mir)
+              {
+                for (int k = 0; k < 3; k++) data.Append (mip.GetPoint()(k));
+                for (int k = 0; k < 3; k++) data.Append (mip.GetNV()(k));
+                data.Append (mip.GetWeight());
+              }
+            for (auto val : shapes.AsVector())
+              data.Append (val);
+
+            // singular rules
+            for (int variant = 0; variant < 6; variant++)
+              if (mask & (1 << variant))
+                for (auto & iry : trial_rule(variant).iry)
+                  {
+                    HeapReset hr(lh);
+                    SIMD_MappedIntegrationRule<2,3> miry(*iry, trafo, lh);
+                    FlatMatrix<SIMD<double>> mshapes(fel.GetNDof()*trial_dim, miry.Size(), lh);
+                    trial_evaluator->CalcMatrix(fel, miry, mshapes);
+                    auto append = [&data] (SIMD<double> val)
+                    {
+                      for (int l = 0; l < SW; l++)
+                        data.Append (val[l]);
+                    };
+                    for (size_t k2 = 0; k2 < miry.Size(); k2++)
+                      {
+                        for (int k = 0; k < 3; k++) append (miry[k2].Point()(k));
+                        for (int k = 0; k < 3; k++) append (miry[k2].GetNV()(k));
+                        append (miry[k2].GetMeasure());
+                      }
+                    for (auto val : mshapes.AsVector())
+                      append (val);
+                  }
+          }
+        if (is_neighbour[p])
+          {
+            requests_data += comm.ISend (send_header[p], p, NG_MPI_TAG_SOLVE);
+            requests_data += comm.ISend (send_data[p], p, NG_MPI_TAG_SOLVE);
+          }
+      }
+
+    // ghost dofs and data of the remote trial elements
+    struct GhostElement { int ndof; IntRange range; size_t first_ghost; size_t offset[7]; };
+    Array<Array<GhostElement>> ghost_els(ntasks);
+    Array<Array<double>> recv_data(ntasks);
+    Array<IntRange> ghost_range(ntasks);
+    size_t nghost = 0;
+    for (int p = 0; p < ntasks; p++)
+      {
+        Array<int> header;
+        if (is_neighbour[p])
+          {
+            comm.Recv (header, p, NG_MPI_TAG_SOLVE);
+            comm.Recv (recv_data[p], p, NG_MPI_TAG_SOLVE);
+          }
+        ghost_els[p].SetSize (variants[p].Size());
+        size_t first = nghost, offset = 0, cnt = 0;
+        for (auto [j,mask] : Enumerate(variants[p]))
+          {
+            if (!mask) continue;
+            auto & gel = ghost_els[p][j];
+            gel.ndof = header[3*cnt];
+            gel.range = IntRange(header[3*cnt+1], header[3*cnt+2]);
+            gel.first_ghost = nghost;
+            cnt++;
+            nghost += gel.ndof;
+
+            gel.offset[6] = offset;
+            offset += ir.Size() * (7 + gel.ndof*trial_dim);
+            for (int variant = 0; variant < 6; variant++)
+              if (mask & (1 << variant))
+                {
+                  gel.offset[variant] = offset;
+                  offset += SW * rule_size(trial_rule(variant)) * (7 + gel.ndof*trial_dim);
+                }
+          }
+        if (offset != recv_data[p].Size())
+          throw Exception("ghost nearfield: inconsistent data from process "+ToString(p));
+        ghost_range[p] = IntRange(first, nghost);
+      }
+    requests_data.WaitAll();
+
+
+    // assemble the blocks of the pairs
+    TableCreator<int> creator_rows(pairs.Size()), creator_cols(pairs.Size());
+    for ( ; !creator_rows.Done(); creator_rows++, creator_cols++)
+      for (auto i : Range(pairs))
+        {
+          Array<DofId> dnums;
+          test_space->GetDofNrs (ElementId(BND, pairs[i].test_el), dnums);
+          creator_rows.Add (i, dnums);
+          auto & gel = ghost_els[pairs[i].proc][pairs[i].remote_el];
+          for (auto k : Range(gel.ndof))
+            creator_cols.Add (i, int(gel.first_ghost+k));
+        }
+    Table<int> rows = creator_rows.MoveTable();
+    Table<int> cols = creator_cols.MoveTable();
+    auto ghostmat = make_shared<SparseMatrix<value_type>> (test_space->GetNDof(), nghost, rows, cols, false);
+    ghostmat->SetZero();
+
+    Vec<3> px, py, pnx, pny;
+    typedef decltype(kernel.Evaluate (px,py,pnx,pny)) KERNEL_COMPS_T;
+
+    for (auto i : Range(pairs))
+      {
+        HeapReset hr(lh);
+        auto [test_el, p, j, cx, variant] = pairs[i];
+        auto & gel = ghost_els[p][j];
+        ElementId ei_test(BND, test_el);
+        auto & trafoi = mesh->GetTrafo(ei_test, lh);
+        auto & feli = test_space->GetFE(ei_test, lh);
+        IntRange test_range = test_evaluator->UsedDofs(feli);
+        IntRange trial_range = gel.range;
+        int ndofj = gel.ndof;
+
+        FlatMatrix<value_type> elmat(feli.GetNDof(), ndofj, lh);
+        elmat = 0.0;
+
+        // singular rule, as Integrate4D with the trial side from the owner
+        const SingularRule & rule = variant < 3 ?
+          common_vertex_rule[cx][variant] : common_edge_rule[cx][variant-3];
+        const double * data = recv_data[p].Data() + gel.offset[variant];
+        for (size_t k = 0; k < rule.irx.Size(); k++)
+          {
+            HeapReset hr(lh);
+            const SIMD_IntegrationRule & simd_irx = *rule.irx[k];
+            SIMD_MappedIntegrationRule<2,3> mirx(simd_irx, trafoi, lh);
+            size_t npts = mirx.Size();
+
+            FlatMatrix<SIMD<double>> mshapesi(feli.GetNDof()*test_dim, npts, lh);
+            FlatMatrix<SIMD<value_type>> mshapesi_kern(feli.GetNDof(), npts, lh);
+            FlatMatrix<SIMD<double>> mshapesj(ndofj*trial_dim, npts, lh);
+            test_evaluator->CalcMatrix(feli, mirx, mshapesi);
+
+            FlatVector<Vec<KERNEL_COMPS_T::SIZE, SIMD<value_type>>> kernel_values(npts, lh);
+            for (size_t k2 = 0; k2 < npts; k2++, data += 7*SW)
+              {
+                Vec<3,SIMD<double>> x = mirx[k2].Point();
+                Vec<3,SIMD<double>> nx = mirx[k2].GetNV();
+                Vec<3,SIMD<double>> y, ny;
+                for (int l = 0; l < 3; l++)
+                  {
+                    y(l) = SIMD<double>(data+l*SW);
+                    ny(l) = SIMD<double>(data+(3+l)*SW);
+                  }
+                SIMD<double> measy(data+6*SW);
+                kernel_values(k2) = mirx[k2].GetMeasure()*measy*simd_irx[k2].Weight() *
+                  kernel.Evaluate(x, y, nx, ny);
+              }
+            for (auto & val : mshapesj.AsVector())
+              {
+                val = SIMD<double>(data);
+                data += SW;
+              }
+
+            for (auto term : kernel.terms)
+              {
+                auto mshapesi_comp = mshapesi.RowSlice(term.test_comp, test_dim);
+                for (size_t k2 = 0; k2 < npts; k2++)
+                  {
+                    SIMD<value_type> kernel_ = kernel_values(k2)(term.kernel_comp);
+                    mshapesi_kern.Col(k2) = term.fac*kernel_ * mshapesi_comp.Col(k2);
+                  }
+                AddABt (mshapesi_kern.Rows(test_range),
+                        mshapesj.RowSlice(term.trial_comp, trial_dim).AddSize(ndofj, npts).Rows(trial_range),
+                        elmat.Rows(test_range).Cols(trial_range));
+              }
+          }
+
+        // subtract the point kernel of the fmm
+        data = recv_data[p].Data() + gel.offset[6];
+        MappedIntegrationRule<2,3> mirx(ir, trafoi, lh);
+        FlatMatrix<> shapesi(feli.GetNDof(), test_dim*ir.Size(), lh);
+        test_evaluator->CalcMatrix(feli, mirx, Trans(shapesi), lh);
+        FlatMatrix<> shapesj(ndofj, trial_dim*ir.Size(), const_cast<double*>(data+7*ir.Size()));
+
+        for (auto term : kernel.terms)
+          {
+            HeapReset hr(lh);
+            FlatMatrix<value_type> kernel_ixiy(ir.Size(), ir.Size(), lh);
+            for (int ix = 0; ix < ir.Size(); ix++)
+              for (int iy = 0; iy < ir.Size(); iy++)
+                {
+                  const double * datay = data + 7*iy;
+                  Vec<3> x = mirx[ix].GetPoint();
+                  Vec<3> y(datay[0], datay[1], datay[2]);
+                  Vec<3> nx = mirx[ix].GetNV();
+                  Vec<3> ny(datay[3], datay[4], datay[5]);
+                  value_type kernel_ = 0.0;
+                  if (L2Norm2(x-y) > 0)
+                    kernel_ = kernel.Evaluate(x, y, nx, ny)(term.kernel_comp);
+                  kernel_ixiy(ix, iy) = term.fac*mirx[ix].GetWeight()*datay[6]*kernel_;
+                }
+
+            FlatMatrix<value_type> kernel_shapesj(ir.Size(), ndofj, lh);
+            FlatMatrix<> shapesi1(feli.GetNDof(), ir.Size(), lh);
+            FlatMatrix<> shapesj1(ndofj, ir.Size(), lh);
+            for (int k = 0; k < ir.Size(); k++)
+              {
+                shapesi1.Col(k) = shapesi.Col(test_dim*k+term.test_comp);
+                shapesj1.Col(k) = shapesj.Col(trial_dim*k+term.trial_comp);
+              }
+            kernel_shapesj = kernel_ixiy * Trans(shapesj1);
+            elmat.Rows(test_range).Cols(trial_range) -= shapesi1.Rows(test_range) * kernel_shapesj.Cols(trial_range);
+          }
+
+        ghostmat->AddElementMatrix (rows[i], cols[i], elmat);
+      }
+
+    return make_shared<GhostNearfieldMatrix<value_type>> (comm, ghostmat, std::move(send_dofs), std::move(ghost_range),
+                                                          test_space->GetNDof(), trial_space->GetNDof());
+#else
+    return nullptr;
+#endif
+  }
+
+
+
+  template <typename KERNEL>
+  shared_ptr<BaseMatrix> GenericIntegralOperator<KERNEL> ::
+  CreateHLU(double eps, bool cholesky) const
+  {
+    static Timer t("ngbem H-LU setup"); RegionTimer reg(t);
+    if (trial_space != test_space)
+      throw Exception("CreateHLU needs the same trial and test space");
+    if (trial_space->IsParallel())
+      throw Exception("CreateHLU not available for distributed meshes");
+    if (!nearfield)
+      throw Exception("CreateHLU: operator not assembled");
+
+    LocalHeap lh(10000000, "ngbem H-LU");
+    IntegrationRule ir(ET_TRIG, intorder);
+    auto mesh = trial_space->GetMeshAccess();
+    size_t ndof = trial_space->GetNDof();
+
+    Array<Vec<3>> bbmin(ndof), bbmax(ndof);
+    bbmin = Vec<3>(1e99, 1e99, 1e99);
+    bbmax = Vec<3>(-1e99, -1e99, -1e99);
+    Array<bool> used(ndof);
+    used = false;
+
+    /*
+      Same points as in CreateMatrixFMM, and for every dof the
+      weighted shape functions in these points, i.e. the columns of evalx and evaly.
+    */
+    auto collect = [&] (optional<Region> definedon, const DifferentialOperator & evaluator,
+                        Array<Vec<3>> & pts, Array<Vec<3>> & nv, Table<int> & dofpts, Table<double> & dofvals)
+    {
+      int dim = evaluator.Dim();
+      TableCreator<int> creator_pts(ndof);
+      TableCreator<double> creator_vals(ndof);
+      for ( ; !creator_pts.Done(); creator_pts++, creator_vals++)
+        {
+          pts.SetSize0();
+          nv.SetSize0();
+          int cnt = 0;
+          for (auto el : mesh->Elements(BND))
+            if (trial_space->DefinedOn(el))
+              if (!definedon || (*definedon).Mask().Test(mesh->GetElIndex(el)))
+                {
+                  HeapReset hr(lh);
+                  auto & trafo = mesh->GetTrafo(el, lh);
+                  MappedIntegrationRule<2,3> mir(ir, trafo, lh);
+                  auto & fel = trial_space->GetFE(el, lh);
+                  Array<DofId> dnums(fel.GetNDof(), lh);
+                  trial_space->GetDofNrs(el, dnums);
+
+                  FlatMatrix<> shapes(fel.GetNDof(), dim*ir.Size(), lh);
+                  evaluator.CalcMatrix(fel, mir, Trans(shapes), lh);
+
+                  for (auto & mip : mir)
+                    {
+                      pts.Append(mip.GetPoint());
+                      nv.Append(mip.GetNV());
+                    }
+
+                  for (auto k : evaluator.UsedDofs(fel))
+                    if (IsRegularDof(dnums[k]))
+                      {
+                        used[dnums[k]] = true;
+                        for (auto v : el.Vertices())
+                          {
+                            Vec<3> p = mesh->GetPoint<3>(v);
+                            for (int l = 0; l < 3; l++)
+                              {
+                                bbmin[dnums[k]](l) = min(bbmin[dnums[k]](l), p(l));
+                                bbmax[dnums[k]](l) = max(bbmax[dnums[k]](l), p(l));
+                              }
+                          }
+                        for (int j = 0; j < ir.Size(); j++)
+                          for (int c = 0; c < dim; c++)
+                            if (double val = mir[j].GetWeight()*shapes(k, dim*j+c); val != 0)
+                              {
+                                creator_pts.Add(dnums[k], ((cnt*ir.Size())+j)*dim+c);
+                                creator_vals.Add(dnums[k], val);
+                              }
+                      }
+                  cnt++;
+                }
+        }
+      dofpts = creator_pts.MoveTable();
+      dofvals = creator_vals.MoveTable();
+    };
+
+    Array<Vec<3>> xpts, ypts, xnv, ynv;
+    Table<int> trial_pts, test_pts;
+    Table<double> trial_vals, test_vals;
+    collect(trial_definedon, *trial_evaluator, xpts, xnv, trial_pts, trial_vals);
+    collect(test_definedon, *test_evaluator, ypts, ynv, test_pts, test_vals);
+
+    Array<int> dofs;
+    for (size_t i : Range(ndof))
+      if (used[i]) dofs.Append(i);
+
+    auto tree = make_shared<ClusterTree> (dofs, bbmin, bbmax, io_params.HMatrixLeafSize());
+    PointKernelEntries<KERNEL> pointkernel(kernel, xpts, ypts, xnv, ynv);
+
+    // entries = Trans(evaly) * pointkernel * evalx + nearfield
+    auto generator = [&] (FlatArray<int> rows, FlatArray<int> cols, SliceMatrix<value_type> block)
+    {
+      block = value_type(0.0);
+
+      Array<int> colpos(cols.Size());
+      for (int j : Range(colpos)) colpos[j] = j;
+      QuickSortI (cols, colpos);
+
+      for (size_t i : Range(rows))
+        {
+          auto ind = nearfield->GetRowIndices(rows[i]);
+          auto vals = nearfield->GetRowValues(rows[i]);
+          for (size_t k : Range(ind))
+            {
+              auto pos = std::lower_bound(colpos.Data(), colpos.Data()+colpos.Size(), ind[k],
+                                          [&](int j, int dof) { return cols[j] < dof; });
+              if (pos != colpos.Data()+colpos.Size() && cols[*pos] == ind[k])
+                block(i, *pos) += vals[k];
+            }
+        }
+
+      if (!compressed) return;
+
+      auto gather = [] (FlatArray<int> dofs, const Table<int> & dofpts, const Table<double> & dofvals,
+                        Array<int> & ptrows, Matrix<value_type> & eval)
+      {
+        ptrows.SetSize0();
+        for (auto d : dofs)
+          ptrows.Append(dofpts[d]);
+        QuickSort (ptrows);
+        size_t n = 0;
+        for (size_t k : Range(ptrows))
+          if (n == 0 || ptrows[k] != ptrows[n-1])
+            ptrows[n++] = ptrows[k];
+        ptrows.SetSize(n);
+
+        eval.SetSize(n, dofs.Size());
+        eval = value_type(0.0);
+        for (size_t j : Range(dofs))
+          for (size_t k : Range(dofpts[dofs[j]]))
+            {
+              auto pos = std::lower_bound(ptrows.Data(), ptrows.Data()+ptrows.Size(), dofpts[dofs[j]][k]);
+              eval(pos-ptrows.Data(), j) = dofvals[dofs[j]][k];
+            }
+      };
+
+      Array<int> ptrows, ptcols;
+      Matrix<value_type> evaly, evalx;
+      gather (rows, test_pts, test_vals, ptrows, evaly);
+      gather (cols, trial_pts, trial_vals, ptcols, evalx);
+
+      Matrix<value_type> kmat(ptrows.Size(), ptcols.Size());
+      pointkernel (ptrows, ptcols, kmat);
+      Matrix<value_type> kx = kmat * evalx;
+      block += Trans(evaly) * kx;
+    };
+
+    HMatrix_Parameters params;
+    params.eps = eps;
+    params.eta = io_params.HMatrixEta();
+    params.leafsize = io_params.HMatrixLeafSize();
+    auto hmat = make_shared<HMatrix<value_type>> (tree, tree, generator, params);
+    return make_shared<HLUMatrix<value_type>> (hmat, eps, cholesky);
+  }
   
 
 
@@ -445,8 +1236,7 @@ namespace ngsbem
 
     
     // common code for same panel, common edge, common vertex
-    auto Integrate4D = [&] (const IntegrationRule & irx,
-                            const IntegrationRule & iry,
+    auto Integrate4D = [&] (const SingularRule & rule,
                             const FiniteElement & feli,
                             const FiniteElement & felj,
                             const ElementTransformation & trafoi,
@@ -454,47 +1244,48 @@ namespace ngsbem
                             FlatMatrix<value_type> elmat,
                             LocalHeap & lh)
     {
-      HeapReset hr(lh);
-      SIMD_IntegrationRule simd_irx(irx);
-      SIMD_IntegrationRule simd_iry(iry);
+      IntRange test_range = test_evaluator->UsedDofs(feli);  
+      IntRange trial_range = trial_evaluator->UsedDofs(felj);  
 
-      SIMD_MappedIntegrationRule<2,3> mirx(simd_irx, trafoi, lh);
-      SIMD_MappedIntegrationRule<2,3> miry(simd_iry, trafoj, lh);
+      for (size_t k = 0; k < rule.irx.Size(); k++)
+        {
+          HeapReset hr(lh);
+          const SIMD_IntegrationRule & simd_irx = *rule.irx[k];
+          const SIMD_IntegrationRule & simd_iry = *rule.iry[k];
 
-      FlatMatrix<SIMD<double>> mshapesi(feli.GetNDof()*test_evaluator->Dim(), mirx.Size(), lh);
-      FlatMatrix<SIMD<value_type>> mshapesi_kern(feli.GetNDof(), mirx.Size(), lh);
-      FlatMatrix<SIMD<double>> mshapesj(felj.GetNDof()*trial_evaluator->Dim(), miry.Size(), lh);
+          SIMD_MappedIntegrationRule<2,3> mirx(simd_irx, trafoi, lh);
+          SIMD_MappedIntegrationRule<2,3> miry(simd_iry, trafoj, lh);
 
-      // mshapesi = 0.;
-      // mshapesj = 0.;
+          FlatMatrix<SIMD<double>> mshapesi(feli.GetNDof()*test_evaluator->Dim(), mirx.Size(), lh);
+          FlatMatrix<SIMD<value_type>> mshapesi_kern(feli.GetNDof(), mirx.Size(), lh);
+          FlatMatrix<SIMD<double>> mshapesj(felj.GetNDof()*trial_evaluator->Dim(), miry.Size(), lh);
 
-      IntRange test_range = test_evaluator->UsedDofs(feli);  
-      IntRange trial_range = trial_evaluator->UsedDofs(felj);  
-      test_evaluator->CalcMatrix(feli, mirx, mshapesi);  // only used are set for compound fe !!!
-      trial_evaluator->CalcMatrix(felj, miry, mshapesj);
+          test_evaluator->CalcMatrix(feli, mirx, mshapesi);  // only used are set for compound fe !!!
+          trial_evaluator->CalcMatrix(felj, miry, mshapesj);
                     
-      FlatVector<Vec<KERNEL_COMPS_T::SIZE, SIMD<value_type>>> kernel_values(mirx.Size(), lh);
-      for (int k2 = 0; k2 < mirx.Size(); k2++)
-        {
-          Vec<3,SIMD<double>> x = mirx[k2].Point();
-          Vec<3,SIMD<double>> y = miry[k2].Point();
-          Vec<3,SIMD<double>> nx = mirx[k2].GetNV();
-          Vec<3,SIMD<double>> ny = miry[k2].GetNV();
-          kernel_values(k2) = mirx[k2].GetMeasure()*miry[k2].GetMeasure()*simd_irx[k2].Weight() *
-            kernel.Evaluate(x, y, nx, ny);
-        }                        
-      for (auto term : kernel.terms)
-        {
-          auto mshapesi_comp = mshapesi.RowSlice(term.test_comp, test_evaluator->Dim());
+          FlatVector<Vec<KERNEL_COMPS_T::SIZE, SIMD<value_type>>> kernel_values(mirx.Size(), lh);
           for (int k2 = 0; k2 < mirx.Size(); k2++)
             {
-              SIMD<value_type> kernel_ = kernel_values(k2)(term.kernel_comp); 
-              mshapesi_kern.Col(k2) = term.fac*kernel_ * mshapesi_comp.Col(k2);
-            }
+              Vec<3,SIMD<double>> x = mirx[k2].Point();
+              Vec<3,SIMD<double>> y = miry[k2].Point();
+              Vec<3,SIMD<double>> nx = mirx[k2].GetNV();
+              Vec<3,SIMD<double>> ny = miry[k2].GetNV();
+              kernel_values(k2) = mirx[k2].GetMeasure()*miry[k2].GetMeasure()*simd_irx[k2].Weight() *
+                kernel.Evaluate(x, y, nx, ny);
+            }                        
+          for (auto term : kernel.terms)
+            {
+              auto mshapesi_comp = mshapesi.RowSlice(term.test_comp, test_evaluator->Dim());
+              for (int k2 = 0; k2 < mirx.Size(); k2++)
+                {
+                  SIMD<value_type> kernel_ = kernel_values(k2)(term.kernel_comp); 
+                  mshapesi_kern.Col(k2) = term.fac*kernel_ * mshapesi_comp.Col(k2);
+                }
           
-          AddABt (mshapesi_kern.Rows(test_range), 
-                  mshapesj.RowSlice(term.trial_comp, trial_evaluator->Dim()).AddSize(felj.GetNDof(), miry.Size()).Rows(trial_range),
-                  elmat.Rows(test_range).Cols(trial_range));
+              AddABt (mshapesi_kern.Rows(test_range), 
+                      mshapesj.RowSlice(term.trial_comp, trial_evaluator->Dim()).AddSize(felj.GetNDof(), miry.Size()).Rows(trial_range),
+                      elmat.Rows(test_range).Cols(trial_range));
+            }
         }
     };
 
@@ -509,13 +1300,6 @@ namespace ngsbem
     ElementTransformation &trafoi = mesh2->GetTrafo(ei_test, lh);
     ElementTransformation &trafoj = mesh->GetTrafo(ei_trial, lh);
     
-    Array<DofId> dnumsi, dnumsj;
-    test_space->GetDofNrs(ei_test, dnumsi); // mapping to global dof
-    trial_space->GetDofNrs(ei_trial, dnumsj);
-        
-    FlatMatrix<> shapei(feli.GetNDof(), test_evaluator->Dim(), lh);
-    FlatMatrix<> shapej(felj.GetNDof(), trial_evaluator->Dim(), lh);
-
     matrix = 0.0;
     
     int n_common_vertices = 0;
@@ -523,44 +1307,19 @@ namespace ngsbem
       if (vertj.Contains(vi))
         n_common_vertices++;
     
+    // the singular configurations use the rules prepared in the constructor,
+    // only the vertex permutation of the pair has to be found
     switch (n_common_vertices)
       {
       case 3: //identical panel
         {
-          // RegionTimer reg(t_identic);    
-          
-          constexpr int BS = 128;
-          for (int k = 0; k < identic_panel_weight.Size(); k+=BS)
-            {
-              int num = std::min(size_t(BS), identic_panel_weight.Size()-k);
-              
-              HeapReset hr(lh);
-              
-              IntegrationRule irx(num, lh);
-              IntegrationRule iry(num, lh);
-              
-              for (int k2 = 0; k2 < num; k2++)
-                {
-                  Vec<2> xk = identic_panel_x[k+k2];
-                  Vec<2> yk = identic_panel_y[k+k2];
-                  
-                  irx[k2] = IntegrationPoint(xk(0), xk(1), 0,
-                                             identic_panel_weight[k+k2]);
-                  iry[k2] = IntegrationPoint(yk(0), yk(1), 0, 0);
-                }
-              
-              Integrate4D (irx, iry, feli, felj, trafoi, trafoj, matrix, lh);
-            }
-          
-          
+          Integrate4D (identic_panel_rule, feli, felj, trafoi, trafoj, matrix, lh);
           break;
         }
       case 2: //common edge
         {
-          // RegionTimer reg(t_common_edge);    
-          
           const EDGE * edges = ElementTopology::GetEdges (ET_TRIG); // 0 1 | 1 2 | 2 0 
-          int cex, cey;
+          int cex = -1, cey = -1;
           for (int cx = 0; cx < 3; cx++)
             for (int cy = 0; cy < 3; cy++)
               {
@@ -573,50 +1332,13 @@ namespace ngsbem
                     break;
                   }
               }
-          int vpermx[3] = { edges[cex][0], edges[cex][1], -1 }; // common edge gets first
-          vpermx[2] = 3-vpermx[0]-vpermx[1]; 
-          int vpermy[3] = { edges[cey][1], edges[cey][0], -1 }; // common edge gets first
-          vpermy[2] = 3-vpermy[0]-vpermy[1];
-          
-          constexpr int BS = 128;
-          for (int k = 0; k < common_edge_weight.Size(); k+=BS)
-            {
-              int num = std::min(size_t(BS), common_edge_weight.Size()-k);
-              
-              HeapReset hr(lh);
-              
-              IntegrationRule irx(num, lh);
-              IntegrationRule iry(num, lh);
-              
-              for (int k2 = 0; k2 < num; k2++)
-                {
-                  Vec<2> xk = common_edge_x[k+k2];
-                  Vec<2> yk = common_edge_y[k+k2];
-                  
-                  Vec<3> lamx (1-xk(0)-xk(1), xk(0), xk(1) );
-                  Vec<3> lamy (1-yk(0)-yk(1), yk(0), yk(1) );
-                  
-                  Vec<3> plamx, plamy;
-                  for (int i = 0; i < 3; i++)
-                    {
-                      plamx(vpermx[i]) = lamx(i);
-                      plamy(vpermy[i]) = lamy(i);
-                    }
-                  
-                  irx[k2] = IntegrationPoint(plamx(0), plamx(1), 0, common_edge_weight[k+k2]);
-                  iry[k2] = IntegrationPoint(plamy(0), plamy(1), 0, 0);
-                }
-              
-              Integrate4D (irx, iry, feli, felj, trafoi, trafoj, matrix, lh);
-            }
-          
+
+          Integrate4D (common_edge_rule[cex][cey], feli, felj, trafoi, trafoj, matrix, lh);
           break;
         }
         
       case 1: //common vertex
         {
-          // RegionTimer reg(t_common_vertex);    
-          
           int cvx=-1, cvy=-1;
           for (int cx = 0; cx < 3; cx++)
             for (int cy = 0; cy < 3; cy++)
@@ -629,44 +1351,7 @@ namespace ngsbem
                   }
               }
 
-          int vpermx[3] = { cvx, (cvx+1)%3, (cvx+2)%3 };
-          vpermx[2] = 3-vpermx[0]-vpermx[1];
-          int vpermy[3] = { cvy, (cvy+1)%3, (cvy+2)%3 };
-          vpermy[2] = 3-vpermy[0]-vpermy[1];
-          
-          // vectorized version:
-          constexpr int BS = 128;
-          for (int k = 0; k < common_vertex_weight.Size(); k+=BS)
-            {
-              int num = std::min(size_t(BS), common_vertex_weight.Size()-k);
-              
-              HeapReset hr(lh);
-              
-              IntegrationRule irx(num, lh);
-              IntegrationRule iry(num, lh);
-              
-              for (int k2 = 0; k2 < num; k2++)
-                {
-                  Vec<2> xk = common_vertex_x[k+k2];
-                  Vec<2> yk = common_vertex_y[k+k2];
-                  
-                  Vec<3> lamx (1-xk(0)-xk(1), xk(0), xk(1) );
-                  Vec<3> lamy (1-yk(0)-yk(1), yk(0), yk(1) );
-                  
-                  Vec<3> plamx, plamy;
-                  for (int i = 0; i < 3; i++)
-                    {
-                      plamx(vpermx[i]) = lamx(i);
-                      plamy(vpermy[i]) = lamy(i);
-                    }
-                  
-                  irx[k2] = IntegrationPoint(plamx(0), plamx(1), 0, common_vertex_weight[k+k2]);
-                  iry[k2] = IntegrationPoint(plamy(0), plamy(1), 0, 0);
-                }
-              
-              Integrate4D (irx, iry, feli, felj, trafoi, trafoj, matrix, lh);
-            }
-          
+          Integrate4D (common_vertex_rule[cvx][cvy], feli, felj, trafoi, trafoj, matrix, lh);
           break;
         }
         
@@ -16,6 +16,10 @@ namespace ngsbem
     bool use_fmm = true;
     int fmm_maxdirect = 100;
     int fmm_minorder = 20;
+    bool use_hmatrix = false;
+    double hmatrix_eps = 1e-6;
+    double hmatrix_eta = 2;
+    int hmatrix_leafsize = 64;
   public:
     IntOp_Parameters () = default;
     IntOp_Parameters (const Flags & flags);
@@ -23,6 +27,10 @@ namespace ngsbem
     bool UseFMM() const { return use_fmm; }
     int FMMMaxDirect() const { return fmm_maxdirect; }
     int FMMMinOrder() const { return fmm_minorder; }
+    bool UseHMatrix() const { return use_hmatrix; }
+    double HMatrixEps() const { return hmatrix_eps; }
+    double HMatrixEta() const { return hmatrix_eta; }
+    int HMatrixLeafSize() const { return hmatrix_leafsize; }
 
     operator FMM_Parameters() const
     {
@@ -39,6 +47,10 @@ namespace ngsbem
     ost << "use_fmm = " << ioflags.UseFMM() << endl;
     ost << "fmm_maxdirect = " << ioflags.FMMMaxDirect() << endl;
     ost << "fmm_minorder = " << ioflags.FMMMinOrder() << endl;    
+    ost << "use_hmatrix = " << ioflags.UseHMatrix() << endl;
+    ost << "hmatrix_eps = " << ioflags.HMatrixEps() << endl;
+    ost << "hmatrix_eta = " << ioflags.HMatrixEta() << endl;
+    ost << "hmatrix_leafsize = " << ioflags.HMatrixLeafSize() << endl;
     return ost;
   }
 
@@ -74,7 +86,18 @@ namespace ngsbem
 
     Array<Vec<2>> common_edge_x, common_edge_y;
     Array<double> common_edge_weight;
-    
+
+    // the same rules mapped to the reference triangles, for every vertex permutation,
+    // in blocks of SIMD rules. Set up once, shared by all element pairs of a configuration.
+    // x refers to the test element, y to the trial element, the weight is in x
+    struct SingularRule
+    {
+      Array<unique_ptr<SIMD_IntegrationRule>> irx, iry;
+    };
+    SingularRule identic_panel_rule;
+    SingularRule common_edge_rule[3][3];     // [common edge in test el][common edge in trial el]
+    SingularRule common_vertex_rule[3][3];   // [common vertex in test el][common vertex in trial el]
+
 
     shared_ptr<BaseMatrix> matrix;
 
@@ -92,6 +115,9 @@ namespace ngsbem
 
     virtual shared_ptr<BaseMatrix> CreateMatrixFMM(LocalHeap & lh) const = 0;
 
+    // H-LU or H-Cholesky factorization, Mult applies the approximate inverse
+    virtual shared_ptr<BaseMatrix> CreateHLU(double eps, bool cholesky) const = 0;
+
     virtual shared_ptr<BasePotentialCF> GetPotential(shared_ptr<GridFunction> gf,
                                                      optional<int> io, bool nearfield_experimental) const = 0;
   };
@@ -108,6 +134,11 @@ namespace ngsbem
     typedef typename KERNEL::value_type value_type;
     typedef IntegralOperator BASE;
 
+    // kept from CreateMatrixFMM for the H-LU: nearfield correction, and
+    // whether the far field is represented by the point kernel
+    mutable shared_ptr<SparseMatrix<value_type>> nearfield;
+    mutable bool compressed = false;
+
     
   public:
     /*
@@ -139,6 +170,11 @@ namespace ngsbem
 
     
     shared_ptr<BaseMatrix> CreateMatrixFMM(LocalHeap & lh) const override;
+
+    // nearfield of element pairs touching across processes, for distributed meshes
+    shared_ptr<BaseMatrix> CreateGhostNearfield(LocalHeap & lh) const;
+
+    shared_ptr<BaseMatrix> CreateHLU(double eps, bool cholesky) const override;
     
     virtual shared_ptr<BasePotentialCF> GetPotential(shared_ptr<GridFunction> gf,
                                                          optional<int> io, bool nearfield_experimental) const override;
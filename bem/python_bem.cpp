@@ -64,6 +64,8 @@ void NGS_DLL_HEADER ExportNgsbem(py::module &m)
                                 ngcomp::Region reg) { AddChargeDensity(mp,charge,reg); })
     
     .def("Calc", &SingularMLExpansion<Complex>::CalcMP)
+    .def("ResetSources", &SingularMLExpansion<Complex>::ResetSources,
+         "remove sources, keep tree and translations for sources at the same positions")
     .def("Norm", &SingularMLExpansion<Complex>::Norm)    
     .def("__str__", [](SingularMLExpansion<Complex>& mlmp) { return ToString<>(mlmp); })
     .def("Print", [](const SingularMLExpansion<Complex> &self) {
@@ -178,6 +180,11 @@ void NGS_DLL_HEADER ExportNgsbem(py::module &m)
     .def_property_readonly("mat", &IntegralOperator::GetMatrix)
     .def("GetPotential", &IntegralOperator::GetPotential,
          py::arg("gf"), py::arg("intorder")=nullopt, py::arg("nearfield_experimental")=false)
+    .def("CreateHLU", &IntegralOperator::CreateHLU,
+         py::arg("eps")=1e-4, py::arg("cholesky")=false,
+         "H-matrix LU (or Cholesky) factorization with relative accuracy eps,\n"
+         "returns the approximate inverse operator.\n"
+         "Needs the same trial and test space.")
     ;
   
   m.def("SingleLayerPotentialOperator", [](shared_ptr<FESpace> space, int intorder) -> shared_ptr<IntegralOperator>
@@ -7,6 +7,7 @@
 
 #include <parallelngs.hpp>
 #include <diagonalmatrix.hpp>
+#include <random>
 
 #include "../fem/h1lofe.hpp"
 #include "../fem/tensorproductintegrator.hpp"
@@ -80,6 +81,65 @@ namespace ngcomp
   }
 
 
+  /*
+    Element matrices waiting for static condensation, all with the same
+    numbers of inner and outer dofs. SIMD<double>::Size() elements are
+    condensed together, one element per SIMD lane.
+  */
+  class StatCondBatch
+  {
+  public:
+    enum { BS = SIMD<double>::Size() };
+    size_t sizei, sizeo;    // number of inner/outer dofs (not multiplied by dim)
+    size_t cnt = 0;
+    VorB vb = VOL;
+    size_t elnrs[BS];
+    Array<DofId> dnums[BS];
+    Array<int> idofs1[BS], odofs1[BS];
+    Matrix<double> elmats[BS];
+
+    StatCondBatch (size_t asizei, size_t asizeo)
+      : sizei(asizei), sizeo(asizeo) { ; }
+  };
+
+  /*
+    In place inverse of BS matrices by Gauss-Jordan without pivoting.
+    Returns false if a pivot is small compared to the diagonal, then d
+    is undefined.
+  */
+  static bool BatchInverse (FlatMatrix<SIMD<double>> d)
+  {
+    constexpr size_t BS = SIMD<double>::Size();
+    size_t n = d.Height();
+    double maxdiag[BS] = { 0 };
+    for (size_t i = 0; i < n; i++)
+      for (size_t l = 0; l < BS; l++)
+        maxdiag[l] = max2(maxdiag[l], fabs(d(i,i)[l]));
+
+    for (size_t k = 0; k < n; k++)
+      {
+        SIMD<double> piv = d(k,k);
+        for (size_t l = 0; l < BS; l++)
+          if (fabs(piv[l]) <= 1e-12 * maxdiag[l])
+            return false;
+
+        SIMD<double> ipiv = 1.0 / piv;
+        d(k,k) = 1.0;
+        for (size_t j = 0; j < n; j++)
+          d(k,j) *= ipiv;
+        for (size_t i = 0; i < n; i++)
+          if (i != k)
+            {
+              SIMD<double> f = d(i,k);
+              d(i,k) = 0.0;
+              for (size_t j = 0; j < n; j++)
+                d(i,j) -= f * d(k,j);
+            }
+      }
+    return true;
+  }
+
+
 
 
 
@@ -125,6 +185,10 @@ namespace ngcomp
     geom_free = flags.GetDefineFlag("geom_free");
     matrix_free_bdb = flags.GetDefineFlag("matrix_free_bdb");    
     nonlinear_matrix_free_bdb = flags.GetDefineFlag("nonlinear_matrix_free_bdb");    
+    element_batch = flags.GetDefineFlag("element_batch");
+    atomic_assembly = flags.GetDefineFlag("atomic_assembly");
+    batch_condense = flags.GetDefineFlag("batch_condense");
+    affine_parameters = flags.GetDefineFlag("affine_parameters");
     if (spd) symmetric = true;
     SetCheckUnused (!flags.GetDefineFlagX("check_unused").IsFalse());
     if (flags.NumFlagDefined("delete_zero_elements"))
@@ -183,6 +247,10 @@ namespace ngcomp
     geom_free = flags.GetDefineFlag("geom_free");
     matrix_free_bdb = flags.GetDefineFlag("matrix_free_bdb");
     nonlinear_matrix_free_bdb = flags.GetDefineFlag("nonlinear_matrix_free_bdb");
+    element_batch = flags.GetDefineFlag("element_batch");
+    atomic_assembly = flags.GetDefineFlag("atomic_assembly");
+    batch_condense = flags.GetDefineFlag("batch_condense");
+    affine_parameters = flags.GetDefineFlag("affine_parameters");
     
     precompute = flags.GetDefineFlag ("precompute");
     checksum = flags.GetDefineFlag ("checksum");
@@ -350,6 +418,34 @@ namespace ngcomp
     specialelements_timestamp = GetNextTimeStamp();
   }
 
+  bool BilinearForm :: SpecialElementsInGraph () const
+  {
+    if (MixedSpaces() || !mats.Size() || mats.Size() < ma->GetNLevels()) return false;
+    auto graph = dynamic_cast<const MatrixGraph*> (mats.Last().get());
+    if (!graph) return false;
+
+    // graphs of one space are structurally symmetric, the lower triangle is enough
+    atomic<bool> found = true;
+    ParallelForRange (specialelements.Size(), [&] (IntRange r)
+      {
+        Array<DofId> dnums;
+        for (auto i : r)
+          {
+            if (!found) return;
+            specialelements[i]->GetDofNrs (dnums);
+            for (auto d1 : dnums)
+              for (auto d2 : dnums)
+                if (IsRegularDof(d1) && IsRegularDof(d2) && d2 <= d1)
+                  if (graph->GetPositionTest (d1, d2) == size_t(-1))
+                    {
+                      found = false;
+                      return;
+                    }
+          }
+      });
+    return found;
+  }
+
   Table<int> & BilinearForm :: SpecialElementColoring() const
   {
     if (!special_element_coloring)
@@ -492,9 +588,30 @@ namespace ngcomp
     int maxind = neV + neB + neBB + specialelements.Size();
     if (fespace->UsesDGCoupling()) maxind += nf;
 
+    // dof numbering of the trial and the test space
+    auto fes_timestamp = [&] ()
+      {
+        return max (fespace->GetTimeStamp(), fespace2 ? fespace2->GetTimeStamp() : size_t(0));
+      };
+    
+    // only the special elements changed: take the element rows of the previous graph
+    bool reuse = reuse_element_graph &&
+      element_graph_timestamp == ma->GetTimeStamp() &&
+      element_graph_fes_timestamp == fes_timestamp() &&
+      element_graph_ndof == ndof &&
+      element_graph.Size() == size_t(maxind)-nspe;
+    reuse_element_graph = false;
+    
     TableCreator<int> creator(maxind);
     for ( ; !creator.Done(); creator++)
       {
+        if (reuse)
+          ParallelFor (element_graph.Size(), [&] (size_t i)
+            {
+              size_t row = (i < neV+neB+neBB) ? i : i+nspe;
+              for (auto d : element_graph[i])
+                creator.Add (row, d);
+            });
 
         /*
         task_manager->CreateJob
@@ -531,6 +648,7 @@ namespace ngcomp
         */
 	for(VorB vb : {VOL, BND, BBND})
 	  {
+            if (reuse) break;
             size_t shift = (vb==VOL) ? 0 : ((vb==BND) ? neV : neV+neB);
             bool condensation_allowed = (vb == VOL) || ((neV==0) && (vb == BND));
 	    ParallelForRange
@@ -581,7 +699,7 @@ namespace ngcomp
               }
           }
 
-        if (fespace->UsesDGCoupling())
+        if (fespace->UsesDGCoupling() && !reuse)
         {
           //add dofs of neighbour elements as well
           Array<DofId> dnums_dg;
@@ -636,6 +754,24 @@ namespace ngcomp
         */
         auto table = creator.MoveTable();
         graph = new MatrixGraph (ndof, ndof, table, table, symmetric);        
+
+        // keep the element rows, special elements may change without mesh changes
+        if (nspe && !reuse)
+          {
+            Array<int> cnt(maxind-nspe);
+            for (size_t i : Range(cnt))
+              cnt[i] = table[(i < neV+neB+neBB) ? i : i+nspe].Size();
+            element_graph = Table<int>(cnt);
+            ParallelFor (cnt.Size(), [&] (size_t i)
+              {
+                element_graph[i] = table[(i < neV+neB+neBB) ? i : i+nspe];
+              });
+            element_graph_timestamp = ma->GetTimeStamp();
+            element_graph_fes_timestamp = fes_timestamp();
+            element_graph_ndof = ndof;
+          }
+        else if (!nspe)
+          element_graph = Table<int>();
       }
     else
       {
@@ -713,6 +849,68 @@ namespace ngcomp
 
 
 
+  void BilinearForm :: PrecomputeElementData ()
+  {
+    static Timer t("BilinearForm::PrecomputeElementData"); RegionTimer reg(t);
+
+    for (auto & data : precomputed_data)
+      data.SetSize0();
+    precomputed_heaps.SetSize0();
+
+    LocalHeap lh (10000000, "biform - precompute");
+    size_t heapsize = 16000000;
+    for (VorB vb : { VOL, BND, BBND, BBBND })
+      {
+        size_t nparts = VB_parts[vb].Size();
+        if (!nparts) continue;
+        precomputed_data[vb].SetSize (ma->GetNE(vb)*nparts);
+        precomputed_data[vb] = nullptr;
+
+        for (size_t i = 0; i < ma->GetNE(vb); i++)
+          {
+            HeapReset hr(lh);
+            ElementId ei(vb, i);
+            if (!fespace->DefinedOn (ei)) continue;
+            if (MixedSpaces() && !fespace2->DefinedOn (ei)) continue;
+
+            const FiniteElement & fel1 = fespace->GetFE (ei, lh);
+            const FiniteElement & fel = MixedSpaces() ?
+              *new (lh) MixedFiniteElement (fel1, fespace2->GetFE (ei, lh)) : fel1;
+
+            // the data must stay, it goes to chunks which are never reset.
+            // If the element does not fit, it is redone in a new chunk,
+            // which is larger if the element did not fit into an empty one.
+            while (true)
+              {
+                if (precomputed_heaps.Size() == 0)
+                  precomputed_heaps.Append (make_unique<LocalHeap> (heapsize, "biform - precomputed data"));
+                LocalHeap & plh = *precomputed_heaps.Last();
+                bool empty = plh.UsedSize() == 0;
+                try
+                  {
+                    // the transformation is temporary, only the data goes to plh
+                    HeapReset hr(lh);
+                    ElementTransformation & trafo = ma->GetTrafo (ei, lh);
+                    for (size_t j = 0; j < nparts; j++)
+                      {
+                        auto & bfi = VB_parts[vb][j];
+                        if (!bfi->DefinedOn (ma->GetElIndex (ei))) continue;
+                        if (!bfi->DefinedOnElement (i)) continue;
+                        
+                        auto & mapped_trafo = trafo.AddDeformation (bfi->GetDeformation().get(), lh);
+                        precomputed_data[vb][i*nparts+j] = bfi->PrecomputeData (fel, mapped_trafo, plh);
+                      }
+                    break;
+                  }
+                catch (const LocalHeapOverflow &)
+                  {
+                    if (empty) heapsize *= 2;
+                    precomputed_heaps.Append (make_unique<LocalHeap> (heapsize, "biform - precomputed data"));
+                  }
+              }
+          }
+      }
+  }
 
 
   void BilinearForm :: Assemble (LocalHeap & lh)
@@ -735,46 +933,7 @@ namespace ngcomp
         mats.Last() = app;
       
         if (precompute)
-          {
-            Array<DofId> dnums;
-            precomputed_data.SetSize( max2(max2(ma->GetNE(VOL), ma->GetNE(BND)),ma->GetNE(BBND))*NumIntegrators() );
-            precomputed_data = nullptr;
-
-            LocalHeap lh (20000000, "biform - assemble");
-            
-            // int hasbound = 0;
-            // int hasinner = 0;
-            for (VorB vb : {VOL, BND, BBND})
-	      {
-		int ne = ma->GetNE(vb);
-		if(VB_parts[vb].Size())
-		  {
-		    for (int i=0; i < ne; i++)
-		      {
-                        ElementId ei(vb, i);
-			// auto & fel = fespace->GetFE(ei,lh);
-			// auto & eltrans = ma->GetTrafo(ei,lh);
-			fespace->GetDofNrs(ei,dnums);
-                        /*
-			for(int j=0; j<NumIntegrators(); j++)
-			  {
-			    const BilinearFormIntegrator & bfi = *parts[j];
-                        */
-                        /*
-                        for (auto & bfi : VB_parts[vb])
-                          {
-			    // if(bfi.VB()!=vb) continue;
-			    if(!bfi->DefinedOn (ma->GetElIndex(i))) continue;
-                            
-			    precomputed_data[i*NumIntegrators()+j] =
-			      bfi->PrecomputeData(fel,eltrans,lh);
-			  }
-                        */
-                        throw Exception ("precomputed currently not supported");
-		      }
-		  }
-	      }
-	  }
+          PrecomputeElementData();
             
         
         if (timing)
@@ -848,7 +1007,10 @@ namespace ngcomp
       }
 
 
-    DoAssemble(lh);
+    if (affine_parameters)
+      AssembleAffine(lh);
+    else
+      DoAssemble(lh);
 
 
     if (timing)
@@ -1536,10 +1698,19 @@ namespace ngcomp
         return;
       }
 
-    if (specialelements_timestamp > graph_timestamp)
+    if (specialelements_timestamp > graph_timestamp && !reallocate)
       {
-        reallocate = true;
-        cout << IM(3) << "reallocate due to changed special elements" << endl;
+        if (SpecialElementsInGraph())
+          {
+            cout << IM(3) << "changed special elements fit into matrix graph" << endl;
+            graph_timestamp = GetNextTimeStamp();
+          }
+        else
+          {
+            reallocate = true;
+            reuse_element_graph = true;
+            cout << IM(3) << "reallocate due to changed special elements" << endl;
+          }
       }
     
     if (reallocate)
@@ -1551,13 +1722,197 @@ namespace ngcomp
         return;
       }
 
-    GetMatrix() = 0.0;
-    DoAssemble(lh);
+    if (affine_parameters)
+      AssembleAffine(lh);
+    else
+      {
+        GetMatrix() = 0.0;
+        DoAssemble(lh);
+      }
 
     if (galerkin)
       GalerkinProjection();
   }
 
+  static Complex GetParameterValue (CoefficientFunction & param)
+  {
+    if (auto rparam = dynamic_cast<ParameterCoefficientFunction<double>*> (&param))
+      return rparam->GetValue();
+    return dynamic_cast<ParameterCoefficientFunction<Complex>&> (param).GetValue();
+  }
+
+  static void SetParameterValue (CoefficientFunction & param, Complex val)
+  {
+    if (auto rparam = dynamic_cast<ParameterCoefficientFunction<double>*> (&param))
+      rparam->SetValue (val.real());
+    else
+      dynamic_cast<ParameterCoefficientFunction<Complex>&> (param).SetValue (val);
+  }
+  
+  void BilinearForm :: AssembleAffine (LocalHeap & lh)
+  {
+    static Timer t("Matrix assembling - affine parameters"); RegionTimer reg(t);
+
+    if (affine_timestamp < graph_timestamp)
+      {
+        static Timer tsetup("Matrix assembling - affine terms"); RegionTimer regsetup(tsetup);
+        affine_params.SetSize0();
+        affine_terms.SetSize0();
+        affine_timestamp = graph_timestamp;
+
+        // condensation is not linear, preconditioners would collect all term matrices
+        bool affine = !eliminate_internal && !eliminate_hidden && !preconditioners.Size();
+        Array<shared_ptr<CoefficientFunction>> cfs;
+        for (auto bfi : parts)
+          if (auto sbfi = dynamic_pointer_cast<SymbolicBilinearFormIntegrator> (bfi))
+            cfs.Append (sbfi->GetCoefficientFunction());
+          else if (auto sfbfi = dynamic_pointer_cast<SymbolicFacetBilinearFormIntegrator> (bfi))
+            cfs.Append (sfbfi->GetCoefficientFunction());
+          else
+            affine = false;
+
+        auto is_param = [] (CoefficientFunction & cf)
+          {
+            return dynamic_cast<ParameterCoefficientFunction<double>*> (&cf) ||
+              dynamic_cast<ParameterCoefficientFunction<Complex>*> (&cf);
+          };
+        for (auto cf : cfs)
+          cf->TraverseTree ([&] (CoefficientFunction & nodecf)
+            {
+              if (is_param (nodecf))
+                {
+                  auto param = nodecf.shared_from_this();
+                  if (!affine_params.Contains(param))
+                    affine_params.Append (param);
+                }
+            });
+
+        // affine if no derivative w.r.t. a parameter depends on a parameter.
+        // A vanishing second derivative is not enough: for IfPos(dt-a, 1, dt)
+        // it vanishes piecewise, but the condition keeps dt in the derivative.
+        auto one = make_shared<ConstantCoefficientFunction> (1);
+        try
+          {
+            for (auto cf : cfs)
+              for (auto p : affine_params)
+                cf->Diff (p.get(), one)->TraverseTree
+                  ([&] (CoefficientFunction & nodecf)
+                   {
+                     if (is_param (nodecf))
+                       affine = false;
+                   });
+          }
+        catch (const Exception & e)
+          {
+            affine = false;
+          }
+
+        if (!affine)
+          {
+            cout << IM(3) << "bilinear-form " << GetName() << " is not affine in its parameters" << endl;
+            affine_params.SetSize0();
+          }
+        else
+          {
+            Array<Complex> values;
+            for (auto p : affine_params)
+              {
+                values.Append (GetParameterValue (*p));
+                SetParameterValue (*p, 0);
+              }
+            
+            DoAssemble (lh);
+            affine_terms.Append (GetMatrix().AsVector().CreateVector());
+            *affine_terms[0] = GetMatrix().AsVector();
+            
+            for (auto i : Range(affine_params))
+              {
+                SetParameterValue (*affine_params[i], 1);
+                DoAssemble (lh);
+                affine_terms.Append (GetMatrix().AsVector().CreateVector());
+                *affine_terms.Last() = GetMatrix().AsVector() - *affine_terms[0];
+                SetParameterValue (*affine_params[i], 0);
+              }
+            
+            // check the terms against the full assembly at random values,
+            // and last at the current values, which stay in the matrix
+            mt19937 gen(4711);
+            uniform_real_distribution<double> dist(-1, 1);
+            auto full = GetMatrix().AsVector().CreateVector();
+            for (int k = 0; k < 3; k++)
+              {
+                for (auto i : Range(affine_params))
+                  SetParameterValue (*affine_params[i], k < 2 ? Complex(dist(gen), dist(gen)) : values[i]);
+                DoAssemble (lh);
+                *full = GetMatrix().AsVector();
+                CombineAffineTerms ();
+                GetMatrix().AsVector() -= *full;
+                double err = L2Norm (GetMatrix().AsVector());
+                GetMatrix().AsVector() = *full;
+                if (err > 1e-10 * L2Norm (*full))
+                  {
+                    cout << IM(3) << "bilinear-form " << GetName() << " is not affine in its parameters" << endl;
+                    for (auto i : Range(affine_params))
+                      SetParameterValue (*affine_params[i], values[i]);
+                    affine_params.SetSize0();
+                    affine_terms.SetSize0();
+                    DoAssemble (lh);
+                    return;
+                  }
+              }
+            return;
+          }
+      }
+
+    if (!affine_terms.Size())
+      {
+        DoAssemble (lh);
+        return;
+      }
+    CombineAffineTerms ();
+  }
+
+  template <typename SCAL>
+  static void CombineTerms (FlatVector<SCAL> vec, FlatArray<shared_ptr<BaseVector>> terms,
+                            FlatArray<SCAL> values)
+  {
+    Array<SCAL*> pterms(terms.Size());
+    for (auto i : Range(terms))
+      pterms[i] = terms[i]->FV<SCAL>().Data();
+    
+    ParallelForRange (vec.Size(), [&] (IntRange r)
+      {
+        for (auto j : r)
+          {
+            SCAL sum = pterms[0][j];
+            for (auto i : Range(values))
+              sum += values[i] * pterms[i+1][j];
+            vec(j) = sum;
+          }
+      });
+  }
+  
+  void BilinearForm :: CombineAffineTerms ()
+  {
+    static Timer t("Matrix assembling - combine affine terms"); RegionTimer reg(t);
+    BaseVector & vec = GetMatrix().AsVector();
+    if (vec.IsComplex())
+      {
+        Array<Complex> values;
+        for (auto p : affine_params)
+          values.Append (GetParameterValue(*p));
+        CombineTerms<Complex> (vec.FV<Complex>(), affine_terms, values);
+      }
+    else
+      {
+        Array<double> values;
+        for (auto p : affine_params)
+          values.Append (GetParameterValue(*p).real());
+        CombineTerms<double> (vec.FV<double>(), affine_terms, values);
+      }
+  }
+
+  
   shared_ptr<BaseMatrix> BilinearForm :: GetMatrixPtr () const
   {
     if (!mats.Size())
@@ -1596,6 +1951,14 @@ namespace ngcomp
     for (int i = 0; i < mats.Size(); i++)
       if (mats[i]) mu += mats[i]->GetMemoryUsage ();
 
+    if (precomputed_heaps.Size())
+      {
+        size_t nbytes = 0;
+        for (auto & plh : precomputed_heaps)
+          nbytes += plh->UsedSize();
+        mu.Append (MemoryUsage ("precomputed element data", nbytes, precomputed_heaps.Size()));
+      }
+
     for (int i = olds; i < mu.Size(); i++)
       mu[i].AddName (string(" bf ")+GetName());
     return mu;
@@ -1952,6 +2315,187 @@ namespace ngcomp
 
   
 
+  void BilinearForm ::
+  IterateElementBatches (bool colored, LocalHeap & clh,
+                         const function<void(FESpace::Element,LocalHeap&,FlatMatrix<double>)> & func)
+  {
+    static Timer t("Matrix assembling element batches");
+    static Timer tbatch("Matrix assembling element batch", NoTracing);
+    RegionTimer reg(t);
+
+    constexpr size_t SW = SIMD<double>::Size();
+    size_t ne = ma->GetNE(VOL);
+
+    // which regions can be batched: all integrators symbolic, point-wise, undeformed
+    Array<bool> batch_region(ma->GetNRegions(VOL));
+    batch_region = true;
+    for (auto i : Range(batch_region))
+      for (auto & bfi : VB_parts[VOL])
+        if (bfi->DefinedOn(i))
+          {
+            auto sbfi = dynamic_pointer_cast<SymbolicBilinearFormIntegrator> (bfi);
+            if (!sbfi || !sbfi->SupportsElementBatch() || bfi->GetDeformation() ||
+                bfi->GetDefinedOnElements())
+              batch_region[i] = false;
+          }
+
+    Array<int> elclass(ne);
+    elclass = -1;
+    auto & classes = ma->GetElementsOfClass(VOL);
+    for (auto c : Range(classes))
+      for (auto i : classes[c])
+        elclass[i] = c;
+
+    // signature of the finite element: type, region, FE class, order and dofs per node.
+    // Elements of one vertex class with the same signature have the same shape functions.
+    TableCreator<int> creator(ne);
+    for ( ; !creator.Done(); creator++)
+      ParallelForRange (ne, [&] (IntRange r)
+        {
+          LocalHeap lh = clh.Split();
+          Array<DofId> dnums;
+          for (auto i : r)
+            {
+              HeapReset hr(lh);
+              ElementId ei(VOL, i);
+              auto el = ma->GetElement(ei);
+              if (elclass[i] < 0 || !batch_region[el.GetIndex()] || !fespace->DefinedOn(ei)) continue;
+              ELEMENT_TYPE et = el.GetType();
+              if (et != ET_SEGM && et != ET_TRIG && et != ET_TET) continue;
+              const FiniteElement & fel = fespace->GetFE (ei, lh);
+              size_t tid = typeid(fel).hash_code();
+              for (int val : { int(et), el.GetIndex(), fel.GetNDof(), fel.Order(),
+                               int(tid & 0xffffffff), int(tid >> 32) })
+                creator.Add (i, val);
+              auto add_nodes = [&] (NODE_TYPE nt, auto nodes)
+                {
+                  for (auto nr : nodes)
+                    {
+                      fespace->GetDofNrs (NodeId(nt, nr), dnums);
+                      creator.Add (i, int(dnums.Size()));
+                    }
+                };
+              add_nodes (NT_VERTEX, el.Vertices());
+              add_nodes (NT_EDGE, el.Edges());
+              add_nodes (NT_FACE, el.Faces());
+              if (et == ET_TET)
+                add_nodes (NT_CELL, std::array<size_t,1> { i });
+            }
+        });
+    Table<int> signature = creator.MoveTable();
+
+    auto less = [&] (int i1, int i2)
+      {
+        if (elclass[i1] != elclass[i2]) return elclass[i1] < elclass[i2];
+        auto s1 = signature[i1], s2 = signature[i2];
+        return std::lexicographical_compare (s1.Data(), s1.Data()+s1.Size(),
+                                             s2.Data(), s2.Data()+s2.Size());
+      };
+    auto equal = [&] (int i1, int i2)
+      {
+        auto s1 = signature[i1], s2 = signature[i2];
+        return elclass[i1] == elclass[i2] && s1.Size() == s2.Size() &&
+          std::equal (s1.Data(), s1.Data()+s1.Size(), s2.Data());
+      };
+
+    // groups of up to SW equivalent elements, other elements form groups of one
+    auto make_groups = [&] (FlatArray<int> els)
+      {
+        Array<int> sorted;
+        for (auto i : els)
+          if (fespace->DefinedOn(ElementId(VOL, i)))
+            sorted.Append (i);
+        QuickSort (sorted, [&] (int i1, int i2)
+                   {
+                     bool b1 = signature[i1].Size(), b2 = signature[i2].Size();
+                     if (b1 != b2) return b1 < b2;
+                     return b1 && less(i1, i2);
+                   });
+        TableCreator<int> creator;
+        for ( ; !creator.Done(); creator++)
+          {
+            size_t g = 0;
+            for (size_t j = 0; j < sorted.Size(); g++)
+              {
+                size_t first = j++;
+                if (signature[sorted[first]].Size())
+                  while (j < sorted.Size() && j-first < SW && equal(sorted[j], sorted[first]))
+                    j++;
+                for (auto k : Range(first, j))
+                  creator.Add (g, sorted[k]);
+              }
+          }
+        return creator.MoveTable();
+      };
+
+    auto iterate_groups = [&] (const Table<int> & groups)
+      {
+        SharedLoop2 sl(groups.Size());
+        ParallelJob
+          ( [&] (const TaskInfo & ti)
+            {
+              LocalHeap lh = clh.Split(ti.thread_nr, ti.nthreads);
+              ArrayMem<int,100> temp_dnums;
+              for (size_t g : sl)
+                {
+                  HeapReset hr(lh);
+                  auto els = groups[g];
+
+                  // the element matrices of the batch live only while its elements are assembled
+                  FlatMatrix<double> elmats;
+                  size_t h = 0;
+                  if (els.Size() > 1)
+                    {
+                      RegionTracer rt(ti.thread_nr, tbatch);
+                      ElementId ei0(VOL, els[0]);
+                      const FiniteElement & fel = fespace->GetFE (ei0, lh);
+                      FlatArray<const ElementTransformation*> trafos(els.Size(), lh);
+                      for (auto e : Range(els))
+                        trafos[e] = &ma->GetTrafo (ElementId(VOL, els[e]), lh);
+
+                      h = fel.GetNDof() * fespace->GetDimension();
+                      elmats.AssignMemory (els.Size()*h, h, lh);
+                      elmats = 0.0;
+                      for (auto & bfi : VB_parts[VOL])
+                        if (bfi->DefinedOn(ma->GetElIndex(ei0)))
+                          {
+                            auto & sbfi = dynamic_cast<SymbolicBilinearFormIntegrator&> (*bfi);
+                            if (!sbfi.CalcElementMatrixBatch (fel, trafos, elmats, lh))
+                              {
+                                h = 0;
+                                break;
+                              }
+                          }
+                    }
+
+                  for (auto e : Range(els))
+                    {
+                      HeapReset hr(lh);
+                      FESpace::Element el(*fespace, ElementId(VOL, els[e]), temp_dnums, lh);
+                      func (std::move(el), lh,
+                            h ? elmats.Rows(e*h, (e+1)*h) : FlatMatrix<double>());
+                    }
+                }
+              ProgressOutput::SumUpLocal();
+            } );
+      };
+
+    if (colored)
+      {
+        // batches are formed within a colour, their elements do not share dofs
+        for (FlatArray<int> els_of_col : fespace->ElementColoring(VOL))
+          iterate_groups (make_groups (els_of_col));
+      }
+    else
+      {
+        Array<int> all(ne);
+        for (auto i : Range(ne))
+          all[i] = i;
+        iterate_groups (make_groups (all));
+      }
+  }
+
+
   template <class SCAL>
   void S_BilinearForm<SCAL> :: DoAssemble (LocalHeap & clh)
   {
@@ -2150,8 +2694,183 @@ namespace ngcomp
                           innermatrix = make_shared<ElementByElementMatrix<SCAL>>(ndof, ne);
                       }
                     */
-                    IterateElements
-                      (*fespace, vb, clh,  [&] (FESpace::Element el, LocalHeap & lh)
+                    // other objects rely on exclusive element access, or the
+                    // storage has no atomic add (complex DiagonalMatrix), or
+                    // is assembled with dynamic blocks (SparseBlockMatrix)
+                    bool needs_coloring = preconditioners.Size() ||
+                      (linearform && eliminate_internal && !keep_internal) ||
+                      diagonal || dynamic_cast<ElementByElementMatrix<SCAL>*> (&GetMatrix()) ||
+                      dynamic_cast<SparseBlockMatrix<SCAL>*> (&GetMatrix());
+
+                    // condensation in SIMD batches, added atomically when the batch is full
+                    bool condense_batched = batch_condense && is_same<SCAL,double>::value &&
+                      eliminate_internal && keep_internal && !store_inner && !spd &&
+                      !printelmat && !elmat_ev && !needs_coloring;
+                    
+                    bool colored = !(atomic_assembly || condense_batched) || needs_coloring;
+
+                    Array<Array<unique_ptr<StatCondBatch>>> thread_batches(condense_batched ? TaskManager::GetMaxThreads() : 0);
+                    auto get_batch = [&] (size_t sizei, size_t sizeo) -> StatCondBatch &
+                      {
+                        auto & batches = thread_batches[TaskManager::GetThreadId()];
+                        for (auto & batch : batches)
+                          if (batch->sizei == sizei && batch->sizeo == sizeo)
+                            return *batch;
+                        batches.Append (make_unique<StatCondBatch> (sizei, sizeo));
+                        return *batches.Last();
+                      };
+
+                    auto condense_batch = [&] (StatCondBatch & batch, LocalHeap & lh)
+                      {
+                        if constexpr (is_same<SCAL,double>::value)
+                          {
+                            static Timer t("static condensation batched", NoTracing);
+                            RegionTimer reg(t);
+                            HeapReset hr(lh);
+                        
+                            constexpr size_t BS = StatCondBatch::BS;
+                            size_t dim = fespace->GetDimension();
+                            size_t sizei = dim*batch.sizei, sizeo = dim*batch.sizeo;
+
+                            FlatArray<int> idofs(sizei, lh), odofs(sizeo, lh);
+                            auto set_local_dofs = [&] (size_t l)
+                              {
+                                for (size_t j = 0, k = 0; j < batch.sizei; j++)
+                                  for (size_t jj = 0; jj < dim; jj++)
+                                    idofs[k++] = dim*batch.idofs1[l][j]+jj;
+                                for (size_t j = 0, k = 0; j < batch.sizeo; j++)
+                                  for (size_t jj = 0; jj < dim; jj++)
+                                    odofs[k++] = dim*batch.odofs1[l][j]+jj;
+                              };
+
+                            // inner block d, coupling blocks b = A_oi and c = A_io^T, one element per lane
+                            FlatMatrix<SIMD<double>> d(sizei, sizei, lh), b(sizeo, sizei, lh), c(sizeo, sizei, lh);
+                            for (size_t l = 0; l < BS; l++)
+                              {
+                                if (l >= batch.cnt)
+                                  {
+                                    for (size_t i = 0; i < sizei; i++)
+                                      for (size_t j = 0; j < sizei; j++)
+                                        ((double*)&d(i,j))[l] = (i == j) ? 1 : 0;
+                                    for (size_t i = 0; i < sizeo; i++)
+                                      for (size_t j = 0; j < sizei; j++)
+                                        ((double*)&b(i,j))[l] = ((double*)&c(i,j))[l] = 0;
+                                    continue;
+                                  }
+                                set_local_dofs (l);
+                                auto & elmat = batch.elmats[l];
+                                for (size_t i = 0; i < sizei; i++)
+                                  for (size_t j = 0; j < sizei; j++)
+                                    ((double*)&d(i,j))[l] = elmat(idofs[i], idofs[j]);
+                                for (size_t i = 0; i < sizeo; i++)
+                                  for (size_t j = 0; j < sizei; j++)
+                                    {
+                                      ((double*)&b(i,j))[l] = elmat(odofs[i], idofs[j]);
+                                      ((double*)&c(i,j))[l] = elmat(idofs[j], odofs[i]);
+                                    }
+                              }
+
+                            if (!BatchInverse (d))
+                              {
+                                // small pivots: element-wise inverse with pivoting
+                                FlatMatrix<double> dl(sizei, sizei, lh);
+                                for (size_t l = 0; l < BS; l++)
+                                  {
+                                    if (l < batch.cnt)
+                                      {
+                                        set_local_dofs (l);
+                                        dl = batch.elmats[l].Rows(idofs).Cols(idofs);
+                                        CalcInverse (dl);
+                                      }
+                                    else
+                                      dl = Identity(sizei);
+                                    for (size_t i = 0; i < sizei; i++)
+                                      for (size_t j = 0; j < sizei; j++)
+                                        ((double*)&d(i,j))[l] = dl(i,j);
+                                  }
+                              }
+
+                            // he = -d^{-1} c^T,  het = -b d^{-1},  schur = A_oo + b he
+                            FlatMatrix<SIMD<double>> he(sizei, sizeo, lh), het(sizeo, sizei, lh), schur(sizeo, sizeo, lh);
+                            for (size_t i = 0; i < sizei; i++)
+                              for (size_t j = 0; j < sizeo; j++)
+                                {
+                                  SIMD<double> sum = 0.0;
+                                  for (size_t k = 0; k < sizei; k++)
+                                    sum += d(i,k) * c(j,k);
+                                  he(i,j) = -sum;
+                                }
+                            if (!symmetric)
+                              for (size_t i = 0; i < sizeo; i++)
+                                for (size_t j = 0; j < sizei; j++)
+                                  {
+                                    SIMD<double> sum = 0.0;
+                                    for (size_t k = 0; k < sizei; k++)
+                                      sum += b(i,k) * d(k,j);
+                                    het(i,j) = -sum;
+                                  }
+                            for (size_t i = 0; i < sizeo; i++)
+                              for (size_t j = 0; j < sizeo; j++)
+                                {
+                                  SIMD<double> sum = 0.0;
+                                  for (size_t k = 0; k < sizei; k++)
+                                    sum += b(i,k) * he(k,j);
+                                  schur(i,j) = sum;
+                                }
+
+                            FlatMatrix<double> hel(sizei, sizeo, lh), hetl(sizeo, sizei, lh), dl(sizei, sizei, lh);
+                            for (size_t l = 0; l < batch.cnt; l++)
+                              {
+                                set_local_dofs (l);
+                                auto & elmat = batch.elmats[l];
+                                auto & dnums = batch.dnums[l];
+                                ElementId ei(batch.vb, batch.elnrs[l]);
+
+                                Array<int> idnums(sizei, lh), ednums(sizeo, lh);
+                                for (size_t j = 0, k = 0; j < batch.sizei; j++)
+                                  for (size_t jj = 0; jj < dim; jj++)
+                                    idnums[k++] = dim*dnums[batch.idofs1[l][j]]+jj;
+                                for (size_t j = 0, k = 0; j < batch.sizeo; j++)
+                                  for (size_t jj = 0; jj < dim; jj++)
+                                    ednums[k++] = dim*dnums[batch.odofs1[l][j]]+jj;
+
+                                for (size_t i = 0; i < sizei; i++)
+                                  for (size_t j = 0; j < sizei; j++)
+                                    dl(i,j) = d(i,j)[l];
+                                for (size_t i = 0; i < sizei; i++)
+                                  for (size_t j = 0; j < sizeo; j++)
+                                    hel(i,j) = he(i,j)[l];
+                            
+                                harmonicext_ptr->AddElementMatrix(ei.Nr(),idnums,ednums,hel);
+                                if (!symmetric)
+                                  {
+                                    for (size_t i = 0; i < sizeo; i++)
+                                      for (size_t j = 0; j < sizei; j++)
+                                        hetl(i,j) = het(i,j)[l];
+                                    harmonicexttrans_ptr->AddElementMatrix(ei.Nr(),ednums,idnums,hetl);
+                                  }
+                                innersolve_ptr->AddElementMatrix(ei.Nr(),idnums,idnums,dl);
+
+                                for (size_t i = 0; i < sizeo; i++)
+                                  for (size_t j = 0; j < sizeo; j++)
+                                    elmat(odofs[i], odofs[j]) += schur(i,j)[l];
+                            
+                                for (auto k : batch.idofs1[l])
+                                  dnums[k] = NO_DOF_NR;
+                            
+                                AddElementMatrix (dnums, dnums, elmat, ei, !colored, lh);
+                            
+                                if (check_unused)
+                                  for (auto dof : dnums)
+                                    if (IsRegularDof(dof)) useddof[dof] = true;
+                              }
+                            batch.cnt = 0;
+                          }
+                      };
+                    
+                    // batch_elmat is the precomputed element matrix of a batched element, or empty
+                    auto assemble_element = [&] (FESpace::Element el, LocalHeap & lh,
+                                                 FlatMatrix<double> batch_elmat)
                        {
                          if (elmat_ev && vb == VOL) 
                            *testout << " Assemble Element " << el.Nr() << endl;  
@@ -2253,6 +2972,12 @@ namespace ngcomp
                                }
                              */
                              bool done = false;
+                             if (batch_elmat.Height())
+                               {
+                                 sum_elmat = batch_elmat;
+                                 elem_has_integrator = true;
+                                 done = true;
+                               }
                              while (!done)
                                {
                                  done = true;
@@ -2347,6 +3072,25 @@ namespace ngcomp
                                  *testout << "idofs1 = " << idofs1 << endl;
                                }
                              
+                             if (condense_batched && idofs1.Size() && !has_hidden)
+                               {
+                                 auto & batch = get_batch (idofs1.Size(), odofs1.Size());
+                                 size_t l = batch.cnt++;
+                                 batch.vb = vb;
+                                 batch.elnrs[l] = el.Nr();
+                                 batch.dnums[l] = dnums;
+                                 batch.idofs1[l] = idofs1;
+                                 batch.odofs1[l] = odofs1;
+                                 if constexpr (is_same<SCAL,double>::value)
+                                   {
+                                     batch.elmats[l].SetSize (sum_elmat.Height(), sum_elmat.Width());
+                                     batch.elmats[l] = sum_elmat;
+                                   }
+                                 if (batch.cnt == StatCondBatch::BS)
+                                   condense_batch (batch, lh);
+                                 return;
+                               }
+                             
                              if (idofs1.Size())
                                {
                                  HeapReset hr (lh);
@@ -2587,7 +3331,7 @@ namespace ngcomp
                              *testout<< "elem " << el << ", elmat = " << endl << sum_elmat << endl;
                            }
                          
-                         AddElementMatrix (dnums, dnums, sum_elmat, el, false, lh);
+                         AddElementMatrix (dnums, dnums, sum_elmat, el, !colored, lh);
 			 
                          for (auto pre : preconditioners)
                            pre -> AddElementMatrix (dnums, sum_elmat, el, lh);
@@ -2600,7 +3344,20 @@ namespace ngcomp
                                if (IsRegularDof(d)) useddof[d] = true;
                            }
                          // timer3_VB[vb].Stop();
-                       });
+                       };
+
+                    if (vb == VOL && element_batch && is_same<SCAL,double>::value && !printelmat && !elmat_ev)
+                      IterateElementBatches (colored, clh, assemble_element);
+                    else
+                      IterateElements
+                        (*fespace, vb, clh, colored, [&] (FESpace::Element el, LocalHeap & lh)
+                         {
+                           assemble_element (std::move(el), lh, FlatMatrix<double>());
+                         });
+                    for (auto & batches : thread_batches)
+                      for (auto & batch : batches)
+                        if (batch->cnt)
+                          condense_batch (*batch, clh);
                     progress.Done();
                     
                     /*
@@ -3935,10 +4692,19 @@ namespace ngcomp
     RegionTimer reg (timer);
     BaseStatusHandler::Region ("Assemble Linearization");
 
-    if (specialelements_timestamp > graph_timestamp)
+    if (specialelements_timestamp > graph_timestamp && !reallocate)
       {
-        reallocate = true;
-        cout << IM(3) << "reallocate due to changed special elements" << endl;
+        if (SpecialElementsInGraph())
+          {
+            cout << IM(3) << "changed special elements fit into matrix graph" << endl;
+            graph_timestamp = GetNextTimeStamp();
+          }
+        else
+          {
+            reallocate = true;
+            reuse_element_graph = true;
+            cout << IM(3) << "reallocate due to changed special elements" << endl;
+          }
       }
 
     if(reallocate && this->mats.Size())
@@ -5084,8 +5850,9 @@ namespace ngcomp
                    x.GetIndirect (dnums, elvecx);
                    this->fespace->TransformVec (el, elvecx, TRANSFORM_SOL);
 
-                   for (auto & bfi : VB_parts[vb])
+                   for (size_t j = 0; j < VB_parts[vb].Size(); j++)
                      {
+                       auto & bfi = VB_parts[vb][j];
                        if (!bfi->DefinedOn (el.GetIndex())) continue;
                        if (!bfi->DefinedOnElement (el.Nr())) continue;
 
@@ -5093,7 +5860,8 @@ namespace ngcomp
 
                        {
                          // RegionTimer reg (timer_applyelmat);
-                         bfi->ApplyElementMatrix (fel, mapped_trafo, elvecx, elvecy, 0, lh);
+                         bfi->ApplyElementMatrix (fel, mapped_trafo, elvecx, elvecy,
+                                                  this->GetPrecomputedData (el, j), lh);
                        }
                        
                        this->fespace->TransformVec (el, elvecy, TRANSFORM_RHS);
@@ -5625,13 +6393,15 @@ namespace ngcomp
                    x.GetIndirect (dnums1, elvecx);
                    this->fespace->TransformVec (ei, elvecx, TRANSFORM_SOL);
 
-                   for (auto & bfi : VB_parts[vb])
+                   for (size_t j = 0; j < VB_parts[vb].Size(); j++)
                      {
+                       auto & bfi = VB_parts[vb][j];
                        if (!bfi->DefinedOn (this->ma->GetElIndex (ei))) continue;
                        if (!bfi->DefinedOnElement (ei.Nr())) continue;                        
 
                        MixedFiniteElement fel(fel1, fel2);
-                       bfi->ApplyElementMatrix (fel, eltrans, elvecx, elvecy, 0, lh);
+                       bfi->ApplyElementMatrix (fel, eltrans, elvecx, elvecy,
+                                                this->GetPrecomputedData (ei, j), lh);
                        
                        this->fespace2->TransformVec (ei, elvecy, TRANSFORM_RHS);
         
@@ -7534,7 +8304,7 @@ namespace ngcomp
     int nr = id.Nr();
     if (id.IsBoundary()) nr += this->ma->GetNE();
 
-    if (addatomic) throw Exception ("atomic add for EBE Matrix not implemented");    
+    // every element writes its own slot, no atomics needed
     dynamic_cast<ElementByElementMatrix<SCAL>&> (this->GetMatrix()).AddElementMatrix (nr, dnums1, dnums2, elmat);
   }
   
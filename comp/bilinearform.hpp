@@ -45,6 +45,18 @@ namespace ngcomp
     bool matrix_free_bdb = false;
     /// stores geom-free B factors, and D factors in integration points, and compiled CF
     bool nonlinear_matrix_free_bdb = false;
+    /// computes volume element matrices of equivalent elements in SIMD batches
+    bool element_batch = false;
+    /// assemble without element coloring, adding atomically into the matrix
+    bool atomic_assembly = false;
+    /// static condensation of elements with equal dof counts in SIMD batches
+    bool batch_condense = false;
+    /// reassemble as linear combination of matrices of terms affine in Parameters
+    bool affine_parameters = false;
+    /// the parameters, and the matrix values of the constant and the affine terms
+    Array<shared_ptr<CoefficientFunction>> affine_params;
+    Array<shared_ptr<BaseVector>> affine_terms;
+    size_t affine_timestamp = 0;
     /// store matrices on mesh hierarchy
     bool multilevel;
     /// galerkin projection of coarse grid matrices
@@ -97,6 +109,13 @@ namespace ngcomp
     
     size_t specialelements_timestamp = 0;
 
+    /// graph rows of elements and DG facets, kept while there are special elements
+    Table<int> element_graph;
+    /// mesh timestamp, space timestamp and ndof of element_graph
+    size_t element_graph_timestamp = 0, element_graph_fes_timestamp = 0, element_graph_ndof = 0;
+    /// next GetGraph may reuse element_graph (only special elements changed)
+    bool reuse_element_graph = false;
+
     
     /*
     Array<BilinearFormIntegrator*> independent_parts;
@@ -123,8 +142,10 @@ namespace ngcomp
     
     /// precomputes some data for each element
     bool precompute;
-    /// precomputed element-wise data
-    Array<void*> precomputed_data;
+    /// precomputed element-wise data, [elnr*VB_parts[vb].Size()+integrator]
+    Array<void*> precomputed_data[4];
+    /// memory of the precomputed data
+    Array<unique_ptr<LocalHeap>> precomputed_heaps;
     /// output of norm of matrix entries
     bool checksum;
     ///
@@ -203,6 +224,8 @@ namespace ngcomp
     auto & GetSpecialElements() const { return specialelements; }
     void DeleteSpecialElement(size_t index);
     void DeleteSpecialElements();
+    /// are all couplings of the special elements in the current matrix graph ?
+    bool SpecialElementsInGraph () const;
     Table<int> & SpecialElementColoring() const;
     
     /// for static condensation of internal bubbles
@@ -224,6 +247,9 @@ namespace ngcomp
     /// if reallocate is false, the existing matrix is reused
     void ReAssemble (LocalHeap & lh, bool reallocate = 0);
 
+    /// for nonassemble: store the mapped integration rules of all elements
+    void PrecomputeElementData ();
+
     /// assembles matrix at linearization point given by lin
     /// needed for Newton's method
     virtual void AssembleLinearization (const BaseVector & lin,
@@ -330,6 +356,14 @@ namespace ngcomp
     /// uses mixed spaces (non operational)
     bool MixedSpaces () const { return fespace2 != NULL; }
 
+    /// precomputed data of integrator nr in VB_parts[ei.VB()], or nullptr
+    void * GetPrecomputedData (ElementId ei, size_t nr) const
+    {
+      auto & data = precomputed_data[ei.VB()];
+      if (data.Size() == 0) return nullptr;
+      return data[ei.Nr()*VB_parts[ei.VB()].Size()+nr];
+    }
+
     /// returns the second space (form mixed spaces)
     // const FESpace & GetFESpace2() const { return *fespace2; }
 
@@ -435,6 +469,17 @@ namespace ngcomp
     virtual void DoAssemble (LocalHeap & lh) = 0;
     void AssembleGF (LocalHeap & lh);
     void AssembleBDB (LocalHeap & lh, bool linear);
+    /**
+       Iterates the volume elements like IterateElements. Equivalent elements
+       are grouped into SIMD batches, their element matrices are computed
+       together and passed to func, other elements get an empty matrix.
+    */
+    void IterateElementBatches (bool colored, LocalHeap & lh,
+                                const function<void(FESpace::Element,LocalHeap&,FlatMatrix<double>)> & func);
+    /// assembles via affine_terms, falls back to DoAssemble if the form is not affine
+    void AssembleAffine (LocalHeap & lh);
+    /// matrix = affine_terms[0] + sum_i value(param_i) affine_terms[i+1], in one pass
+    void CombineAffineTerms ();
 
     /// allocates (sparse) matrix data-structure
     virtual void AllocateMatrix () = 0;
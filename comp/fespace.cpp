@@ -525,6 +525,9 @@ lot of new non-zero entries in the matrix!\n" << endl;
     */
     if (low_order_space) low_order_space -> FinalizeUpdate();
 
+    // the dof numbering may have changed (order, definedon, ...)
+    timestamp = NGS_Object::GetNextTimeStamp();
+
     UpdateFreeDofs();
     
     
@@ -2136,6 +2139,61 @@ lot of new non-zero entries in the matrix!\n" << endl;
   }
   
 
+  void IterateElements (const FESpace & fes, 
+			VorB vb, 
+			LocalHeap & clh, 
+                        bool colored,
+			const function<void(FESpace::Element,LocalHeap&)> & func)
+  {
+    if (colored)
+      {
+        IterateElements (fes, vb, clh, func);
+        return;
+      }
+
+    static Timer t("IterateElements - uncolored");
+    RegionTimer reg(t);
+    
+    static mutex copyex_mutex;
+    Exception * ex = nullptr;
+    size_t ne = fes.GetMeshAccess()->GetNE(vb);
+    SharedLoop2 sl(ne);
+
+    ParallelJob
+      ( [&] (const TaskInfo & ti) 
+        {
+          LocalHeap lh = clh.Split(ti.thread_nr, ti.nthreads);
+          ArrayMem<int,100> temp_dnums;
+          
+          for (size_t nr : sl)
+            {
+              ElementId ei(vb, nr);
+              if (!fes.DefinedOn(ei)) continue;
+              try
+                {
+                  HeapReset hr(lh);
+                  FESpace::Element el(fes, ei, temp_dnums, lh);
+                  func (std::move(el), lh);
+                }
+              catch (const Exception & e)
+                {
+                  lock_guard<mutex> guard(copyex_mutex);
+                  if (!ex)
+                    ex = new Exception (e);
+                }
+            }
+          ProgressOutput::SumUpLocal();
+        } );
+
+    if (ex)
+      {
+        Exception e(*ex);
+        delete ex;
+        throw e;
+      }
+  }
+  
+
   ostream & operator<< (ostream & ost, COUPLING_TYPE ct)
   {
     switch (ct)
@@ -868,6 +868,16 @@ ANY                  1 1 1 1 | 15
 			       VorB vb, 
 			       LocalHeap & clh, 
 			       const function<void(FESpace::Element,LocalHeap&)> & func);
+
+  /*
+    colored = false iterates over all elements in one parallel loop.
+    Elements sharing dofs may run concurrently, func must add atomically.
+  */
+  extern NGS_DLL_HEADER void IterateElements (const FESpace & fes,
+			       VorB vb, 
+			       LocalHeap & clh, 
+			       bool colored,
+			       const function<void(FESpace::Element,LocalHeap&)> & func);
  
 
 
@@ -13,6 +13,7 @@
 #include <multigrid.hpp> 
 #include "../fem/h1hofe.hpp"
 #include "../fem/h1hofefo.hpp"
+#include "../fem/h1hofetp.hpp"
 #include <../fem/hdivhofe.hpp>
 #include <../fem/facethofe.hpp>
 #include <../fem/nodalhofe.hpp>
@@ -394,6 +395,7 @@ namespace ngcomp
       throw Exception ("Flag 'smoothing' for fespace is obsolete \n Please use flag 'blocktype' in preconditioner instead");
     nodalp2 = flags.GetDefineFlag ("nodalp2");
     nodal = flags.GetDefineFlag ("nodal");    
+    tensorproduct = flags.GetDefineFlag ("tp");
     
     highest_order_dc = flags.GetDefineFlag ("highest_order_dc");
     if (highest_order_dc && order < 2)
@@ -554,6 +556,8 @@ into the wirebasket.
     docu.Arg("hoprolongation") = "bool = false\n"
       "  (experimental, only trigs) creates high order prolongation,\n"
       "  and switches off low-order space";
+    docu.Arg("tp") = "bool = false\n"
+      "  Use sum-factorization for evaluation on quads and hexes";
     docu.Arg("orderinner");
     docu.Arg("orderedge");
     docu.Arg("orderface");    
@@ -1116,7 +1120,16 @@ into the wirebasket.
                  constexpr ELEMENT_TYPE ET = et.ElementType();
                  
                  Ngs_Element ngel = ma->GetElement<et.DIM,VOL> (elnr);
-                 auto * hofe =  new (alloc) H1HighOrderFE<ET> ();
+                 H1HighOrderFE<ET> * hofe;
+                 if constexpr (ET == ET_QUAD || ET == ET_HEX)
+                   {
+                     if (tensorproduct)
+                       hofe = new (alloc) H1HighOrderFETP<ET> ();
+                     else
+                       hofe = new (alloc) H1HighOrderFE<ET> ();
+                   }
+                 else
+                   hofe = new (alloc) H1HighOrderFE<ET> ();
                  
                  hofe -> SetVertexNumbers (ngel.Vertices());
                  
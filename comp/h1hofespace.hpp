@@ -52,6 +52,8 @@ namespace ngcomp
     bool nodalp2;
     bool nodal;
     bool highest_order_dc;
+    /// sum-factorization on quads and hexes
+    bool tensorproduct;
     bool test_ho_prolongation;    
   public:
 
@@ -2515,6 +2515,8 @@ diffop : ngsolve.fem.DifferentialOperator
     .def(py::self - py::self)
     .def(float() * py::self)
     .def(Complex() * py::self)    
+    .def("__rmul__", [](shared_ptr<SumOfIntegrals> igls, shared_ptr<CoefficientFunction> cf)
+         { return make_shared<SumOfIntegrals> (cf * *igls); })
     .def_property("linearization",
                   [](const SumOfIntegrals& ints)
                   {
@@ -2658,6 +2660,11 @@ space : ngsolve.FESpace
                      "  BilinearForm will not allocate memory for assembling.\n"
                      "  optimization feature for (nonlinear) problems where the\n"
                      "  form is only applied but never assembled.",
+                     py::arg("precompute") = "bool = False\n"
+                     "  with nonassemble: store inverse Jacobians and weights (and points,\n"
+                     "  if the integrand needs them) of all elements at Assemble, and reuse\n"
+                     "  them in every application. Otherwise geometry is evaluated on the fly.\n"
+                     "  The memory used is listed in __memory__.",
                      py::arg("project") = "bool = False\n"
                      "  When calling bf.Assemble, all saved coarse matrices from\n"
                      "  mesh refinements are updated as well using a Galerkin projection\n"
@@ -2676,6 +2683,21 @@ space : ngsolve.FESpace
                      "  store BDB factors seperately",
                      py::arg("nonlinear_matrix_free_bdb") = "bool = False\n"
                      "  store BDB factors seperately for nonlinear operators",
+                     py::arg("element_batch") = "bool = False\n"
+                     "  compute volume element matrices of elements with equal type,\n"
+                     "  region and vertex ordering together, one element per SIMD lane.\n"
+                     "  Used for symbolic integrators with point-wise coefficients.",
+                     py::arg("atomic_assembly") = "bool = False\n"
+                     "  assemble all elements in one parallel loop without element\n"
+                     "  coloring, matrix entries are added atomically",
+                     py::arg("batch_condense") = "bool = False\n"
+                     "  with condense: eliminate the internal dofs of elements with equal\n"
+                     "  numbers of inner and outer dofs together, one element per SIMD lane.\n"
+                     "  Elements are added without coloring, as with atomic_assembly.",
+                     py::arg("affine_parameters") = "bool = False\n"
+                     "  for integrands affine in Parameters (or ParameterC): store the matrices of the\n"
+                     "  affine terms once, Assemble then only combines them with the\n"
+                     "  current parameter values. Other coefficients must not change.",
                      py::arg("check_unused") = "bool = True\n"
 		     "  If set prints warnings if not UNUSED_DOFS are not used.",
                      py::arg("delete_zero_elements") = "double = unset\n"
@@ -12,6 +12,13 @@
 #include <unistd.h>   // for mkdtemp
 #endif
 
+#ifndef WIN32
+#include <unistd.h>   // for getpid
+#include <fcntl.h>    // for the code cache lock
+#include <sys/utsname.h>
+#include <cerrno>
+#endif
+
 namespace ngfem
 {
   bool code_uses_tensors = false;
@@ -40,6 +47,9 @@ namespace ngfem
   
     atomic<unsigned> Code::id_counter{0};
 
+    // marks code with object addresses, such libraries are valid only in this process
+    static const string code_pointer_marker = "/* ngsolve object address */";
+
     void Code::AddLinkFlag(string flag)
     {
         if(std::find(std::begin(link_flags), std::end(link_flags), flag) == std::end(link_flags))
@@ -59,7 +69,7 @@ namespace ngfem
         string value_expression = s_ptr.str();
         if(type.find('*') != string::npos)
           value_expression = "reinterpret_cast<" + type + ">(" + value_expression + ")";
-        pointer += "[[maybe_unused]] " + qualifiers + " " + type + " " + name + " = " + value_expression + ";\n";
+        pointer += "[[maybe_unused]] " + qualifiers + " " + type + " " + name + " = " + value_expression + "; " + code_pointer_marker + "\n";
         return name;
     }
 
@@ -129,14 +139,13 @@ namespace ngfem
 
 
   
-    unique_ptr<SharedLibrary> CompileCode(const std::vector<std::variant<filesystem::path, string>> &codes, const std::vector<string> &link_flags, bool keep_files, optional<string> compiler, optional<string> linker)
+    // compiles and links the codes in lib_dir, returns the path of the library
+    static filesystem::path CompileLibrary(const std::vector<std::variant<filesystem::path, string>> &codes, const std::vector<string> &link_flags, filesystem::path lib_dir, optional<string> compiler, optional<string> linker)
     {
       static ngstd::Timer tcompile("CompiledCF::Compile");
       static ngstd::Timer tlink("CompiledCF::Link");
       string object_files;
 
-      filesystem::path cwd = filesystem::absolute(".");
-      filesystem::path lib_dir = CreateTempDir();
       string chdir_cmd = "cd " + lib_dir.string() + " && ";
 
       for(auto i : Range(codes.size())) {
@@ -202,6 +211,270 @@ namespace ngfem
       if (err) throw Exception ("problem calling linker, command: " + slink);
       tlink.Stop();
       cout << IM(3) << "done" << endl;
+      return lib_file;
+    }
+
+    static filesystem::path GetCodeCacheDir()
+    {
+      if (auto dir = getenv("NGSOLVE_JIT_CACHE_DIR"))
+        return dir;   // empty string disables the cache
+#ifdef WIN32
+      return {};
+#else // WIN32
+      if (auto dir = getenv("XDG_CACHE_HOME"))
+        return filesystem::path(dir) / "ngsolve" / "jit";
+      if (auto dir = getenv("HOME"))
+        return filesystem::path(dir) / ".cache" / "ngsolve" / "jit";
+      return {};
+#endif // WIN32
+    }
+
+#ifndef WIN32
+    static string ReadCodeFile(filesystem::path file)
+    {
+      ifstream in(file, ios::binary);
+      stringstream content;
+      content << in.rdbuf();
+      return content.str();
+    }
+
+    // the executable of a tool command, searched in PATH
+    static filesystem::path FindTool(const string & cmd)
+    {
+      string name = cmd.substr(0, cmd.find(' '));
+      if (name.find('/') != string::npos)
+        return name;
+      if (auto path = getenv("PATH"))
+        {
+          stringstream dirs(path);
+          string dir;
+          while (getline(dirs, dir, ':'))
+            if (!dir.empty() && filesystem::exists(filesystem::path(dir) / name))
+              return filesystem::path(dir) / name;
+        }
+      return {};
+    }
+
+    // key of the cache entry: FNV-1a hash of sources, flags, tools, host and ngsolve version
+    static string CodeCacheKey(const std::vector<std::variant<filesystem::path, string>> &codes, const std::vector<string> &link_flags, optional<string> compiler, optional<string> linker)
+    {
+      uint64_t hash = 14695981039346656037ull;
+      auto add = [&hash] (const string & s)
+      {
+        for (unsigned char c : s)
+          hash = (hash ^ c) * 1099511628211ull;
+        hash = (hash ^ 0xff) * 1099511628211ull;  // separator
+      };
+
+      add(ngsolve_version);
+
+      // the ngscxx/ngsld scripts contain the compile flags, e.g. -march=native
+      for (string tool : { compiler.value_or("ngscxx"), linker.value_or("ngsld") })
+        {
+          add(tool);
+          auto file = FindTool(tool);
+          if (!file.empty())
+            add(ReadCodeFile(file));
+        }
+
+      // a cache in a shared home directory may be used by different cpus
+      struct utsname host;
+      if (uname(&host) == 0)
+        add(host.machine);
+      ifstream cpuinfo("/proc/cpuinfo");
+      for (string line; getline(cpuinfo, line); )
+        if (line.rfind("model name", 0) == 0 || line.rfind("flags", 0) == 0)
+          add(line);
+        else if (line.empty())
+          break;    // first processor only
+
+      for (auto & code : codes)
+        if (std::holds_alternative<filesystem::path>(code))
+          add(ReadCodeFile(std::get<filesystem::path>(code)));
+        else
+          add(std::get<string>(code));
+      for (auto & flag : link_flags)
+        add(flag);
+
+      stringstream key;
+      key << std::hex << setw(16) << setfill('0') << hash;
+      return key.str();
+    }
+
+    // exclusive lock on a file, works between processes, also on NFS
+    class CodeCacheLock
+    {
+      int fd;
+    public:
+      CodeCacheLock(filesystem::path file)
+      {
+        fd = open(file.c_str(), O_RDWR | O_CREAT, 0666);
+        if (fd < 0)
+          throw Exception("could not open lock file " + file.string());
+        struct flock fl = {};
+        fl.l_type = F_WRLCK;
+        fl.l_whence = SEEK_SET;
+        while (fcntl(fd, F_SETLKW, &fl) == -1)
+          if (errno != EINTR)
+            {
+              close(fd);
+              throw Exception("could not lock file " + file.string());
+            }
+      }
+      ~CodeCacheLock() { close(fd); }   // releases the lock
+    };
+
+    // files of the cache: 16 hex digits key, and ".so", ".lock" or ".so.<pid>"
+    enum CodeCacheFile { NO_CACHE_FILE, CACHE_LIBRARY, CACHE_TEMPORARY };
+    static CodeCacheFile GetCodeCacheFileType(const string & name)
+    {
+      auto all_of = [] (string s, auto pred)
+      {
+        return std::all_of(s.begin(), s.end(), [pred] (unsigned char c) { return pred(c); });
+      };
+      if (name.size() < 16 || !all_of(name.substr(0, 16), ::isxdigit))
+        return NO_CACHE_FILE;
+      string ext = name.substr(16);
+      if (ext == ".so")
+        return CACHE_LIBRARY;
+      if (ext == ".lock")
+        return CACHE_TEMPORARY;
+      if (ext.size() > 4 && ext.substr(0, 4) == ".so." && all_of(ext.substr(4), ::isdigit))
+        return CACHE_TEMPORARY;
+      return NO_CACHE_FILE;
+    }
+
+    // removes the least recently used libraries if the cache exceeds
+    // NGSOLVE_JIT_CACHE_SIZE megabytes (default 1024), and leftovers of crashed processes.
+    // Other files in the directory are not touched.
+    static void TrimCodeCache(filesystem::path cache_dir)
+    {
+      size_t limit = 1024;
+      if (auto size = getenv("NGSOLVE_JIT_CACHE_SIZE"))
+        limit = atol(size);
+      limit *= 1024*1024;
+
+      std::error_code ec;
+      auto now = filesystem::file_time_type::clock::now();
+      std::vector<std::tuple<filesystem::file_time_type, size_t, filesystem::path>> libs;
+      size_t total = 0;
+      for (auto & entry : filesystem::directory_iterator(cache_dir, ec))
+        {
+          auto file = entry.path();
+          auto type = GetCodeCacheFileType(file.filename().string());
+          if (type == NO_CACHE_FILE || !entry.is_regular_file(ec)) continue;
+          auto time = entry.last_write_time(ec);
+          if (ec) continue;
+          if (type == CACHE_LIBRARY)
+            {
+              size_t size = entry.file_size(ec);
+              if (ec) continue;
+              libs.emplace_back(time, size, file);
+              total += size;
+            }
+          else if (now - time > std::chrono::hours(24))
+            filesystem::remove(file, ec);   // temporary copy or lock file of a crashed process
+        }
+
+      std::sort(libs.begin(), libs.end());
+      for (auto & [time, size, file] : libs)
+        {
+          if (total <= limit) break;
+          // processes which loaded the library keep their mapping
+          if (filesystem::remove(file, ec))
+            total -= size;
+        }
+    }
+#endif // WIN32
+
+    unique_ptr<SharedLibrary> CompileCode(const std::vector<std::variant<filesystem::path, string>> &codes, const std::vector<string> &link_flags, bool keep_files, optional<string> compiler, optional<string> linker)
+    {
+#ifndef WIN32
+      auto cache_dir = GetCodeCacheDir();
+      // code with object addresses is valid only in this process, it is not cached
+      bool has_pointers = false;
+      for (auto & code : codes)
+        if (std::holds_alternative<string>(code) &&
+            std::get<string>(code).find(code_pointer_marker) != string::npos)
+          has_pointers = true;
+
+      if (!keep_files && !has_pointers && !cache_dir.empty())
+        {
+          std::error_code ec;
+          filesystem::create_directories(cache_dir, ec);
+          if (!ec)
+            {
+              string key = CodeCacheKey(codes, link_flags, compiler, linker);
+              auto cached_lib = cache_dir / (key + ".so");
+              // another process may evict the library before it is loaded, then it is compiled again
+              auto load_cached = [&] () -> unique_ptr<SharedLibrary>
+                {
+                  if (!filesystem::exists(cached_lib, ec))
+                    return nullptr;
+                  try
+                    {
+                      auto library = make_unique<SharedLibrary>(cached_lib);
+                      cout << IM(3) << "loaded cached library " << cached_lib.string() << endl;
+                      // the modification time orders the entries for eviction
+                      filesystem::last_write_time(cached_lib, filesystem::file_time_type::clock::now(), ec);
+                      return library;
+                    }
+                  catch (const std::exception & e)
+                    {
+                      cout << IM(3) << "could not load cached library: " << e.what() << endl;
+                      return nullptr;
+                    }
+                };
+              if (auto library = load_cached())
+                return library;
+
+              // the first process compiles, the others wait and load its library
+              auto lock_file = cache_dir / (key + ".lock");
+              unique_ptr<CodeCacheLock> lock;
+              try
+                {
+                  lock = make_unique<CodeCacheLock>(lock_file);
+                }
+              catch (const std::exception & e)
+                {
+                  cout << IM(3) << "code cache not available: " << e.what() << endl;
+                }
+
+              if (lock)
+                {
+                  if (auto library = load_cached())
+                    return library;
+
+                  filesystem::path lib_dir = CreateTempDir();
+                  auto lib_file = CompileLibrary(codes, link_flags, lib_dir, compiler, linker);
+                  try
+                    {
+                      // copy to a temporary name first, such that readers never see a partial library
+                      auto tmp_lib = cache_dir / (key + ".so." + ToString(getpid()));
+                      filesystem::copy_file(lib_file, tmp_lib, filesystem::copy_options::overwrite_existing);
+                      filesystem::rename(tmp_lib, cached_lib);
+                      // if another process evicted it already, the library of lib_dir is used
+                      auto library = make_unique<SharedLibrary>(cached_lib);
+                      filesystem::remove_all(lib_dir, ec);
+                      // waiting processes find the library, later ones do not need the lock
+                      filesystem::remove(lock_file, ec);
+                      TrimCodeCache(cache_dir);
+                      return library;
+                    }
+                  catch (const std::exception & e)
+                    {
+                      cout << IM(3) << "could not store library in code cache: " << e.what() << endl;
+                      return make_unique<SharedLibrary>(lib_file, lib_dir);
+                    }
+                }
+            }
+          else
+            cout << IM(3) << "cannot create code cache directory " << cache_dir.string() << endl;
+        }
+#endif // WIN32
+
+      filesystem::path lib_dir = CreateTempDir();
+      auto lib_file = CompileLibrary(codes, link_flags, lib_dir, compiler, linker);
       if(keep_files)
       {
           cout << IM(2) << "keeping generated files at " << lib_dir.string() << endl;
@@ -0,0 +1,322 @@
+/*********************************************************************/
+/* File:   h1hofetp.cpp                                              */
+/* Purpose: sum-factorized H1 elements on quads and hexes            */
+/* Date:   2026                                                      */
+/*********************************************************************/
+
+#include <h1hofe_impl.hpp>
+#include <tscalarfe_impl.hpp>
+#include "h1hofetp.hpp"
+#include "sumfactorization.hpp"
+
+namespace ngfem
+{
+
+  // 1-x, x, and the bubbles x(1-x) IntLegNoBubble_k(2x-1) as in H1HighOrderFE_Shape
+  template <typename FUNC>
+  static void CalcH1Shape1D (int order, AutoDiff<1> x, FUNC func)
+  {
+    func(0, 1-x);
+    func(1, x);
+    if (order >= 2)
+      IntLegNoBubble::EvalMult (order-2, 2*x-1, x*(1-x),
+                                SBLambda ([&] (size_t k, AutoDiff<1> val)
+                                          { func(k+2, val); }));
+  }
+
+
+  template <ELEMENT_TYPE ET>
+  bool H1HighOrderFETP<ET> :: GetTensorMap (FlatArray<int> tpind, FlatArray<double> sign) const
+  {
+    int p = order;
+    int n = p+1;
+    for (int i = 0; i < N_EDGE; i++)
+      if (order_edge[i] != p) return false;
+    for (int i = 0; i < N_FACE; i++)
+      if (order_face[i][0] != p || order_face[i][1] != p) return false;
+    if constexpr (DIM == 3)
+      if (order_cell[0][0] != p || order_cell[0][1] != p || order_cell[0][2] != p) return false;
+    if (this->nodalp2) return false;
+
+    const POINT3D * verts = ElementTopology::GetVertices(ET);
+    auto index = [n] (IVec<DIM> ind)
+      {
+        int ii = 0;
+        for (int d = 0; d < DIM; d++)
+          ii = n*ii + ind[d];
+        return ii;
+      };
+    // IntLegNoBubble_k(-x) = (-1)^k IntLegNoBubble_k(x)
+    auto parity = [] (bool flip, int k) { return (flip && k%2) ? -1.0 : 1.0; };
+
+    int ii = 0;
+    for (int v = 0; v < N_VERTEX; v++, ii++)
+      {
+        IVec<DIM> ind;
+        for (int d = 0; d < DIM; d++)
+          ind[d] = int(verts[v][d]);
+        tpind[ii] = index(ind);
+        sign[ii] = 1;
+      }
+
+    for (int i = 0; i < N_EDGE; i++)
+      {
+        IVec<2> e = this->GetVertexOrientedEdge(i);
+        IVec<DIM> ind;
+        int dir = 0;
+        for (int d = 0; d < DIM; d++)
+          if (verts[e[0]][d] != verts[e[1]][d])
+            dir = d;
+          else
+            ind[d] = int(verts[e[0]][d]);
+        bool flip = verts[e[1]][dir] < verts[e[0]][dir];
+        for (int k = 0; k < p-1; k++, ii++)
+          {
+            ind[dir] = 2+k;
+            tpind[ii] = index(ind);
+            sign[ii] = parity(flip, k);
+          }
+      }
+
+    for (int i = 0; i < N_FACE; i++)
+      {
+        IVec<4> f = this->GetVertexOrientedFace(i);
+        IVec<DIM> ind;
+        int dirx = 0, diry = 0;
+        for (int d = 0; d < DIM; d++)
+          if (verts[f[0]][d] != verts[f[1]][d])
+            dirx = d;
+          else if (verts[f[0]][d] != verts[f[3]][d])
+            diry = d;
+          else
+            ind[d] = int(verts[f[0]][d]);
+        bool flipx = verts[f[0]][dirx] < verts[f[1]][dirx];
+        bool flipy = verts[f[0]][diry] < verts[f[3]][diry];
+        for (int k = 0; k < p-1; k++)
+          for (int j = 0; j < p-1; j++, ii++)
+            {
+              ind[dirx] = 2+k;
+              ind[diry] = 2+j;
+              tpind[ii] = index(ind);
+              sign[ii] = parity(flipx, k) * parity(flipy, j);
+            }
+      }
+
+    if constexpr (DIM == 3)
+      for (int i = 0; i < p-1; i++)
+        for (int j = 0; j < p-1; j++)
+          for (int k = 0; k < p-1; k++, ii++)
+            {
+              tpind[ii] = index(IVec<3>(2+i, 2+j, 2+k));
+              sign[ii] = 1;
+            }
+    return true;
+  }
+
+
+  /*
+    1D shape matrices shapes[d] and derivatives dshapes[d] for the
+    directions of the tensor product rule, calls func(shapes, dshapes)
+   */
+  template <int DIM, typename FUNC>
+  static void WithShapes1D (int order, const SIMD_IntegrationRule & ir, FUNC func)
+  {
+    const SIMD_IntegrationRule * irs[3] = { &ir.GetIRX(), &ir.GetIRY(), DIM==3 ? &ir.GetIRZ() : nullptr };
+    size_t nshape = 0;
+    for (int d = 0; d < DIM; d++)
+      nshape += irs[d]->GetNIP()*(order+1);
+
+    STACK_ARRAY(double, mem, 2*nshape);
+    ArrayMem<FlatMatrix<>,3> shapes(DIM), dshapes(DIM);
+    double * pmem = mem;
+    for (int d = 0; d < DIM; d++)
+      {
+        size_t nip = irs[d]->GetNIP();
+        shapes[d].AssignMemory (nip, order+1, pmem);
+        dshapes[d].AssignMemory (nip, order+1, pmem+nip*(order+1));
+        pmem += 2*nip*(order+1);
+        SumFactShapes1D (*irs[d],
+                         [order] (AutoDiff<1> x, auto f) { CalcH1Shape1D (order, x, f); },
+                         shapes[d], dshapes[d]);
+      }
+    func (shapes, dshapes);
+  }
+
+  /// shapes, with derivative in direction dir
+  static void SelectShapes (FlatArray<FlatMatrix<>> shapes, FlatArray<FlatMatrix<>> dshapes,
+                            int dir, FlatArray<FlatMatrix<>> sel)
+  {
+    for (size_t d = 0; d < shapes.Size(); d++)
+      {
+        auto & m = (int(d) == dir) ? dshapes[d] : shapes[d];
+        sel[d].AssignMemory (m.Height(), m.Width(), m.Data());
+      }
+  }
+
+  template <int DIM>
+  static void SumFactEvaluate (FlatArray<FlatMatrix<>> shapes, FlatVector<> tcoefs, FlatVector<> values)
+  {
+    if constexpr (DIM == 2)
+      SumFactEvaluate (shapes[0], shapes[1], tcoefs, values);
+    else
+      SumFactEvaluate (shapes[0], shapes[1], shapes[2], tcoefs, values);
+  }
+
+  template <int DIM>
+  static void SumFactAddTrans (FlatArray<FlatMatrix<>> shapes, FlatVector<> values, FlatVector<> tcoefs)
+  {
+    if constexpr (DIM == 2)
+      SumFactAddTrans (shapes[0], shapes[1], values, tcoefs);
+    else
+      SumFactAddTrans (shapes[0], shapes[1], shapes[2], values, tcoefs);
+  }
+
+
+  template <ELEMENT_TYPE ET>
+  void H1HighOrderFETP<ET> ::
+  Evaluate (const SIMD_IntegrationRule & ir,
+            BareSliceVector<> coefs,
+            BareVector<SIMD<double>> values) const
+  {
+    STACK_ARRAY(int, mem_tpind, this->ndof);
+    STACK_ARRAY(double, mem_sign, this->ndof);
+    FlatArray<int> tpind(this->ndof, mem_tpind);
+    FlatArray<double> sign(this->ndof, mem_sign);
+    if (!ir.IsTP() || !GetTensorMap (tpind, sign))
+      {
+        TBASE::Evaluate (ir, coefs, values);
+        return;
+      }
+
+    static Timer t("H1TP evaluate"); RegionTimer reg(t);
+
+    size_t ndof = this->ndof;
+    STACK_ARRAY(double, mem_tcoefs, ndof);
+    FlatVector<> tcoefs(ndof, mem_tcoefs);
+    for (size_t i = 0; i < ndof; i++)
+      tcoefs(tpind[i]) = sign[i] * coefs(i);
+
+    WithShapes1D<DIM> (order, ir, [&] (auto & shapes, auto & dshapes)
+      {
+        values(ir.Size()-1) = 0.0;
+        SumFactEvaluate<DIM> (shapes, tcoefs, FlatVector<> (ir.GetNIP(), (double*)&values(0)));
+      });
+  }
+
+  template <ELEMENT_TYPE ET>
+  void H1HighOrderFETP<ET> ::
+  AddTrans (const SIMD_IntegrationRule & ir,
+            BareVector<SIMD<double>> values,
+            BareSliceVector<> coefs) const
+  {
+    STACK_ARRAY(int, mem_tpind, this->ndof);
+    STACK_ARRAY(double, mem_sign, this->ndof);
+    FlatArray<int> tpind(this->ndof, mem_tpind);
+    FlatArray<double> sign(this->ndof, mem_sign);
+    if (!ir.IsTP() || !GetTensorMap (tpind, sign))
+      {
+        TBASE::AddTrans (ir, values, coefs);
+        return;
+      }
+
+    static Timer t("H1TP AddTrans"); RegionTimer reg(t);
+
+    size_t ndof = this->ndof;
+    STACK_ARRAY(double, mem_tcoefs, ndof);
+    FlatVector<> tcoefs(ndof, mem_tcoefs);
+    tcoefs = 0.0;
+
+    WithShapes1D<DIM> (order, ir, [&] (auto & shapes, auto & dshapes)
+      {
+        SumFactAddTrans<DIM> (shapes, FlatVector<> (ir.GetNIP(), (double*)&values(0)), tcoefs);
+      });
+    for (size_t i = 0; i < ndof; i++)
+      coefs(i) += sign[i] * tcoefs(tpind[i]);
+  }
+
+  template <ELEMENT_TYPE ET>
+  void H1HighOrderFETP<ET> ::
+  EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceVector<> coefs,
+                BareSliceMatrix<SIMD<double>> values) const
+  {
+    auto & ir = mir.IR();
+    STACK_ARRAY(int, mem_tpind, this->ndof);
+    STACK_ARRAY(double, mem_sign, this->ndof);
+    FlatArray<int> tpind(this->ndof, mem_tpind);
+    FlatArray<double> sign(this->ndof, mem_sign);
+    if (!ir.IsTP() || mir.DimSpace() != DIM || !GetTensorMap (tpind, sign))
+      {
+        TBASE::EvaluateGrad (mir, coefs, values);
+        return;
+      }
+
+    static Timer t("H1TP EvaluateGrad"); RegionTimer reg(t);
+
+    size_t ndof = this->ndof;
+    STACK_ARRAY(double, mem_tcoefs, ndof);
+    FlatVector<> tcoefs(ndof, mem_tcoefs);
+    for (size_t i = 0; i < ndof; i++)
+      tcoefs(tpind[i]) = sign[i] * coefs(i);
+
+    // reference gradient, then covariant transformation
+    WithShapes1D<DIM> (order, ir, [&] (auto & shapes, auto & dshapes)
+      {
+        ArrayMem<FlatMatrix<>,3> sel(DIM);
+        for (int j = 0; j < DIM; j++)
+          {
+            SelectShapes (shapes, dshapes, j, sel);
+            values(j, ir.Size()-1) = 0.0;
+            SumFactEvaluate<DIM> (sel, tcoefs, FlatVector<> (ir.GetNIP(), (double*)&values(j,0)));
+          }
+      });
+    mir.TransformGradient (values);
+  }
+
+  template <ELEMENT_TYPE ET>
+  void H1HighOrderFETP<ET> ::
+  AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceMatrix<SIMD<double>> values,
+                BareSliceVector<> coefs) const
+  {
+    auto & ir = mir.IR();
+    STACK_ARRAY(int, mem_tpind, this->ndof);
+    STACK_ARRAY(double, mem_sign, this->ndof);
+    FlatArray<int> tpind(this->ndof, mem_tpind);
+    FlatArray<double> sign(this->ndof, mem_sign);
+    if (!ir.IsTP() || mir.DimSpace() != DIM || !GetTensorMap (tpind, sign))
+      {
+        TBASE::AddGradTrans (mir, values, coefs);
+        return;
+      }
+
+    static Timer t("H1TP AddGradTrans"); RegionTimer reg(t);
+
+    // reference gradient values, keep the input unchanged
+    STACK_ARRAY(SIMD<double>, mem_refvalues, DIM*ir.Size());
+    FlatMatrix<SIMD<double>> refvalues(DIM, ir.Size(), mem_refvalues);
+    refvalues = values.AddSize(DIM, ir.Size());
+    mir.TransformGradientTrans (refvalues);
+
+    size_t ndof = this->ndof;
+    STACK_ARRAY(double, mem_tcoefs, ndof);
+    FlatVector<> tcoefs(ndof, mem_tcoefs);
+    tcoefs = 0.0;
+
+    WithShapes1D<DIM> (order, ir, [&] (auto & shapes, auto & dshapes)
+      {
+        ArrayMem<FlatMatrix<>,3> sel(DIM);
+        for (int j = 0; j < DIM; j++)
+          {
+            SelectShapes (shapes, dshapes, j, sel);
+            SumFactAddTrans<DIM> (sel, FlatVector<> (ir.GetNIP(), (double*)&refvalues(j,0)), tcoefs);
+          }
+      });
+    for (size_t i = 0; i < ndof; i++)
+      coefs(i) += sign[i] * tcoefs(tpind[i]);
+  }
+
+
+  template class H1HighOrderFETP<ET_QUAD>;
+  template class H1HighOrderFETP<ET_HEX>;
+}
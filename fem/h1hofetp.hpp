@@ -0,0 +1,64 @@
+#ifndef H1HOFETP_HPP
+#define H1HOFETP_HPP
+
+#include "h1hofe.hpp"
+
+namespace ngfem
+{
+
+  /*
+    H1 high order element on quads and hexes with sum-factorized
+    evaluation in tensor product integration rules.
+
+    For uniform order p every shape function is, up to its sign, the
+    product of 1D functions 1-x, x, and x(1-x) IntLegNoBubble_k(2x-1).
+    The dofs are mapped to the (p+1)^D tensor coefficients, and the
+    evaluation is done by SumFactEvaluate/SumFactAddTrans.
+    Other integration rules, or non-uniform orders, use the base class.
+   */
+  template <ELEMENT_TYPE ET>
+  class H1HighOrderFETP : public H1HighOrderFE<ET>
+  {
+    typedef H1HighOrderFE<ET> TBASE;
+    enum { DIM = ET_trait<ET>::DIM };
+    using TBASE::order;
+    using TBASE::order_edge;
+    using TBASE::order_face;
+    using TBASE::order_cell;
+    using TBASE::N_VERTEX;
+    using TBASE::N_EDGE;
+    using TBASE::N_FACE;
+  public:
+    H1HighOrderFETP () { ; }
+    H1HighOrderFETP (int aorder) : TBASE(aorder) { ; }
+
+    /// index of dof in tensor coefficients, and sign. false if orders are not uniform
+    bool GetTensorMap (FlatArray<int> tpind, FlatArray<double> sign) const;
+
+    using TBASE::Evaluate;
+    using TBASE::AddTrans;
+    using TBASE::EvaluateGrad;
+    using TBASE::AddGradTrans;
+
+    virtual void Evaluate (const SIMD_IntegrationRule & ir,
+                           BareSliceVector<> coefs,
+                           BareVector<SIMD<double>> values) const override;
+
+    virtual void AddTrans (const SIMD_IntegrationRule & ir,
+                           BareVector<SIMD<double>> values,
+                           BareSliceVector<> coefs) const override;
+
+    virtual void EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                               BareSliceVector<> coefs,
+                               BareSliceMatrix<SIMD<double>> values) const override;
+
+    virtual void AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir,
+                               BareSliceMatrix<SIMD<double>> values,
+                               BareSliceVector<> coefs) const override;
+  };
+
+  extern template class H1HighOrderFETP<ET_QUAD>;
+  extern template class H1HighOrderFETP<ET_HEX>;
+}
+
+#endif
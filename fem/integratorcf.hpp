@@ -223,6 +223,13 @@ namespace ngfem
     return faccf;
   }
 
+  inline auto operator* (shared_ptr<CoefficientFunction> fac, SumOfIntegrals c1)
+  {
+    SumOfIntegrals faccf;
+    for (auto & ci : c1.icfs) faccf.icfs += ci->CreateSameIntegralType(fac*(ci->cf));
+    return faccf;
+  }
+
   inline auto operator- (const SumOfIntegrals & c1, const SumOfIntegrals & c2)
   {
     return c1 + (-1)*c2;
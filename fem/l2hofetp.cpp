@@ -2,6 +2,7 @@
 #include "l2hofe.hpp"
 #include "l2hofetp.hpp"
 #include "../fem/tscalarfe_impl.hpp"
+#include "sumfactorization.hpp"
 
 namespace ngfem
 {
@@ -334,6 +335,111 @@ namespace ngfem
   }
 
 
+
+
+  // Legendre polynomials P_a(f*(2x-1)) and derivatives in the points of a 1D rule
+  static void LegendreShapes1D (int order, double f, const SIMD_IntegrationRule & ir1d,
+                                FlatMatrix<> shape, FlatMatrix<> dshape)
+  {
+    SumFactShapes1D (ir1d, [order,f] (AutoDiff<1> x, auto func)
+                     { LegendrePolynomial (order, f*(2*x-1), SBLambda(func)); },
+                     shape, dshape);
+  }
+
+  void L2HighOrderFETP<ET_QUAD> ::
+  EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceVector<> bcoefs,
+                BareSliceMatrix<SIMD<double>> values) const
+  {
+    auto & ir = mir.IR();
+    if (ir.IsTP() && mir.DimSpace() == 2)
+      {
+        static Timer t("quad EvaluateGrad");
+        RegionTimer reg(t);
+
+        double facx[] = { -1, 1, 1, -1 };
+        double facy[] = { -1, -1, 1, 1 };
+        IVec<4> f = GetFaceSort (0, vnums);
+        bool flip = (facx[f[0]] == facx[f[1]]);
+
+        auto & irx = ir.GetIRX();
+        auto & iry = ir.GetIRY();
+        size_t nipx = irx.GetNIP(), nipy = iry.GetNIP();
+        size_t n = order+1;
+
+        STACK_ARRAY(double, mem_shapes, 2*n*(nipx+nipy));
+        FlatMatrix<> shapex(nipx, n, mem_shapes), dshapex(nipx, n, mem_shapes+n*nipx);
+        FlatMatrix<> shapey(nipy, n, mem_shapes+2*n*nipx), dshapey(nipy, n, mem_shapes+2*n*nipx+n*nipy);
+        LegendreShapes1D (order, facx[f[0]], irx, shapex, dshapex);
+        LegendreShapes1D (order, facy[f[0]], iry, shapey, dshapey);
+
+        // tensor coefficients, first index in x-direction
+        STACK_ARRAY(double, mem_coefs, n*n);
+        FlatMatrix<> tcoefs(n, n, mem_coefs);
+        for (size_t i = 0, ii = 0; i < n; i++)
+          for (size_t j = 0; j < n; j++, ii++)
+            if (flip)
+              tcoefs(j, i) = bcoefs(ii);
+            else
+              tcoefs(i, j) = bcoefs(ii);
+        FlatVector<> vcoefs(n*n, mem_coefs);
+
+        values(0, ir.Size()-1) = 0.0;
+        values(1, ir.Size()-1) = 0.0;
+        SumFactEvaluate (dshapex, shapey, vcoefs, FlatVector<>(ir.GetNIP(), (double*)&values(0,0)));
+        SumFactEvaluate (shapex, dshapey, vcoefs, FlatVector<>(ir.GetNIP(), (double*)&values(1,0)));
+        mir.TransformGradient (values);
+        return;
+      }
+    TBASE::EvaluateGrad (mir, bcoefs, values);
+  }
+
+  void L2HighOrderFETP<ET_QUAD> ::
+  AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceMatrix<SIMD<double>> values,
+                BareSliceVector<> bcoefs) const
+  {
+    auto & ir = mir.IR();
+    if (ir.IsTP() && mir.DimSpace() == 2)
+      {
+        static Timer t("quad AddGradTrans");
+        RegionTimer reg(t);
+
+        double facx[] = { -1, 1, 1, -1 };
+        double facy[] = { -1, -1, 1, 1 };
+        IVec<4> f = GetFaceSort (0, vnums);
+        bool flip = (facx[f[0]] == facx[f[1]]);
+
+        auto & irx = ir.GetIRX();
+        auto & iry = ir.GetIRY();
+        size_t nipx = irx.GetNIP(), nipy = iry.GetNIP();
+        size_t n = order+1;
+
+        STACK_ARRAY(double, mem_shapes, 2*n*(nipx+nipy));
+        FlatMatrix<> shapex(nipx, n, mem_shapes), dshapex(nipx, n, mem_shapes+n*nipx);
+        FlatMatrix<> shapey(nipy, n, mem_shapes+2*n*nipx), dshapey(nipy, n, mem_shapes+2*n*nipx+n*nipy);
+        LegendreShapes1D (order, facx[f[0]], irx, shapex, dshapex);
+        LegendreShapes1D (order, facy[f[0]], iry, shapey, dshapey);
+
+        STACK_ARRAY(SIMD<double>, mem_refvalues, 2*ir.Size());
+        FlatMatrix<SIMD<double>> refvalues(2, ir.Size(), mem_refvalues);
+        refvalues = values.AddSize(2, ir.Size());
+        mir.TransformGradientTrans (refvalues);
+
+        STACK_ARRAY(double, mem_coefs, n*n);
+        FlatMatrix<> tcoefs(n, n, mem_coefs);
+        FlatVector<> vcoefs(n*n, mem_coefs);
+        vcoefs = 0.0;
+        SumFactAddTrans (dshapex, shapey, FlatVector<>(ir.GetNIP(), (double*)&refvalues(0,0)), vcoefs);
+        SumFactAddTrans (shapex, dshapey, FlatVector<>(ir.GetNIP(), (double*)&refvalues(1,0)), vcoefs);
+
+        for (size_t i = 0, ii = 0; i < n; i++)
+          for (size_t j = 0; j < n; j++, ii++)
+            bcoefs(ii) += flip ? tcoefs(j, i) : tcoefs(i, j);
+        return;
+      }
+    TBASE::AddGradTrans (mir, values, bcoefs);
+  }
   
   
   // template class L2HighOrderFETP<ET_QUAD>;
@@ -671,6 +777,51 @@ namespace ngfem
   }
   
 
+  void L2HighOrderFETP<ET_HEX> ::
+  EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                BareSliceVector<> bcoefs,
+                BareSliceMatrix<SIMD<double>> values) const
+  {
+    auto & ir = mir.IR();
+    if (ir.IsTP() && mir.DimSpace() == 3)
+      {
+        static Timer t("hex EvaluateGrad");
+        RegionTimer reg(t);
+
+        auto & irx = ir.GetIRX();
+        auto & iry = ir.GetIRY();
+        auto & irz = ir.GetIRZ();
+        size_t nipx = irx.GetNIP(), nipy = iry.GetNIP(), nipz = irz.GetNIP();
+        size_t n = order+1;
+        size_t ndof = n*n*n;
+
+        STACK_ARRAY(double, mem_shapes, 2*n*(nipx+nipy+nipz));
+        double * pmem = mem_shapes;
+        FlatMatrix<> shapex(nipx, n, pmem), dshapex(nipx, n, pmem+n*nipx);
+        pmem += 2*n*nipx;
+        FlatMatrix<> shapey(nipy, n, pmem), dshapey(nipy, n, pmem+n*nipy);
+        pmem += 2*n*nipy;
+        FlatMatrix<> shapez(nipz, n, pmem), dshapez(nipz, n, pmem+n*nipz);
+        LegendreShapes1D (order, 1, irx, shapex, dshapex);
+        LegendreShapes1D (order, 1, iry, shapey, dshapey);
+        LegendreShapes1D (order, 1, irz, shapez, dshapez);
+
+        STACK_ARRAY(double, mem_coefs, ndof);
+        FlatVector<> coefs(ndof, mem_coefs);
+        coefs = bcoefs.Range(0, ndof);
+
+        for (int j = 0; j < 3; j++)
+          values(j, ir.Size()-1) = 0.0;
+        SumFactEvaluate (dshapex, shapey, shapez, coefs, FlatVector<>(ir.GetNIP(), (double*)&values(0,0)));
+        SumFactEvaluate (shapex, dshapey, shapez, coefs, FlatVector<>(ir.GetNIP(), (double*)&values(1,0)));
+        SumFactEvaluate (shapex, shapey, dshapez, coefs, FlatVector<>(ir.GetNIP(), (double*)&values(2,0)));
+        mir.TransformGradient (values);
+        return;
+      }
+    TBASE::EvaluateGrad (mir, bcoefs, values);
+  }
+
+
   L2HighOrderFETP<ET_HEX> :: ~L2HighOrderFETP() { ; }   
 }
 
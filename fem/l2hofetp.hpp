@@ -1109,6 +1109,16 @@ namespace ngfem
     virtual void AddTrans (const SIMD_IntegrationRule & ir,
                            BareVector<SIMD<double>> values,
                            BareSliceVector<> coefs) const override;    
+
+    using TBASE::EvaluateGrad;
+    using TBASE::AddGradTrans;
+    virtual void EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                               BareSliceVector<> bcoefs,
+                               BareSliceMatrix<SIMD<double>> values) const override;
+
+    virtual void AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir,
+                               BareSliceMatrix<SIMD<double>> values,
+                               BareSliceVector<> bcoefs) const override;
   };
   
 
@@ -1139,6 +1149,11 @@ namespace ngfem
                            BareVector<SIMD<double>> values,
                            BareSliceVector<> coefs) const override;
 
+    using TBASE::EvaluateGrad;
+    virtual void EvaluateGrad (const SIMD_BaseMappedIntegrationRule & mir,
+                               BareSliceVector<> bcoefs,
+                               BareSliceMatrix<SIMD<double>> values) const override;
+
     virtual void AddGradTrans (const SIMD_BaseMappedIntegrationRule & mir,
                                BareSliceMatrix<SIMD<double>> values,
                                BareSliceVector<> bcoefs) const override;
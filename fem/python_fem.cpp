@@ -1070,7 +1070,12 @@ Compile list of individual steps, experimental improvement for deep trees
 Parameters:
 
 realcompile : bool
-  True -> Compile to C++ code
+  True -> Compile to C++ code. Libraries are cached in the directory
+  NGSOLVE_JIT_CACHE_DIR (default ~/.cache/ngsolve/jit, empty string
+  disables the cache) and reused by later runs with the same code.
+  The least recently used libraries are removed when the cache exceeds
+  NGSOLVE_JIT_CACHE_SIZE megabytes (default 1024). Code containing
+  object addresses, e.g. of a Parameter, is not cached
 
 maxderiv : int
   input maximal derivative
@@ -1079,7 +1084,7 @@ wait : bool
   True -> Waits until the previous Compile call is finished before start compiling
 
 keep_files : bool
-  True -> Keep temporary files
+  True -> Keep temporary files, always compiles
 
 )raw_string"))
 
@@ -0,0 +1,115 @@
+#ifndef FILE_SUMFACTORIZATION
+#define FILE_SUMFACTORIZATION
+
+/*
+  Sum-factorization kernels for tensor product elements (quad/hex).
+
+  The coefficients are a tensor c(a,b) or c(a,b,c), the first index
+  (x-direction) running slowest. The values are in the points of the
+  tensor product integration rule, (ix,iy) or (ix,iy,iz), the z-index
+  running fastest.
+  shape_d(i,a) is the a-th 1D basis function in the i-th point of direction d.
+
+  Costs are O(p^3) in 2D and O(p^4) in 3D, instead of O(p^4) and O(p^6).
+*/
+
+namespace ngfem
+{
+
+  inline void SumFactEvaluate (FlatMatrix<> shapex, FlatMatrix<> shapey,
+                               FlatVector<> coefs, FlatVector<> values)
+  {
+    size_t na = shapex.Width(), nb = shapey.Width();
+    size_t nipx = shapex.Height(), nipy = shapey.Height();
+    FlatMatrix<> mcoefs(na, nb, coefs.Data());
+    FlatMatrix<> mvalues(nipx, nipy, values.Data());
+
+    STACK_ARRAY(double, mem1, na*nipy);
+    FlatMatrix<> temp1(na, nipy, mem1);
+    temp1 = mcoefs * Trans(shapey);
+    mvalues = shapex * temp1;
+  }
+
+  inline void SumFactAddTrans (FlatMatrix<> shapex, FlatMatrix<> shapey,
+                               FlatVector<> values, FlatVector<> coefs)
+  {
+    size_t na = shapex.Width(), nb = shapey.Width();
+    size_t nipx = shapex.Height(), nipy = shapey.Height();
+    FlatMatrix<> mcoefs(na, nb, coefs.Data());
+    FlatMatrix<> mvalues(nipx, nipy, values.Data());
+
+    STACK_ARRAY(double, mem1, na*nipy);
+    FlatMatrix<> temp1(na, nipy, mem1);
+    temp1 = Trans(shapex) * mvalues;
+    mcoefs += temp1 * shapey;
+  }
+
+  inline void SumFactEvaluate (FlatMatrix<> shapex, FlatMatrix<> shapey, FlatMatrix<> shapez,
+                               FlatVector<> coefs, FlatVector<> values)
+  {
+    size_t na = shapex.Width(), nb = shapey.Width(), nc = shapez.Width();
+    size_t nipx = shapex.Height(), nipy = shapey.Height(), nipz = shapez.Height();
+    FlatMatrix<> mcoefs(na*nb, nc, coefs.Data());
+    FlatMatrix<> mvalues(nipx, nipy*nipz, values.Data());
+
+    // contract z
+    STACK_ARRAY(double, mem1, na*nb*nipz);
+    FlatMatrix<> temp1(na*nb, nipz, mem1);
+    temp1 = mcoefs * Trans(shapez);
+
+    // contract y
+    STACK_ARRAY(double, mem2, na*nipy*nipz);
+    FlatMatrix<> temp2(na*nipy, nipz, mem2);
+    for (size_t a = 0; a < na; a++)
+      temp2.Rows(a*nipy, (a+1)*nipy) = shapey * temp1.Rows(a*nb, (a+1)*nb);
+
+    // contract x
+    FlatMatrix<> temp2x(na, nipy*nipz, mem2);
+    mvalues = shapex * temp2x;
+  }
+
+  inline void SumFactAddTrans (FlatMatrix<> shapex, FlatMatrix<> shapey, FlatMatrix<> shapez,
+                               FlatVector<> values, FlatVector<> coefs)
+  {
+    size_t na = shapex.Width(), nb = shapey.Width(), nc = shapez.Width();
+    size_t nipx = shapex.Height(), nipy = shapey.Height(), nipz = shapez.Height();
+    FlatMatrix<> mcoefs(na*nb, nc, coefs.Data());
+    FlatMatrix<> mvalues(nipx, nipy*nipz, values.Data());
+
+    STACK_ARRAY(double, mem2, na*nipy*nipz);
+    FlatMatrix<> temp2x(na, nipy*nipz, mem2);
+    temp2x = Trans(shapex) * mvalues;
+
+    FlatMatrix<> temp2(na*nipy, nipz, mem2);
+    STACK_ARRAY(double, mem1, na*nb*nipz);
+    FlatMatrix<> temp1(na*nb, nipz, mem1);
+    for (size_t a = 0; a < na; a++)
+      temp1.Rows(a*nb, (a+1)*nb) = Trans(shapey) * temp2.Rows(a*nipy, (a+1)*nipy);
+
+    mcoefs += temp1 * shapez;
+  }
+
+
+  /*
+    1D shape functions (rows = points) and their derivatives for the
+    points of a 1D SIMD-rule. calc_shape (x, func) calls func(a, shape_a(x))
+    for AutoDiff<1> argument x.
+  */
+  template <typename FUNC>
+  void SumFactShapes1D (const SIMD_IntegrationRule & ir1d, FUNC calc_shape,
+                        FlatMatrix<> shape, FlatMatrix<> dshape)
+  {
+    for (size_t i = 0; i < ir1d.GetNIP(); i++)
+      {
+        AutoDiff<1> adx (ir1d[i / SIMD<double>::Size()](0)[i % SIMD<double>::Size()], 0);
+        calc_shape (adx, [&] (size_t a, AutoDiff<1> val)
+                    {
+                      shape(i, a) = val.Value();
+                      dshape(i, a) = val.DValue(0);
+                    });
+      }
+  }
+
+}
+
+#endif
@@ -1981,6 +1981,240 @@ namespace ngfem
   }
 
 
+  bool SymbolicBilinearFormIntegrator :: SupportsElementBatch () const
+  {
+    // coefficients must only depend on the point, not on the element number
+    if (element_vb != VOL || !simd_evaluate || has_interpolate ||
+        gridfunction_cfs.Size() || cache_cfs.Size())
+      return false;
+
+    // the lanes share the transformation of the first element, only the
+    // points and Jacobians are per lane. Leaves which may look at the
+    // transformation (element number, vertices, ...) are not batched.
+    bool pointwise = true;
+    cf->TraverseTree
+      ([&] (CoefficientFunction & nodecf)
+       {
+         if (nodecf.InputCoefficientFunctions().Size()) return;
+         if (dynamic_cast<ProxyFunction*> (&nodecf) ||
+             dynamic_cast<ConstantCoefficientFunction*> (&nodecf) ||
+             dynamic_cast<ParameterCoefficientFunction<double>*> (&nodecf) ||
+             nodecf.GetDescription().rfind("coordinate ", 0) == 0)
+           return;
+         pointwise = false;
+       });
+    return pointwise;
+  }
+
+  
+  bool SymbolicBilinearFormIntegrator ::
+  CalcElementMatrixBatch (const FiniteElement & fel,
+                          FlatArray<const ElementTransformation*> trafos,
+                          FlatMatrix<double> elmats,
+                          LocalHeap & lh) const
+  {
+    static Timer t("SymbolicBFI::CalcElementMatrixBatch", NoTracing);
+    RegionTimer reg(t);
+
+    constexpr size_t SW = SIMD<double>::Size();
+    size_t nel = trafos.Size();
+    int dim = fel.Dim();
+
+    if (!SupportsElementBatch() || nel == 0 || nel > SW) return false;
+    if (typeid(fel) == typeid(const MixedFiniteElement&)) return false;
+    if (dim < 1 || dim > 3 || trafos[0]->SpaceDim() != dim) return false;
+
+    HeapReset hr(lh);
+    const ElementTransformation & trafo = *trafos[0];
+    auto save_userdata = trafo.PushUserData();
+    size_t h = elmats.Width();
+
+    try
+      {
+        Switch<3> (dim-1, [&] (auto ICDIM)
+          {
+            constexpr int DIM = ICDIM.value+1;
+
+            // geometry of all elements, evaluated with the usual SIMD rule
+            const SIMD_IntegrationRule & simd_ir = Get_SIMD_IntegrationRule (fel, lh);
+            size_t nip = simd_ir.GetNIP();
+            FlatArray<SIMD_MappedIntegrationRule<DIM,DIM>*> elmirs(nel, lh);
+            for (size_t e = 0; e < nel; e++)
+              elmirs[e] = &static_cast<SIMD_MappedIntegrationRule<DIM,DIM>&> ((*trafos[e])(simd_ir, lh));
+
+            FlatMatrix<SIMD<double>> belmat(h, h, lh);
+            belmat = SIMD<double>(0.0);
+            
+            constexpr size_t BS = 64;
+            for (size_t ii = 0; ii < nip; ii += BS)
+              {
+                HeapReset hr(lh);
+                size_t bs = min2(BS, nip-ii);
+
+                // one SIMD point per reference point, lane e is element e
+                FlatArray<SIMD<IntegrationPoint>> hip(bs, lh);
+                for (size_t i = 0; i < bs; i++)
+                  {
+                    size_t q = ii+i;
+                    hip[i] = [&] (int) { return simd_ir[q/SW][q%SW]; };
+                  }
+                SIMD_IntegrationRule ir(bs, hip.Data());
+                SIMD_MappedIntegrationRule<DIM,DIM> mir(ir, trafo, -1, lh);
+
+                for (size_t i = 0; i < bs; i++)
+                  {
+                    size_t q = ii+i, iq = q/SW, jq = q%SW;
+                    // unused lanes repeat the last element
+                    auto elmip = [&] (int e) -> auto & { return (*elmirs[min2(size_t(e), nel-1)])[iq]; };
+                    for (int k = 0; k < DIM; k++)
+                      {
+                        mir[i].Point()(k) = SIMD<double> ([&] (int e) { return elmip(e).GetPoint()(k)[jq]; });
+                        for (int l = 0; l < DIM; l++)
+                          mir[i].Jacobian()(k,l) = SIMD<double> ([&] (int e) { return elmip(e).GetJacobian()(k,l)[jq]; });
+                      }
+                    mir[i].Compute();
+                  }
+
+                ProxyUserData ud;
+                const_cast<ElementTransformation&>(trafo).userdata = &ud;
+
+                int k1 = 0;
+                int k1nr = 0;
+                for (auto proxy1 : trial_proxies)
+                  {
+                    int l1 = 0;
+                    int l1nr = 0;
+                    for (auto proxy2 : test_proxies)
+                      {
+                        size_t dim_proxy1 = proxy1->Dimension();
+                        size_t dim_proxy2 = proxy2->Dimension();
+                        size_t tt_pair = l1nr*trial_proxies.Size()+k1nr;
+
+                        if (nonzeros_proxies(tt_pair))
+                          {
+                            HeapReset hr(lh);
+                            bool is_diagonal = diagonal_proxies(tt_pair);
+                            bool samediffop = same_diffops(tt_pair);
+
+                            FlatMatrix<SIMD<double>> proxyvalues(dim_proxy1*dim_proxy2, bs, lh);
+                            FlatMatrix<SIMD<double>> diagproxyvalues(dim_proxy1, bs, lh);
+
+                            IntRange r1 = proxy1->Evaluator()->UsedDofs(fel);
+                            IntRange r2 = proxy2->Evaluator()->UsedDofs(fel);
+
+                            FlatMatrix<SIMD<double>> bbmat1(h * dim_proxy1, bs, lh);
+                            FlatMatrix<SIMD<double>> bdbmat1(h * dim_proxy2, bs, lh);
+                            FlatMatrix<SIMD<double>> bbmat2 = samediffop ?
+                              bbmat1 : FlatMatrix<SIMD<double>>(h * dim_proxy2, bs, lh);
+                            FlatMatrix<SIMD<double>> hbdbmat1(h, dim_proxy2 * bs, bdbmat1.Data());
+                            FlatMatrix<SIMD<double>> hbbmat2(h, dim_proxy2 * bs, bbmat2.Data());
+
+                            if (ddcf_dtest_dtrial(l1nr, k1nr))
+                              {
+                                ddcf_dtest_dtrial(l1nr, k1nr)->Evaluate(mir, proxyvalues);
+                                if (is_diagonal)
+                                  for (auto k : Range(dim_proxy1))
+                                    diagproxyvalues.Row(k) = proxyvalues.Row(k*(dim_proxy1 + 1));
+                              }
+                            else if (!is_diagonal)
+                              {
+                                for (size_t k = 0, kk = 0; k < dim_proxy1; k++)
+                                  for (size_t l = 0; l < dim_proxy2; l++, kk++)
+                                    if (nonzeros(l1+l, k1+k))
+                                      {
+                                        ud.trialfunction = proxy1;
+                                        ud.trial_comp = k;
+                                        ud.testfunction = proxy2;
+                                        ud.test_comp = l;
+                                        cf -> Evaluate(mir, proxyvalues.Rows(kk,kk+1));
+                                      }
+                              }
+                            else
+                              for (size_t k = 0; k < dim_proxy1; k++)
+                                {
+                                  ud.trialfunction = proxy1;
+                                  ud.trial_comp = k;
+                                  ud.testfunction = proxy2;
+                                  ud.test_comp = k;
+                                  cf -> Evaluate (mir, diagproxyvalues.Rows(k,k+1));
+                                }
+
+                            proxy1->Evaluator()->CalcMatrix(fel, mir, bbmat1);
+                            if (!samediffop)
+                              proxy2->Evaluator()->CalcMatrix(fel, mir, bbmat2);
+
+                            if (is_diagonal)
+                              {
+                                for (size_t i = 0; i < bs; i++)
+                                  diagproxyvalues.Col(i) *= mir[i].GetWeight();
+                                for (size_t j = 0; j < dim_proxy1; j++)
+                                  {
+                                    auto hbbmat1 = bbmat1.RowSlice(j,dim_proxy1).Rows(r1);
+                                    auto hbdbmat1 = bdbmat1.RowSlice(j,dim_proxy1).Rows(r1);
+                                    for (size_t k = 0; k < bs; k++)
+                                      hbdbmat1.Col(k).Range(0,r1.Size()) = diagproxyvalues(j,k) * hbbmat1.Col(k);
+                                  }
+                              }
+                            else
+                              {
+                                hbdbmat1.Rows(r1) = SIMD<double>(0.0);
+                                for (size_t j = 0; j < dim_proxy2; j++)
+                                  for (size_t k = 0; k < dim_proxy1; k++)
+                                    if (nonzeros(l1+j, k1+k))
+                                      {
+                                        auto proxyvalues_jk = symbolic_integrator_uses_diff ?
+                                          proxyvalues.Row(j*dim_proxy1+k) : proxyvalues.Row(k*dim_proxy2+j);
+                                        auto bbmat1_k = bbmat1.RowSlice(k, dim_proxy1).Rows(r1);
+                                        auto bdbmat1_j = bdbmat1.RowSlice(j, dim_proxy2).Rows(r1);
+                                        for (size_t i = 0; i < bs; i++)
+                                          bdbmat1_j.Col(i).Range(0,r1.Size()) += proxyvalues_jk(i)*mir[i].GetWeight() * bbmat1_k.Col(i);
+                                      }
+                              }
+
+                            // lane-wise B^T D B, no horizontal sums
+                            auto part_elmat = belmat.Rows(r2).Cols(r1);
+                            auto b2 = hbbmat2.Rows(r2);
+                            auto db1 = hbdbmat1.Rows(r1);
+                            if (samediffop && is_diagonal)
+                              for (size_t i = 0; i < r2.Size(); i++)
+                                for (size_t j = 0; j <= i; j++)
+                                  {
+                                    SIMD<double> sum = InnerProduct (b2.Row(i), db1.Row(j));
+                                    part_elmat(i,j) += sum;
+                                    if (i != j) part_elmat(j,i) += sum;
+                                  }
+                            else
+                              for (size_t i = 0; i < r2.Size(); i++)
+                                for (size_t j = 0; j < r1.Size(); j++)
+                                  part_elmat(i,j) += InnerProduct (b2.Row(i), db1.Row(j));
+                          }
+                        l1 += proxy2->Dimension();
+                        l1nr++;
+                      }
+                    k1 += proxy1->Dimension();
+                    k1nr++;
+                  }
+              }
+
+            for (size_t e = 0; e < nel; e++)
+              {
+                auto elmat = elmats.Rows(e*h, (e+1)*h);
+                for (size_t i = 0; i < h; i++)
+                  for (size_t j = 0; j < h; j++)
+                    elmat(i,j) += belmat(i,j)[e];
+              }
+          });
+      }
+    catch (const ExceptionNOSIMD & e)
+      {
+        cout << IM(6) << e.What() << endl
+             << "element batch not possible" << endl;
+        return false;
+      }
+    return true;
+  }
+
+
   void 
   SymbolicBilinearFormIntegrator ::
   CalcElementMatrix (const FiniteElement & fel,
@@ -2890,6 +3124,106 @@ namespace ngfem
       linearization->CalcElementMatrix(fel, trafo, elmat, lh);
     }
   
+  /*
+    Geometry of one element for ApplyElementMatrix. Per SIMD integration
+    point the inverse Jacobian and weight*det, and the mapped point only
+    if the integrand may read it. The transformation is not stored, every
+    application maps with its own.
+  */
+  template <int DIM>
+  struct SymbolicBFIGeometry
+  {
+    FlatMatrix<SIMD<double>> invjac;   // DIM*DIM x nip
+    FlatVector<SIMD<double>> wdet;
+    FlatMatrix<SIMD<double>> points;   // DIM x nip, or 0 x nip
+  };
+
+  template <int DIM>
+  static SIMD_BaseMappedIntegrationRule &
+  MapPrecomputed (const SymbolicBFIGeometry<DIM> & geo,
+                  const SIMD_IntegrationRule & ir,
+                  const ElementTransformation & trafo,
+                  LocalHeap & lh)
+  {
+    auto & mir = *new (lh) SIMD_MappedIntegrationRule<DIM,DIM> (ir, trafo, -1, lh);
+    for (size_t i = 0; i < ir.Size(); i++)
+      {
+        Mat<DIM,DIM,SIMD<double>> invjac;
+        for (int k = 0; k < DIM; k++)
+          for (int l = 0; l < DIM; l++)
+            invjac(k,l) = geo.invjac(k*DIM+l, i);
+        mir[i].Jacobian() = 1.0/Det(invjac) * Trans(Cof(invjac));
+        mir[i].Point() = SIMD<double>(0.0);
+        for (size_t k = 0; k < geo.points.Height(); k++)
+          mir[i].Point()(k) = geo.points(k, i);
+        mir[i].Compute();
+        mir[i].SetMeasure (geo.wdet(i) / ir[i].Weight());
+      }
+    return mir;
+  }
+  
+  void * SymbolicBilinearFormIntegrator ::
+  PrecomputeData (const FiniteElement & fel, 
+                  const ElementTransformation & trafo, 
+                  LocalHeap & lh) const
+  {
+    int dim = fel.Dim();
+    if (element_vb != VOL || !simd_evaluate || dim < 1 || dim > 3 || trafo.SpaceDim() != dim)
+      return nullptr;
+
+    // proxies, constants and parameters do not look at the points
+    bool needs_points = false;
+    cf->TraverseTree
+      ([&] (CoefficientFunction & nodecf)
+       {
+         if (nodecf.InputCoefficientFunctions().Size()) return;
+         if (!dynamic_cast<ProxyFunction*> (&nodecf) &&
+             !dynamic_cast<ConstantCoefficientFunction*> (&nodecf) &&
+             !dynamic_cast<ParameterCoefficientFunction<double>*> (&nodecf))
+           needs_points = true;
+       });
+
+    void * data = nullptr;
+    try
+      {
+        Switch<3> (dim-1, [&] (auto ICDIM)
+          {
+            constexpr int DIM = ICDIM.value+1;
+            size_t nip;
+            {
+              HeapReset hr(lh);
+              nip = Get_SIMD_IntegrationRule (fel, lh).Size();
+            }
+
+            // the result stays in lh, the mapped rule is released
+            auto geo = new (lh) SymbolicBFIGeometry<DIM>;
+            geo->invjac.AssignMemory (DIM*DIM, nip, lh);
+            geo->wdet.AssignMemory (nip, lh);
+            geo->points.AssignMemory (needs_points ? DIM : 0, nip, lh);
+
+            HeapReset hr(lh);
+            const SIMD_IntegrationRule & simd_ir = Get_SIMD_IntegrationRule (fel, lh);
+            auto & mir = static_cast<SIMD_MappedIntegrationRule<DIM,DIM>&> (trafo(simd_ir, lh));
+            for (size_t i = 0; i < nip; i++)
+              {
+                auto invjac = mir[i].GetJacobianInverse();
+                for (int k = 0; k < DIM; k++)
+                  for (int l = 0; l < DIM; l++)
+                    geo->invjac(k*DIM+l, i) = invjac(k,l);
+                geo->wdet(i) = mir[i].GetWeight();
+                for (size_t k = 0; k < geo->points.Height(); k++)
+                  geo->points(k, i) = mir[i].GetPoint()(k);
+              }
+            data = geo;
+          });
+      }
+    catch (const ExceptionNOSIMD& e)
+      {
+        return nullptr;
+      }
+    return data;
+  }
+  
   void
   SymbolicBilinearFormIntegrator :: ApplyElementMatrix (const FiniteElement & fel, 
                                                         const ElementTransformation & trafo, 
@@ -2923,7 +3257,16 @@ namespace ngfem
           HeapReset hr(lh);
 
           const SIMD_IntegrationRule& simd_ir = Get_SIMD_IntegrationRule (fel, lh);
-          auto & simd_mir = trafo(simd_ir, lh);
+          // precomputed geometry, see PrecomputeData
+          SIMD_BaseMappedIntegrationRule * pmir = nullptr;
+          if (precomputed)
+            Switch<3> (fel.Dim()-1, [&] (auto ICDIM)
+              {
+                constexpr int DIM = ICDIM.value+1;
+                pmir = &MapPrecomputed (*static_cast<SymbolicBFIGeometry<DIM>*> (precomputed),
+                                        simd_ir, trafo, lh);
+              });
+          auto & simd_mir = pmir ? *pmir : trafo(simd_ir, lh);
           
           ProxyUserData ud(trial_proxies.Size(), gridfunction_cfs.Size(), lh);
           const_cast<ElementTransformation&>(trafo).userdata = &ud;
@@ -532,7 +532,23 @@ public:
                                           FlatMatrix<SCAL_RES> elmat,
                                           LocalHeap & lh) const;
 
-    
+    /// can element matrices of equivalent elements be computed lane-wise ?
+    NGS_DLL_HEADER bool SupportsElementBatch () const;
+
+    /*
+      Adds the element matrices of up to SIMD<double>::Size() elements,
+      one element per SIMD-lane. All elements must share the finite element fel,
+      i.e. same type, same class of vertex numbering and same orders.
+      elmats is the stack of element matrices (height = trafos.Size()*width).
+      Returns false if the integrand does not allow batching.
+    */
+    NGS_DLL_HEADER bool
+    CalcElementMatrixBatch (const FiniteElement & fel,
+                            FlatArray<const ElementTransformation*> trafos,
+                            FlatMatrix<double> elmats,
+                            LocalHeap & lh) const;
+
+
     NGS_DLL_HEADER virtual void 
     CalcLinearizedElementMatrix (const FiniteElement & fel,
                                  const ElementTransformation & trafo, 
@@ -561,6 +577,13 @@ public:
                                           FlatMatrix<double> elmat,
                                           LocalHeap & lh) const;
     
+    /// inverse Jacobians and weight*det (and points, if needed) for ApplyElementMatrix.
+    /// the data is allocated in lh, trafo is not referenced
+    NGS_DLL_HEADER virtual void * 
+    PrecomputeData (const FiniteElement & fel, 
+                    const ElementTransformation & trafo, 
+                    LocalHeap & lh) const override;
+
     NGS_DLL_HEADER virtual void 
     ApplyElementMatrix (const FiniteElement & fel, 
 			const ElementTransformation & trafo, 
@@ -692,6 +715,8 @@ public:
     
     virtual DGFormulation GetDGFormulation() const { return DGFormulation(neighbor_testfunction,
                                                                           element_boundary); }
+
+    const auto & GetCoefficientFunction() { return cf; }
     
     NGS_DLL_HEADER virtual void
     CalcFacetMatrix (const FiniteElement & volumefel1, int LocalFacetNr1,
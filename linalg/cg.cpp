@@ -636,6 +636,205 @@ namespace ngla
 
 
 
+  /*
+    Inner product without the global reduction. For parallel vectors
+    one is cumulated, the other one distributed.
+  */
+  template <class IPTYPE>
+  typename SCAL_TRAIT<IPTYPE>::SCAL LocalInnerProduct (const BaseVector & v1, const BaseVector & v2)
+  {
+    auto stat1 = v1.GetParallelStatus();
+    auto stat2 = v2.GetParallelStatus();
+    if (stat1 == NOT_PARALLEL && stat2 == NOT_PARALLEL)
+      return S_InnerProduct<IPTYPE> (v1, v2);
+
+    if (stat1 == stat2)
+      {
+        if (stat1 == DISTRIBUTED)
+          v1.Cumulate();
+        else
+          v2.Distribute();
+      }
+    return S_InnerProduct<IPTYPE> (*v1.GetLocalVector(), *v2.GetLocalVector());
+  }
+
+  /*
+    Global sum of a few local values, started non-blocking
+    and completed by Wait.
+  */
+  template <typename SCAL>
+  class NonBlockingSum
+  {
+    FlatVector<SCAL> vals;
+#ifdef PARALLEL
+    NG_MPI_Request request;
+#endif
+    bool active = false;
+  public:
+    NonBlockingSum (FlatVector<SCAL> avals, optional<NgMPI_Comm> comm)
+      : vals(avals)
+    {
+#ifdef PARALLEL
+      if (comm && comm->Size() > 1)
+        {
+          NG_MPI_Iallreduce (NG_MPI_IN_PLACE, vals.Data(), vals.Size(), GetMPIType<SCAL>(),
+                             NG_MPI_SUM, *comm, &request);
+          active = true;
+        }
+#endif
+    }
+
+    ~NonBlockingSum () { Wait(); }
+
+    void Wait ()
+    {
+#ifdef PARALLEL
+      if (active)
+        NG_MPI_Wait (&request, NG_MPI_STATUS_IGNORE);
+#endif
+      active = false;
+    }
+  };
+
+
+  template <class IPTYPE>
+  void PipelinedCGSolver<IPTYPE> :: Mult (const BaseVector & f, BaseVector & u) const
+  {
+    static Timer timer ("pipelined CG solver");
+    static Timer timerwait ("pipelined CG solver - wait");
+    RegionTimer reg (timer);
+
+    try
+      {
+	// Solve A u = f
+        BaseStatusHandler::SetThreadPercentage(0);
+
+        auto d = f.CreateVector();    // residual
+        auto w = u.CreateVector();    // C d
+        auto aw = f.CreateVector();   // A w
+        auto m = u.CreateVector();    // C aw
+        auto am = f.CreateVector();   // A m
+        auto p = u.CreateVector();
+        auto q = u.CreateVector();    // C s
+        auto s = f.CreateVector();    // A p
+        auto z = f.CreateVector();    // A q
+
+	int n = 0;
+	SCAL al = 0.0, be, ga, gaold = 0.0, de;
+	double err = 0, lwstart = 0, lerr = 0;
+        Vector<SCAL> ip(2);
+        auto comm = f.GetCommunicator();
+
+	if (initialize)
+	  {
+	    u = 0.0;
+	    d = f;
+	  }
+	else
+	  {
+	    d = f - (*a) * u;
+	  }
+
+	if (c)
+	  w = (*c) * d;
+	else
+	  w = d;
+        aw = (*a) * w;
+
+	while (true)
+	  {
+            ip(0) = LocalInnerProduct<IPTYPE> (w, d);
+            ip(1) = LocalInnerProduct<IPTYPE> (w, aw);
+            NonBlockingSum<SCAL> sum(ip, comm);
+
+            // overlapped with the reduction
+            if (c)
+              m = (*c) * aw;
+            else
+              m = aw;
+            am = (*a) * m;
+
+            {
+              RegionTimer regw (timerwait);
+              sum.Wait();
+            }
+            ga = ip(0);
+            de = ip(1);
+
+            if (n == 0)
+              {
+                if (printrates) cout << IM(1) << "0 " << sqrt(Abs(ga)) << endl;
+                double wdn = (ga == 0.0) ? 1 : Abs(ga);
+                if(stop_absolute)
+                  err = prec * prec;
+                else
+                  err = prec * prec * wdn;
+                lwstart = log(wdn);
+                lerr = log(err);
+              }
+            else
+              {
+                if (printrates ) cout << IM(1) << n << " " << sqrt (Abs (ga)) << endl;
+                BaseStatusHandler::SetThreadPercentage(100.*max2(double(n)/double(maxsteps),
+                                                                 (lwstart-log(Abs(ga)))/(lwstart-lerr)));
+              }
+
+            if (n >= maxsteps || Abs(ga) <= err || ga == 0.0 ||
+                BaseStatusHandler::ShouldTerminate())
+              break;
+
+            if (n == 0)
+              {
+                if (de == 0.0) break;
+                al = ga / de;
+                z = am;
+                q = m;
+                s = aw;
+                p = w;
+              }
+            else
+              {
+                be = ga / gaold;
+                SCAL den = de - be * ga / al;
+                if (den == 0.0) break;
+                al = ga / den;
+
+                z *= be;
+                z += am;
+                q *= be;
+                q += m;
+                s *= be;
+                s += aw;
+                p *= be;
+                p += w;
+              }
+
+            u += al * p;
+            d -= al * s;
+            w -= al * q;
+            aw -= al * z;
+            gaold = ga;
+            n++;
+	  } 
+	
+	const_cast<int&> (steps) = n;
+      }
+
+    catch (Exception & e)
+      {
+	e.Append ("in caught in PipelinedCGSolver::Mult\n");
+	throw;
+      }
+    catch (exception & e)
+      {
+	throw Exception(e.what() +
+			string ("\ncaught in PipelinedCGSolver::Mult\n"));
+      }
+  }
+
+
+
+
   template <class IPTYPE>
   void BiCGStabSolver<IPTYPE> :: Mult (const BaseVector & f, BaseVector & u) const
   {
@@ -1316,6 +1515,10 @@ void QMRSolver<SCAL> :: Mult (const BaseVector & b, BaseVector & x) const
   template class CGSolver<Complex>;
   template class CGSolver<ComplexConjugate>;
   template class CGSolver<ComplexConjugate2>;
+  template class PipelinedCGSolver<double>;
+  template class PipelinedCGSolver<Complex>;
+  template class PipelinedCGSolver<ComplexConjugate>;
+  template class PipelinedCGSolver<ComplexConjugate2>;
   template class BiCGStabSolver<double>;
   template class BiCGStabSolver<Complex>;
   template class BiCGStabSolver<ComplexConjugate>;
@@ -125,6 +125,31 @@ namespace ngla
   };
 
 
+  /**
+     Pipelined conjugate gradient method (Ghysels, Vanroose).
+     The two inner products of one iteration are fused into one global
+     reduction, which runs non-blocking while the preconditioner and
+     the matrix are applied. Needs two more vectors than CG.
+  */
+  template <class IPTYPE>
+  class NGS_DLL_HEADER PipelinedCGSolver : public KrylovSpaceSolver
+  {
+  public:
+    typedef typename SCAL_TRAIT<IPTYPE>::SCAL SCAL;
+    ///
+    PipelinedCGSolver () 
+      : KrylovSpaceSolver () { ; }
+    ///
+    PipelinedCGSolver (shared_ptr<BaseMatrix> aa)
+      : KrylovSpaceSolver (aa) { ; }
+    ///
+    PipelinedCGSolver (shared_ptr<BaseMatrix> aa, shared_ptr<BaseMatrix> ac)
+      : KrylovSpaceSolver (aa, ac) { ; }
+    ///
+    virtual void Mult (const BaseVector & v, BaseVector & prod) const;
+  };
+
+
   /// The BiCGStab solver
   template <class IPTYPE>
   class NGS_DLL_HEADER BiCGStabSolver : public KrylovSpaceSolver
@@ -694,6 +694,75 @@ namespace ngla
   }
 
 
+  void MinimumDegreeOrdering :: Order (FlatArray<int> given_order)
+  {
+    static Timer reorder_timer("MinimumDegreeOrdering::Order given");
+    RegionTimer reg(reorder_timer);
+
+    if (task_manager) task_manager -> StopWorkers();
+
+    for (int j = 0; j < n; j++)
+      priqueue.SetDegree(j, 1+NumCliques(j));
+
+    int locked_dofs = 0;
+    for (int i = 0; i < n; i++)
+      if (vertices[i].Eliminated())                
+        {
+          locked_dofs++;
+          priqueue.SetDegree (i, n);                  
+        }
+    nused = n-locked_dofs;
+
+    if (given_order.Size() != nused)
+      throw Exception ("MinimumDegreeOrdering::Order: given order has wrong size");
+    
+    int lastel = -1;
+    size_t pos = 0;
+    for (int i = 0; i < nused; i++)
+      {
+        int minj;
+	if (lastel != -1 && vertices[lastel].NextMinion() != -1)
+	  {
+            // eliminate minions together with their master
+	    minj = vertices[lastel].NextMinion();
+	    priqueue.Invalidate(minj);
+	    blocknr[i] = blocknr[i-1];
+	    EliminateMinionVertex (minj);
+	  }
+	else
+	  {
+            // next vertex of the given order which is not eliminated yet
+            while (vertices[given_order[pos]].Eliminated())
+              pos++;
+            minj = vertices[given_order[pos]].Master();
+	    priqueue.Invalidate(minj); 
+	    blocknr[i] = i;
+	    EliminateMasterVertex (minj);
+	  }
+
+	order[i] = minj;
+	vertices[minj].SetEliminated (1);
+	lastel = minj;
+      }
+    
+    if (task_manager) task_manager -> StartWorkers();
+  }
+
+
+  Table<int> MinimumDegreeOrdering :: CalcGraph () const
+  {
+    TableCreator<int> creator(n);
+    for ( ; !creator.Done(); creator++)
+      for (int i = 0; i < n; i++)
+        if (!vertices[i].Eliminated())
+          for (CliqueEl * p1 = cliques[i]; p1; p1 = p1->nextcl)
+            for (CliqueEl * p2 = p1->next; p2 != p1; p2 = p2->next)
+              if (!vertices[p2->GetVertexNr()].Eliminated())
+                creator.Add (i, p2->GetVertexNr());
+    return creator.MoveTable();
+  }
+
+
 
   MinimumDegreeOrdering:: ~MinimumDegreeOrdering ()
   {
@@ -848,4 +917,225 @@ namespace ngla
     list[nr].degree = 0;
   }
 
+
+
+
+  NestedDissection :: NestedDissection (FlatTable<int> agraph, FlatArray<int> vertices,
+                                        int aleafsize)
+    : graph(agraph), leafsize(max(aleafsize, 4)), cnt_labels(1)
+  {
+    static Timer t("NestedDissection"); RegionTimer reg(t);
+    
+    size_t n = graph.Size();
+    order.SetSize (vertices.Size());
+    node_of_vertex.SetSize (n);
+    label.SetSize (n);
+    level.SetSize (n);
+    node_of_vertex = -1;
+    label = -1;
+    level = -1;
+
+    Array<int> verts(vertices.Size());
+    for (auto i : Range(vertices))
+      {
+        verts[i] = vertices[i];
+        label[vertices[i]] = 0;
+      }
+
+    if (task_manager)
+      Dissect (std::move(verts), 0, -1, 0);
+    else
+      RunWithTaskManager ([&] ()
+                          {
+                            Dissect (std::move(verts), 0, -1, 0);
+                          });
+  }
+
+  
+  int NestedDissection :: NewNode (int first, int sep, int next, int parent)
+  {
+    lock_guard<mutex> guard(tree_mutex);
+    tree.Append (TreeNode { first, sep, next, parent } );
+    return tree.Size()-1;
+  }
+
+  
+  // breadth first search within the sub-graph of given label, 
+  // appends the vertices to queue, returns number of levels
+  int NestedDissection :: BFS (int start, int lab, Array<int> & queue)
+  {
+    size_t first = queue.Size();
+    queue.Append (start);
+    level[start] = 0;
+    int maxlevel = 0;
+    for (size_t i = first; i < queue.Size(); i++)
+      {
+        int v = queue[i];
+        for (int w : graph[v])
+          if (label[w] == lab && level[w] == -1)
+            {
+              level[w] = level[v]+1;
+              maxlevel = level[w];
+              queue.Append (w);
+            }
+      }
+    return maxlevel+1;
+  }
+
+  
+  void NestedDissection :: Dissect (Array<int> verts, int first, int parent, int lab)
+  {
+    int n = verts.Size();
+    if (n == 0) return;
+
+    for (int v : verts)
+      level[v] = -1;
+
+    Array<int> queue;
+    auto order_as_leaf = [&] ()
+      {
+        // leaves are ordered breadth first (Cuthill-McKee like)
+        for (int v : verts)
+          level[v] = -1;
+        queue.SetSize0();
+        for (int v : verts)
+          if (level[v] == -1)
+            BFS (v, lab, queue);
+        int nodenr = NewNode (first, first, first+n, parent);
+        for (int i : Range(n))
+          {
+            order[first+i] = queue[i];
+            node_of_vertex[queue[i]] = nodenr;
+            label[queue[i]] = -1;
+          }
+      };
+
+    if (n <= leafsize)
+      {
+        order_as_leaf();
+        return;
+      }
+
+    Array<int> parta, partb, sep;
+    
+    BFS (verts[0], lab, queue);
+    if (queue.Size() < n)
+      {
+        // not connected: distribute components to two parts
+        for (int v : verts)
+          level[v] = -1;
+        queue.SetSize0();
+        int last_comp = 0;
+        for (int v : verts)
+          if (level[v] == -1)
+            {
+              size_t firstq = queue.Size();
+              BFS (v, lab, queue);
+              if (parta.Size() < n/2)
+                {
+                  last_comp = parta.Size();
+                  parta.Append (queue.Range(firstq, queue.Size()));
+                }
+              else
+                partb.Append (queue.Range(firstq, queue.Size()));
+            }
+        if (partb.Size() == 0)
+          {
+            partb.Append (parta.Range(last_comp, parta.Size()));
+            parta.SetSize (last_comp);
+          }
+      }
+    else
+      {
+        // second sweep from a pseudo-peripheral vertex
+        int root = queue.Last();
+        for (int v : verts)
+          level[v] = -1;
+        queue.SetSize0();
+        int nlevels = BFS (root, lab, queue);
+        if (nlevels < 3)
+          {
+            order_as_leaf();
+            return;
+          }
+        
+        Array<int> cnt(nlevels);
+        cnt = 0;
+        for (int v : queue)
+          cnt[level[v]]++;
+        
+        int m = 0, sum = 0;
+        while (sum + cnt[m] < n/2)
+          sum += cnt[m++];
+        m = max(1, min(m, nlevels-2));
+
+        // thin the separator: vertices without neighbour in the upper part move down
+        for (int v : queue)
+          if (level[v] == m)
+            {
+              bool touches_upper = false;
+              for (int w : graph[v])
+                if (label[w] == lab && level[w] == m+1)
+                  {
+                    touches_upper = true;
+                    break;
+                  }
+              if (!touches_upper)
+                level[v] = m-1;
+            }
+        
+        for (int v : queue)
+          {
+            if (level[v] < m)
+              parta.Append (v);
+            else if (level[v] > m)
+              partb.Append (v);
+            else
+              sep.Append (v);
+          }
+      }
+
+    int sepfirst = first + parta.Size() + partb.Size();
+    int nodenr = NewNode (first, sepfirst, first+n, parent);
+    for (int i : Range(sep))
+      {
+        order[sepfirst+i] = sep[i];
+        node_of_vertex[sep[i]] = nodenr;
+        label[sep[i]] = -1;
+      }
+
+    int laba = cnt_labels++;
+    int labb = cnt_labels++;
+    for (int v : parta) label[v] = laba;
+    for (int v : partb) label[v] = labb;
+    
+    int firstb = first + parta.Size();
+
+    /*
+      The two parts are dissected concurrently without atomics.
+      The writes are disjoint: a task writes label, level and node_of_vertex
+      only for its own vertices, order only within its own position range,
+      and the tree under tree_mutex.
+      The reads are race-free as well: no edge joins parta and partb
+      (they are separated by sep, or are different components). So a
+      neighbour of an own vertex is either an own vertex or a separator
+      vertex of this or an ancestor node, or was never ordered. Those labels
+      are -1 and are fixed before the tasks start. level is only read for
+      vertices that carry the own label.
+    */
+    if (n > 10000)
+      ParallelFor (2, [&] (int i)
+                   {
+                     if (i == 0)
+                       Dissect (std::move(parta), first, nodenr, laba);
+                     else
+                       Dissect (std::move(partb), firstb, nodenr, labb);
+                   });
+    else
+      {
+        Dissect (std::move(parta), first, nodenr, laba);
+        Dissect (std::move(partb), firstb, nodenr, labb);
+      }
+  }
+  
 }
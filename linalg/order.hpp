@@ -177,6 +177,10 @@ namespace ngla
     void EliminateMinionVertex (int v);
     ///
     void Order();
+    /// eliminate in the given order (e.g. nested dissection), minions follow their master
+    void Order (FlatArray<int> given_order);
+    /// adjacency graph of the used vertices, before ordering
+    Table<int> CalcGraph () const;
     /// 
     ~MinimumDegreeOrdering();
 
@@ -239,6 +243,48 @@ namespace ngla
   };
 
 
+
+  /*
+    Nested dissection ordering by recursive level-set bisection.
+    Separators are found from the breadth-first level structure 
+    starting at a pseudo-peripheral vertex, and are thinned afterwards.
+    Sub-graphs are dissected in parallel.
+   */
+  class NestedDissection
+  {
+  public:
+    /// subtree has positions [first,next), its separator [sep,next)
+    struct TreeNode
+    {
+      int first, sep, next;
+      int parent;
+    };
+    
+    ///
+    NestedDissection (FlatTable<int> agraph, FlatArray<int> vertices, int aleafsize = 64);
+
+    /// vertex at position i
+    FlatArray<int> GetOrder() const { return order; }
+    /// the separator tree
+    FlatArray<TreeNode> GetTree() const { return tree; }
+    /// tree-node of vertex (-1 for vertices not ordered)
+    FlatArray<int> GetNodeOfVertex() const { return node_of_vertex; }
+    
+  private:
+    void Dissect (Array<int> verts, int first, int parent, int label);
+    int BFS (int start, int label, Array<int> & queue);
+    int NewNode (int first, int sep, int next, int parent);
+    
+    FlatTable<int> graph;
+    int leafsize;
+    Array<int> order;
+    Array<TreeNode> tree;
+    Array<int> node_of_vertex;
+    Array<int> label;
+    Array<int> level;
+    atomic<int> cnt_labels;
+    mutex tree_mutex;
+  };
 }
 
 
@@ -1110,6 +1110,20 @@ inverse : string
     pardiso        - PARDISO, either provided by libpardiso (USE_PARDISO=ON) or Intel MKL (USE_MKL=ON).
                      If neither Pardiso nor Intel MKL was linked at compile-time, NGSolve will look
                      for libmkl_rt in LD_LIBRARY_PATH (Unix) or PATH (Windows) at run-time.
+
+flags : Flags
+  Solver specific flags. For sparsecholesky:
+    supernodal     - store the factor as dense panels per supernode, updates by BLAS-3 kernels
+    ordering       - 'mdo' (minimum degree, default) or 'nesteddissection'
+    ndleafsize     - size of sub-graphs not dissected further (default 64)
+    symboliccache  - reuse the ordering of a recent matrix with the same sparsity pattern
+                     (opt-in, off by default; a hit shows as timer 'SparseCholesky - reuse symbolic')
+    singleprecision - factor into float panels (implies supernodal), solve with iterative refinement (real matrices)
+    refinementtol  - relative residual for iterative refinement (default 1e-12)
+    refinementsteps - maximal number of refinement steps (default 10)
+    memorybudget   - if the factor needs more bytes, it is stored out-of-core (supernodal,
+                     also the float panels of singleprecision)
+    scratchdir     - directory for the out-of-core scratch file (default $TMPDIR or /tmp)
 )raw_string"), py::call_guard<py::gil_scoped_release>())
     // .def("Inverse", [](BM &m)  { return m.InverseMatrix(); })
 
@@ -1479,6 +1493,20 @@ inverse : string
                   }))
     ;
 
+  py::class_<SparseMatrixSELL<double>, shared_ptr<SparseMatrixSELL<double>>, BaseMatrix>
+    (m, "SparseMatrixSELL",
+     "sparse matrix in SELL-C-sigma format for SIMD matrix-vector products,\n"
+     "created from an assembled real SparseMatrix")
+    .def(py::init([] (const BaseMatrix & mat, size_t sigma)
+                  {
+                    if (auto ptr = dynamic_cast<const SparseMatrixTM<double>*> (&mat); ptr)
+                      return make_shared<SparseMatrixSELL<double>> (*ptr, sigma);
+                    throw Exception("cannot create SparseMatrixSELL");
+                  }), py::arg("mat"), py::arg("sigma")=256)
+    .def_property_readonly("fillratio", &SparseMatrixSELL<double>::GetFillRatio,
+                           "non-zero entries over stored entries including padding")
+    ;
+
   
   py::class_<BaseBlockJacobiPrecond, shared_ptr<BaseBlockJacobiPrecond>, BaseMatrix>
     (m, "BlockSmoother",
@@ -1696,13 +1724,23 @@ inverse : string
 
   m.def("CGSolver", [](shared_ptr<BaseMatrix> mat, shared_ptr<BaseMatrix> pre,
                        bool iscomplex, bool printrates,
-                       double precision, int maxsteps, bool conjugate, optional<int> maxiter)
+                       double precision, int maxsteps, bool conjugate, optional<int> maxiter,
+                       bool pipelined)
         {
           shared_ptr<KrylovSpaceSolver> solver;
           if(mat->IsComplex()) iscomplex = true;
           if (maxiter) maxsteps = *maxiter;
           
-          if (iscomplex)
+          if (pipelined)
+            {
+              if (!iscomplex)
+                solver = make_shared<PipelinedCGSolver<double>> (mat, pre);
+              else if (conjugate)
+                solver = make_shared<PipelinedCGSolver<ComplexConjugate>> (mat, pre);
+              else
+                solver = make_shared<PipelinedCGSolver<Complex>> (mat, pre);
+            }
+          else if (iscomplex)
             {
               if(conjugate)
                 solver = make_shared<CGSolver<ComplexConjugate>>(mat, pre);
@@ -1718,6 +1756,7 @@ inverse : string
         },
         py::arg("mat"), py::arg("pre"), py::arg("complex") = false, py::arg("printrates")=true,
         py::arg("precision")=1e-8, py::arg("maxsteps")=200, py::arg("conjugate")=false, py::arg("maxiter")=nullopt,
+        py::arg("pipelined")=false,
         docu_string(R"raw_string(
 A CG Solver.
 
@@ -1741,6 +1780,10 @@ precision : float
 maxsteps : int
   input maximal steps. CGSolver stops after this steps.
 
+pipelined : bool
+  use the pipelined variant, which overlaps the global reduction
+  of the inner products with preconditioner and matrix application.
+
 )raw_string"))
     ;
 
@@ -1942,6 +1985,9 @@ shift : object
     solvers.append(GetInverseName(SPARSECHOLESKY));
     return solvers;
   });
+
+  m.def("ClearSparseCholeskySymbolicCache", &ClearSparseCholeskySymbolicCache,
+        "release the symbolic factorizations kept by sparsecholesky with flag 'symboliccache'");
 }
 
 
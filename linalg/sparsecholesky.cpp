@@ -13,6 +13,13 @@
 
 // #include <la.hpp>
 #include "sparsecholesky.hpp"
+#include "multivector.hpp"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 typedef moodycamel::ConcurrentQueue<int> TQueue; 
@@ -140,7 +147,6 @@ namespace ngla
     : SparseFactorization (a, ainner, acluster)
   { 
     static Timer t("SparseCholesky - total");
-    static Timer ta("SparseCholesky - allocate");
     RegionTimer reg(t);
     GetMemoryTracer().SetName("SparseCholesky");
     GetMemoryTracer().Track(order, "order",
@@ -152,6 +158,10 @@ namespace ngla
                             firstinrow_ri, "firstinrow_ri",
                             blocknrs, "blocknrs",
                             blocks, "blocks",
+                            block_of_dof, "block_of_dof",
+                            firstinpanel, "firstinpanel",
+                            panels, "panels",
+                            factor_single, "factor_single",
                             microtasks, "microtasks",
                             block_dependency, "block_dependency",
                             micro_dependency, "micro_dependency",
@@ -176,11 +186,106 @@ namespace ngla
 
     max_bs = a->GetInverseFlags().GetNumFlag("maxbs", 1024);
     max_micro_bs = a->GetInverseFlags().GetNumFlag("maxmubs", 256);
+    supernodal = a->GetInverseFlags().GetDefineFlag("supernodal");
+    single_precision = a->GetInverseFlags().GetDefineFlag("singleprecision");
+    refinement_tol = a->GetInverseFlags().GetNumFlag("refinementtol", 1e-12);
+    refinement_steps = a->GetInverseFlags().GetNumFlag("refinementsteps", 10);
+    if (single_precision && !is_same<TM,double>::value)
+      throw Exception ("SparseCholesky: singleprecision is only available for real scalar matrices");
+    // the float factor is built on supernodal panels
+    if (single_precision)
+      supernodal = true;
+    memory_budget = a->GetInverseFlags().GetNumFlag("memorybudget", 0);
+    const char * tmpdir = getenv("TMPDIR");
+    scratch_dir = a->GetInverseFlags().GetStringFlag("scratchdir", tmpdir ? tmpdir : "/tmp");
 
     
     clock_t starttime, endtime;
     starttime = clock();
     
+    size_t key = SymbolicKey (*a);
+    if (!RestoreSymbolic (key, *a))
+      {
+        CalcSymbolic (a);
+        StoreSymbolic (key, *a);
+      }
+
+    // out-of-core storage works on supernodal panels
+    if (memory_budget > 0 && nze*sizeof(TM) > memory_budget)
+      supernodal = true;
+
+    diag.SetSize(nused);
+    if (supernodal)
+      AllocatePanels();
+    else
+      {
+        // lfact.SetSize (nze);
+        lfact = NumaInterleavedArray<TM> (nze);
+        
+        // lfact = TM(0.0);     // first touch
+        ParallelForRange (nze, [&] (IntRange r)
+                          {
+                            lfact.Range(r) = TM(0.0);
+                          });
+      }
+    
+    endtime = clock();
+    if (printstat)
+      (cout) << "allocation time = "
+	     << double (endtime - starttime) / CLOCKS_PER_SEC << " secs" << endl;
+    
+    starttime = endtime;
+    FactorNew(*a);
+    /*
+#ifdef LAPACK
+    if (a.IsSPD())
+      FactorSPD();
+    else
+#endif
+      Factor(); 
+    */
+
+    /*
+    for (int i = 0; i < n; i++)
+      if (a.GetPositionTest (i,i) == numeric_limits<size_t>::max())
+	diag[order[i]] = TM(0.0);
+
+    if (inner)
+      {
+	for (int i = 0; i < n; i++)
+	  if (!inner->Test(i))
+	    diag[order[i]] = TM(0.0);
+      }
+
+    if (cluster)
+      {
+	for (int i = 0; i < n; i++)
+	  if (!(*cluster)[i])
+	    diag[order[i]] = TM(0.0);
+      }
+    */
+
+    if (printstat)
+      cout << IM(4) << "done" << endl;
+    
+    endtime = clock();
+
+    if (printstat)
+      (cout) << " factoring time = " << double(endtime - starttime) / CLOCKS_PER_SEC << " sec" << endl;
+  }
+  
+
+  
+  template <class TM>
+  void SparseCholeskyTM<TM> :: 
+  CalcSymbolic (shared_ptr<const SparseMatrixTM<TM>> a)
+  {
+    static Timer t("SparseCholesky - symbolic");
+    static Timer ta("SparseCholesky - allocate");
+    RegionTimer reg(t);
+
+    int n = a->Height();
+    
     mdo = new MinimumDegreeOrdering (n);
     GetMemoryTracer().Track(*mdo, "MinimumDegreeOrdering");
 
@@ -248,92 +353,292 @@ namespace ngla
 	}
     */
 
-    if (printstat)
-      cout << IM(4) << "start ordering" << endl;
-    
     // mdo -> PrintCliques ();
-    mdo->Order();
+    string ordering = a->GetInverseFlags().GetStringFlag("ordering", "mdo");
+    Array<int> treenode;
+    if (ordering == "nesteddissection" || ordering == "nd")
+      {
+        Array<int> used;
+        for (int i = 0; i < n; i++)
+          if (!mdo->vertices[i].Eliminated())
+            used.Append (i);
+        Table<int> graph = mdo->CalcGraph();
+        NestedDissection nd(graph, used, a->GetInverseFlags().GetNumFlag("ndleafsize", 64));
+        mdo->Order(nd.GetOrder());
+        
+        // blocks must not cross nodes of the separator tree
+        treenode.SetSize (mdo->nused);
+        for (int i = 0; i < mdo->nused; i++)
+          treenode[i] = nd.GetNodeOfVertex()[mdo->order[i]];
+      }
+    else if (ordering == "mdo")
+      mdo->Order();
+    else
+      throw Exception ("SparseCholesky: unknown ordering '"+ordering+"', use 'mdo' or 'nesteddissection'");
     nused = mdo->nused;
-    endtime = clock();
-    if (printstat)
-      cout << IM(4) << "ordering time = "
-	   << double (endtime - starttime) / CLOCKS_PER_SEC 
-	   << " secs" << endl;
-    
-    starttime = endtime;
-    
-    if (printstat)
-      cout << IM(4) << "," << flush;
+
     ta.Start();
-    Allocate (mdo->order,  mdo->vertices, mdo->blocknr.Data());
+    Allocate (mdo->order,  mdo->vertices, mdo->blocknr.Data(), treenode);
     ta.Stop();
 
     delete mdo;
     mdo = 0;
+  }
 
-    diag.SetSize(nused);
-    // lfact.SetSize (nze);
-    lfact = NumaInterleavedArray<TM> (nze);
 
-    // lfact = TM(0.0);     // first touch
-    ParallelForRange (nze, [&] (IntRange r)
-                      {
-                        lfact.Range(r) = TM(0.0);
-                      });
+
+  // symbolic data of a factorization, shared by all factorizations
+  // of matrices with identical sparsity pattern and ordering flags
+  struct SparseCholeskySymbolicBase
+  {
+    virtual ~SparseCholeskySymbolicBase() = default;
+  };
+
+  template <class TM>
+  struct SparseCholeskySymbolic : public SparseCholeskySymbolicBase
+  {
+    // what the ordering was computed for, compared exactly before reuse
+    Array<size_t> firsti;
+    Array<int> colnr;
+    Array<bool> inner;
+    Array<int> cluster;
+    string ordering;
+    int ndleafsize, max_bs, max_micro_bs;
+
+    int nused, maxrow;
+    size_t nze;
+    Array<int> order, inv_order, rowindex2, blocknrs, blocks, block_of_dof;
+    Array<size_t> firstinrow, firstinrow_ri;
+    Array<typename SparseCholeskyTM<TM>::MicroTask> microtasks;
+    Table<int> block_dependency, micro_dependency, micro_dependency_trans;
+  };
+
+  // a small LRU cache, most recently used entry first
+  static Array<tuple<size_t, shared_ptr<SparseCholeskySymbolicBase>>> symbolic_cache;
+  static mutex symbolic_cache_mutex;
+  constexpr size_t symbolic_cache_size = 4;
+
+  void ClearSparseCholeskySymbolicCache ()
+  {
+    lock_guard<mutex> guard(symbolic_cache_mutex);
+    symbolic_cache.SetSize0();
+  }
+
+  inline void HashCombine (size_t & seed, size_t v)
+  {
+    seed ^= v + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+  }
+  
+  static Table<int> CopyTable (FlatTable<int> tab)
+  {
+    TableCreator<int> creator(tab.Size());
+    for ( ; !creator.Done(); creator++)
+      for (size_t i = 0; i < tab.Size(); i++)
+        for (int j : tab[i])
+          creator.Add (i, j);
+    return creator.MoveTable();
+  }
+
+  // array referring to the memory of a, which must stay alive
+  template <typename T>
+  static Array<T> ArrayView (FlatArray<T> a)
+  {
+    return Array<T> (a.Size(), a.Data());
+  }
+  
+  template <class TM>
+  size_t SparseCholeskyTM<TM> :: 
+  SymbolicKey (const SparseMatrixTM<TM> & a) const
+  {
+    const Flags & flags = a.GetInverseFlags();
+    if (!flags.GetDefineFlag("symboliccache"))
+      return 0;
+
+    static Timer t("SparseCholesky - symbolic key");
+    RegionTimer reg(t);
+
+    size_t n = a.Height();
     
-    endtime = clock();
-    if (printstat)
-      (cout) << "allocation time = "
-	     << double (endtime - starttime) / CLOCKS_PER_SEC << " secs" << endl;
+    // fixed chunks make the key independent of the number of threads
+    constexpr size_t chunksize = 4096;
+    size_t nchunks = (n+chunksize-1) / chunksize;
+    Array<size_t> chunkhash(nchunks);
+    ParallelFor (nchunks, [&] (size_t c)
+                 {
+                   size_t h = c;
+                   for (size_t i = c*chunksize; i < min(n, (c+1)*chunksize); i++)
+                     {
+                       HashCombine (h, a.First(i));
+                       for (auto col : a.GetRowIndices(i))
+                         HashCombine (h, col);
+                       if (inner)
+                         HashCombine (h, inner->Test(i));
+                       if (cluster)
+                         HashCombine (h, (*cluster)[i]);
+                     }
+                   chunkhash[c] = h;
+                 });
+
+    size_t key = n;
+    HashCombine (key, a.NZE());
+    HashCombine (key, (inner ? 1 : 0) + (cluster ? 2 : 0));
+    for (auto h : chunkhash)
+      HashCombine (key, h);
+    HashCombine (key, std::hash<string>() (flags.GetStringFlag("ordering", "mdo")));
+    HashCombine (key, size_t(flags.GetNumFlag("ndleafsize", 64)));
+    HashCombine (key, max_bs);
+    HashCombine (key, max_micro_bs);
+    return key ? key : 1;
+  }
+
+  template <class TM>
+  bool SparseCholeskyTM<TM> :: RestoreSymbolic (size_t key, const SparseMatrixTM<TM> & a)
+  {
+    if (key == 0) return false;
+
+    static Timer t("SparseCholesky - restore symbolic");
+    RegionTimer reg(t);
+
+    const Flags & flags = a.GetInverseFlags();
+    size_t n = a.Height();
+
+    // the key is only a hash, the pattern is compared exactly
+    auto matches = [&] (const SparseCholeskySymbolic<TM> & sym)
+    {
+      if (sym.firsti.Size() != n+1 || sym.colnr.Size() != a.NZE()) return false;
+      if (sym.inner.Size() != (inner ? n : 0)) return false;
+      if (sym.cluster.Size() != (cluster ? n : 0)) return false;
+      if (sym.ordering != flags.GetStringFlag("ordering", "mdo")) return false;
+      if (sym.ndleafsize != int(flags.GetNumFlag("ndleafsize", 64))) return false;
+      if (sym.max_bs != max_bs || sym.max_micro_bs != max_micro_bs) return false;
+
+      FlatArray<size_t> firsti = a.GetFirstArray();
+      FlatArray<int> colnr = a.GetColIndices();
+      for (size_t i = 0; i <= n; i++)
+        if (sym.firsti[i] != firsti[i]) return false;
+      for (size_t i = 0; i < sym.colnr.Size(); i++)
+        if (sym.colnr[i] != colnr[i]) return false;
+      if (inner)
+        for (size_t i = 0; i < n; i++)
+          if (sym.inner[i] != inner->Test(i)) return false;
+      if (cluster)
+        for (size_t i = 0; i < n; i++)
+          if (sym.cluster[i] != (*cluster)[i]) return false;
+      return true;
+    };
     
-    starttime = endtime;
-    FactorNew(*a);
-    /*
-#ifdef LAPACK
-    if (a.IsSPD())
-      FactorSPD();
-    else
-#endif
-      Factor(); 
-    */
+    shared_ptr<SparseCholeskySymbolic<TM>> sym;
+    {
+      lock_guard<mutex> guard(symbolic_cache_mutex);
+      for (size_t i = 0; i < symbolic_cache.Size(); i++)
+        if (get<0>(symbolic_cache[i]) == key)
+          {
+            auto cand = dynamic_pointer_cast<SparseCholeskySymbolic<TM>> (get<1>(symbolic_cache[i]));
+            if (!cand || !matches(*cand)) continue;
+            sym = cand;
+            // move to front
+            for (size_t j = i; j > 0; j--)
+              symbolic_cache[j] = symbolic_cache[j-1];
+            symbolic_cache[0] = { key, sym };
+            break;
+          }
+    }
+    if (!sym) return false;
 
-    /*
-    for (int i = 0; i < n; i++)
-      if (a.GetPositionTest (i,i) == numeric_limits<size_t>::max())
-	diag[order[i]] = TM(0.0);
+    // counts the factorizations which skip the ordering
+    static Timer thit("SparseCholesky - reuse symbolic");
+    RegionTimer reghit(thit);
+    
+    // the arrays are shared with the cache entry, not copied
+    symbolic = sym;
+    nused = sym->nused;
+    maxrow = sym->maxrow;
+    nze = sym->nze;
+    order = ArrayView<int> (sym->order);
+    inv_order = ArrayView<int> (sym->inv_order);
+    rowindex2 = ArrayView<int> (sym->rowindex2);
+    blocknrs = ArrayView<int> (sym->blocknrs);
+    blocks = ArrayView<int> (sym->blocks);
+    block_of_dof = ArrayView<int> (sym->block_of_dof);
+    firstinrow = ArrayView<size_t> (sym->firstinrow);
+    firstinrow_ri = ArrayView<size_t> (sym->firstinrow_ri);
+    microtasks = ArrayView<MicroTask> (sym->microtasks);
+    block_dependency = CopyTable (sym->block_dependency);
+    micro_dependency = CopyTable (sym->micro_dependency);
+    micro_dependency_trans = CopyTable (sym->micro_dependency_trans);
+    mdo = nullptr;
+    return true;
+  }
+
+  template <class TM>
+  void SparseCholeskyTM<TM> :: StoreSymbolic (size_t key, const SparseMatrixTM<TM> & a)
+  {
+    if (key == 0) return;
 
+    const Flags & flags = a.GetInverseFlags();
+    size_t n = a.Height();
+    
+    auto sym = make_shared<SparseCholeskySymbolic<TM>>();
+    sym->firsti = a.GetFirstArray();
+    sym->colnr = a.GetColIndices();
     if (inner)
       {
-	for (int i = 0; i < n; i++)
-	  if (!inner->Test(i))
-	    diag[order[i]] = TM(0.0);
+        sym->inner.SetSize(n);
+        for (size_t i = 0; i < n; i++)
+          sym->inner[i] = inner->Test(i);
       }
-
     if (cluster)
-      {
-	for (int i = 0; i < n; i++)
-	  if (!(*cluster)[i])
-	    diag[order[i]] = TM(0.0);
-      }
-    */
-
-    if (printstat)
-      cout << IM(4) << "done" << endl;
+      sym->cluster = *cluster;
+    sym->ordering = flags.GetStringFlag("ordering", "mdo");
+    sym->ndleafsize = int(flags.GetNumFlag("ndleafsize", 64));
+    sym->max_bs = max_bs;
+    sym->max_micro_bs = max_micro_bs;
     
-    endtime = clock();
-
-    if (printstat)
-      (cout) << " factoring time = " << double(endtime - starttime) / CLOCKS_PER_SEC << " sec" << endl;
+    // move the arrays into the cache entry, and share them from there
+    sym->nused = nused;
+    sym->maxrow = maxrow;
+    sym->nze = nze;
+    sym->order = std::move(order);
+    sym->inv_order = std::move(inv_order);
+    sym->rowindex2 = std::move(rowindex2);
+    sym->blocknrs = std::move(blocknrs);
+    sym->blocks = std::move(blocks);
+    sym->block_of_dof = std::move(block_of_dof);
+    sym->firstinrow = std::move(firstinrow);
+    sym->firstinrow_ri = std::move(firstinrow_ri);
+    sym->microtasks = std::move(microtasks);
+    sym->block_dependency = CopyTable (block_dependency);
+    sym->micro_dependency = CopyTable (micro_dependency);
+    sym->micro_dependency_trans = CopyTable (micro_dependency_trans);
+
+    symbolic = sym;
+    order = ArrayView<int> (sym->order);
+    inv_order = ArrayView<int> (sym->inv_order);
+    rowindex2 = ArrayView<int> (sym->rowindex2);
+    blocknrs = ArrayView<int> (sym->blocknrs);
+    blocks = ArrayView<int> (sym->blocks);
+    block_of_dof = ArrayView<int> (sym->block_of_dof);
+    firstinrow = ArrayView<size_t> (sym->firstinrow);
+    firstinrow_ri = ArrayView<size_t> (sym->firstinrow_ri);
+    microtasks = ArrayView<MicroTask> (sym->microtasks);
+
+    lock_guard<mutex> guard(symbolic_cache_mutex);
+    if (symbolic_cache.Size() < symbolic_cache_size)
+      symbolic_cache.Append (tuple<size_t, shared_ptr<SparseCholeskySymbolicBase>>());
+    for (size_t j = symbolic_cache.Size()-1; j > 0; j--)
+      symbolic_cache[j] = symbolic_cache[j-1];
+    symbolic_cache[0] = { key, sym };
   }
   
 
-  
+
   template <class TM>
   void SparseCholeskyTM<TM> :: 
   Allocate (const Array<int> & aorder, 
 	    // const Array<CliqueEl*> & cliques,
 	    const Array<MDOVertex> & vertices,
-	    const int * in_blocknr)
+	    const int * in_blocknr,
+            FlatArray<int> treenode)
   {
     int n = aorder.Size();
 
@@ -434,7 +739,8 @@ namespace ngla
     
     blocks.Append(0);
     for (int i = 1; i < nused; i++)
-      if (blocknrs[i] == i || i >= blocks.Last()+max_bs) // don't subdivide, for this we have the micro-blocks
+      if (blocknrs[i] == i || i >= blocks.Last()+max_bs // don't subdivide, for this we have the micro-blocks
+          || (treenode.Size() && treenode[i] != treenode[i-1]))
         blocks.Append (i);
     if (nused > 0)
       blocks.Append(nused);
@@ -442,7 +748,7 @@ namespace ngla
 
     
     // find block dependency
-    Array<int> block_of_dof(nused);
+    block_of_dof.SetSize(nused);
     for (int i = 0; i < blocks.Size()-1; i++)
       block_of_dof[Range(blocks[i], blocks[i+1])] = i;
 
@@ -554,12 +860,68 @@ namespace ngla
   template<typename TM>
   void SparseCholeskyTM<TM>::DoArchive(Archive& ar)
   {
+    if (scratch)
+      throw Exception ("SparseCholesky: archiving of out-of-core factor not supported");
     SparseFactorization::DoArchive(ar);
     ar & height & nused & nze & order & inv_order & lfact
       & firstinrow & diag & rowindex2 & firstinrow_ri &
       blocknrs & blocks & block_dependency & microtasks
       & micro_dependency & micro_dependency_trans & mdo
-      & maxrow;
+      & maxrow & block_of_dof & supernodal & firstinpanel & panels
+      & single_precision & factor_single & refinement_tol & refinement_steps;
+  }
+
+
+  template <class TM>
+  void SparseCholeskyTM<TM> :: AllocatePanels ()
+  {
+    size_t nblocks = blocks.Size()-1;
+    firstinpanel.SetSize (nblocks+1);
+
+    size_t cnt = 0;
+    for (size_t i = 0; i < nblocks; i++)
+      {
+        firstinpanel[i] = cnt;
+        auto range = BlockDofs(i);
+        size_t nk = firstinrow[range.First()+1]-firstinrow[range.First()]+1;
+        cnt += nk * range.Size();
+      }
+    firstinpanel[nblocks] = cnt;
+
+    // in single precision the double precision panels are never allocated
+    size_t nbytes = cnt*PanelEntrySize();
+    if (height > 2000)
+      cout << IM(4) << " supernodal panels " << (single_precision ? "(float) " : "")
+           << nbytes << " Bytes " << flush;
+
+    if (memory_budget > 0 && nbytes > memory_budget)
+      {
+        if (height > 2000)
+          cout << IM(4) << " out-of-core in " << scratch_dir << " " << flush;
+        panels = NumaInterleavedArray<TM> ();
+        factor_single = NumaInterleavedArray<float> ();
+        scratch = nullptr;
+        // a new file is zero-initialized
+        scratch = make_shared<MappedScratchFile> (scratch_dir, nbytes);
+        return;
+      }
+    
+    scratch = nullptr;
+    if (single_precision)
+      {
+        factor_single = NumaInterleavedArray<float> (cnt);
+        ParallelForRange (cnt, [&] (IntRange r)
+                          {
+                            factor_single.Range(r) = 0.0f;
+                          });
+        return;
+      }
+
+    panels = NumaInterleavedArray<TM> (cnt);
+    ParallelForRange (cnt, [&] (IntRange r)
+                      {
+                        panels.Range(r) = TM(0.0);
+                      });
   }
 
   template <class TM>
@@ -573,7 +935,18 @@ namespace ngla
 	cout << IM(4) << "SparseCholesky::FactorNew called with matrix of different size." << endl;
 	return;
       }
-    lfact = TM(0.0);
+    if (supernodal)
+      {
+        // the scratch file contains the old factor
+        if (scratch)
+          AllocatePanels();
+        else if (single_precision)
+          factor_single = 0.0f;
+        else
+          panels = TM(0.0);
+      }
+    else
+      lfact = TM(0.0);
 
     if (!inner && !cluster)
       ParallelFor 
@@ -614,14 +987,18 @@ namespace ngla
 	    }
 	}
     tf.Stop();
-    #ifdef LAPACK
-      FactorSPD();
-    #else
-      throw Exception ("No Lapack");
-    #endif // LAPACK
-  }
- 
 
+    if (supernodal)
+      FactorSupernodal();
+    else
+      {
+#ifdef LAPACK
+        FactorSPD();
+#else
+        throw Exception ("No Lapack");
+#endif // LAPACK
+      }
+  }
 
 
   template <class TM>
@@ -1566,6 +1943,168 @@ namespace ngla
 
 
 
+  /*
+    Supernodal factorization:
+    Every block is a dense column panel  P = [ A11 ; B ] 
+    with the block dofs followed by the external dofs of the block.
+    The Schur complement  -B D B^t  is computed column-chunk wise by dense 
+    BLAS-3 kernels and scattered directly into the panels of the ancestors.
+   */
+  template <class TM>
+  void SparseCholeskyTM<TM> :: FactorSupernodal ()
+  {
+    if (!task_manager)
+      {
+        RunWithTaskManager ([&] ()
+                            {
+                              FactorSupernodal();
+                            });
+        return;
+      }
+
+    if constexpr (is_same<TM,double>::value)
+      if (single_precision)
+        {
+          FactorSupernodalT<float> ();
+          return;
+        }
+    FactorSupernodalT<TM> ();
+  }
+
+
+  /*
+    The panels are stored in TF. For TF = float every block is copied
+    to a TM work panel, factored there, and rounded back when it is final.
+    The updates of the ancestors are accumulated in TF.
+   */
+  template <class TM> template <typename TF>
+  void SparseCholeskyTM<TM> :: FactorSupernodalT ()
+  {
+    static Timer factor_timer("SparseCholesky::Factor supernodal");
+    static Timer timer_panel("SparseCholesky::Factor supernodal - panel");
+    static Timer timer_update("SparseCholesky::Factor supernodal - update");
+    RegionTimer reg (factor_timer);
+
+    size_t n = nused;
+    if (n > 2000)
+      cout << IM(4) << " factor supernodal " << flush;
+
+    TableCreator<int> creator_trans(block_dependency.Size());
+    for ( ; !creator_trans.Done(); creator_trans++)
+      ParallelFor (block_dependency.Size(), [&] (int i)
+                   {
+                     for (int j : block_dependency[i])
+                       creator_trans.Add(j, i);
+                   });
+    auto block_dep_trans = creator_trans.MoveTable();
+
+    // one lock per column, i.e. per panel column of the ancestors
+    Array<MyMutex> locks(n);
+    
+    RunParallelDependency
+      (block_dependency, block_dep_trans, [&] (int blocknr)
+       {
+         IntRange block = BlockDofs(blocknr);
+         auto extdofs = BlockExtDofs(blocknr);
+         size_t mi = block.Size();
+         size_t next = extdofs.Size();
+
+         auto fpanel = BlockPanel<TF>(blocknr);
+         Matrix<TM,ColMajor> work;
+         FlatMatrix<TM,ColMajor> panel;
+         if constexpr (is_same<TF,TM>::value)
+           panel.AssignMemory (fpanel.Height(), fpanel.Width(), fpanel.Data());
+         else
+           {
+             work.SetSize (fpanel.Height(), fpanel.Width());
+             work = fpanel;
+             panel.AssignMemory (work.Height(), work.Width(), work.Data());
+           }
+         auto A11 = panel.Rows(0, mi);
+         auto B = panel.Rows(mi, mi+next);
+
+         {
+           RegionTracer reg(TaskManager::GetThreadId(), timer_panel, mi);
+           if (!hermitian)
+             {
+               CalcLDL (A11);
+               if (next)
+                 CalcLDL_SolveL (A11, B);
+             }
+           else
+             {
+               CalcLDLH (A11);
+               if (next)
+                 CalcLDL_SolveL (A11, B);
+             }
+         }
+
+         // update = -B D B^t, in chunks of columns
+         constexpr size_t BS = 128;
+         ArrayMem<TM,1000> updmem(next * min(next,BS));
+         
+         for (size_t c0 = 0; c0 < next; c0 += BS)
+           {
+             RegionTracer reg(TaskManager::GetThreadId(), timer_update, next);
+             size_t c1 = min(c0+BS, next);
+             FlatMatrix<TM,ColMajor> upd(next-c0, c1-c0, updmem.Data());
+             upd = TM(0.0);
+             
+             if (!hermitian)
+               MySubADBt (B.Rows(c0, next), A11.Diag(), B.Rows(c0, c1), upd.Rows(0, next-c0), false);
+             else
+               MySubADBh (B.Rows(c0, next), A11.Diag(), B.Rows(c0, c1), upd.Rows(0, next-c0), false);
+             
+             // extend-add into the panels of the ancestors
+             ParallelFor (c1-c0, [=,&locks] (size_t jl)
+               {
+                 size_t j = c0+jl;
+                 int gj = extdofs[j];
+                 int target = block_of_dof[gj];
+                 IntRange trange = BlockDofs(target);
+                 auto text = BlockExtDofs(target);
+                 auto tcol = BlockPanel<TF>(target).Col(gj-trange.First());
+                 
+                 locks[gj].lock();
+                 size_t pos = 0;
+                 for (size_t k = j; k < next; k++)
+                   {
+                     int gk = extdofs[k];
+                     if (size_t(gk) < trange.Next())
+                       tcol(gk-trange.First()) += TF(upd(k-c0, jl));
+                     else
+                       {
+                         while (text[pos] != gk) pos++;
+                         tcol(trange.Size()+pos) += TF(upd(k-c0, jl));
+                       }
+                   }
+                 locks[gj].unlock();
+               }, (c1-c0) > 50 ? TasksPerThread(1) : 1);
+           }
+         
+         // store D^{-1} and scale the columns:  L = (L D) D^{-1}
+         for (size_t j = 0; j < mi; j++)
+           {
+             TM dj = A11(j,j);
+             diag[block.First()+j] = dj;
+             auto colj = panel.Col(j);
+             for (size_t k = j+1; k < colj.Size(); k++)
+               colj(k) = colj(k) * dj;
+           }
+
+         if constexpr (!is_same<TF,TM>::value)
+           fpanel = work;
+
+         // the panel is final, all descendants are done
+         ReleasePanel (blocknr);
+       });
+
+    if (n > 2000)
+      cout << IM(4) << endl;
+  }
+
+
+
 
 
   
@@ -1710,6 +2249,20 @@ namespace ngla
   template <class TM, class TV_ROW, class TV_COL>
   void SparseCholesky<TM, TV_ROW, TV_COL> :: 
   SolveReordered (FlatVector<TVX> hy) const
+  {
+    if constexpr (is_same<TM,double>::value)
+      if (this->single_precision)
+        {
+          SolveReorderedT<float> (hy);
+          return;
+        }
+    SolveReorderedT<TM> (hy);
+  }
+
+  
+  template <class TM, class TV_ROW, class TV_COL> template <typename TF>
+  void SparseCholesky<TM, TV_ROW, TV_COL> :: 
+  SolveReorderedT (FlatVector<TVX> hy) const
   {
     static Timer timer1("SparseCholesky<d,d,d>::MultAdd fac1");
     static Timer timer2("SparseCholesky<d,d,d>::MultAdd fac2");
@@ -1804,6 +2357,7 @@ namespace ngla
                              size_t blocknr = task.blocknr;
                              auto range = BlockDofs (blocknr);
                              if (range.Size()==0) return;
+                             this->PrefetchPanel (blocknr);
                              
                              // if (task.solveL)
                              if (task.type == MicroTask::LB_BLOCK)
@@ -1820,21 +2374,20 @@ namespace ngla
                                      size_t size = range.end()-i-1;
                                      if (size > 0)
                                        {
-                                         FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                         auto vlfact = this->template LColBlock<TF>(i, range);
                                          
                                          auto hyr = hy.Range(i+1, range.end());
                                          for (size_t j = 0; j < size; j++)
-                                           hyr(j) -= Trans(vlfact(j)) * hyi;
+                                           hyr(j) -= Trans(TM(vlfact(j))) * hyi;
                                        }
                                      if (extdofs.Size() == 0)
                                        {
                                          // cerr << "should not be here" << endl;
                                          continue;
                                        }
-                                     size_t first = firstinrow[i] + range.end()-i-1;
-                                     FlatVector<TM> ext_lfact (extdofs.Size(), &lfact[first]);
+                                     auto ext_lfact = this->template LColExt<TF>(i, range);
                                      for (size_t j = 0; j < temp.Size(); j++)
-                                       temp(j) += Trans(ext_lfact(j)) * hyi;
+                                       temp(j) += Trans(TM(ext_lfact(j))) * hyi;
                                    }
                                  
                                  for (size_t j : Range(extdofs))
@@ -1848,12 +2401,12 @@ namespace ngla
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     auto vlfact = this->template LColBlock<TF>(i, range);
 
                                      TVX hyi = hy(i);
                                      auto hyr = hy.Range(i+1, range.end());
                                      for (size_t j = 0; j < hyr.Size(); j++)
-                                       hyr(j) -= Trans(vlfact(j)) * hyi;
+                                       hyr(j) -= Trans(TM(vlfact(j))) * hyi;
                                    }
 
                                }
@@ -1872,13 +2425,11 @@ namespace ngla
                                      
                                      for (auto i : range)
                                        {
-                                         size_t first = firstinrow[i] + range.end()-i-1;
-                                         
-                                         FlatVector<TM> ext_lfact (all_extdofs.Size(), &lfact[first]);
+                                         auto ext_lfact = this->template LColExt<TF>(i, range);
  
                                          TVX hyi = hy(i);
                                          for (size_t j = 0; j < temp.Size(); j++)
-                                           temp(j) += Trans(ext_lfact(myr.begin()+j)) * hyi;
+                                           temp(j) += Trans(TM(ext_lfact(myr.begin()+j))) * hyi;
                                        }
                                      
                                      for (size_t j : Range(extdofs))
@@ -1921,6 +2472,7 @@ namespace ngla
                              int blocknr = task.blocknr;
                              auto range = BlockDofs (blocknr);
                              if (range.Size()==0) return;
+                             this->PrefetchPanel (blocknr);
                              
                              if (task.type == MicroTask::LB_BLOCK)
                                { // first B then L
@@ -1934,24 +2486,23 @@ namespace ngla
                                  if (extdofs.Size())
                                    for (auto i : range)
                                      {
-                                       size_t first = firstinrow[i] + range.end()-i-1;
-                                       FlatVector<TM> ext_lfact (extdofs.Size(), &lfact[first]);
+                                       auto ext_lfact = this->template LColExt<TF>(i, range);
                                        
                                        TVX val(0.0);
                                        for (auto j : Range(extdofs))
-                                         val += ext_lfact(j) * temp(j);
+                                         val += TM(ext_lfact(j)) * temp(j);
                                        hy(i) -= val;
                                      }
                                  for (size_t i = range.end()-1; i-- > range.begin(); )
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     auto vlfact = this->template LColBlock<TF>(i, range);
                                      auto hyr = hy.Range(i+1, range.end());
 
                                      TVX hyi = hy(i);
                                      for (size_t j = 0; j < vlfact.Size(); j++)
-                                       hyi -= vlfact(j) * hyr(j);
+                                       hyi -= TM(vlfact(j)) * hyr(j);
                                      hy(i) = hyi;
                                    }
                                  
@@ -1964,12 +2515,12 @@ namespace ngla
                                    {
                                      size_t size = range.end()-i-1;
                                      if (size == 0) continue;
-                                     FlatVector<TM> vlfact(size, &lfact[firstinrow[i]]);
+                                     auto vlfact = this->template LColBlock<TF>(i, range);
                                      auto hyr = hy.Range(i+1, range.end());
 
                                      TVX hyi = hy(i);
                                      for (size_t j = 0; j < vlfact.Size(); j++)
-                                       hyi -= vlfact(j) * hyr(j);
+                                       hyi -= TM(vlfact(j)) * hyr(j);
                                      hy(i) = hyi;
                                    }
 
@@ -1990,12 +2541,11 @@ namespace ngla
     
                                      for (auto i : range)
                                        {
-                                         size_t first = firstinrow[i] + range.end()-i-1;
-                                         FlatVector<TM> ext_lfact (all_extdofs.Size(), &lfact[first]);
+                                         auto ext_lfact = this->template LColExt<TF>(i, range);
     
                                          TVX val(0.0);
                                          for (auto j : Range(extdofs))
-                                           val += ext_lfact(myr.begin()+j) * temp(j);
+                                           val += TM(ext_lfact(myr.begin()+j)) * temp(j);
                                          AtomicAdd (hy(i), -val);
                                        }
                                    }
@@ -2007,13 +2557,251 @@ namespace ngla
     
   }
 
+  template <class TM, class TV_ROW, class TV_COL>
+  void SparseCholesky<TM, TV_ROW, TV_COL> :: 
+  SolveReorderedMulti (SliceMatrix<TVX> hy) const
+  {
+    // hy is nused x k, row i holds dof i for all right hand sides,
+    // every column of L is loaded once for all k right hand sides
+    static Timer timer1("SparseCholesky::MultAdd(mv) fac1");
+    static Timer timer2("SparseCholesky::MultAdd(mv) fac2");
+
+    size_t k = hy.Width();
+    bool supernodal = this->IsSupernodal();
+    
+    // L-block times rows of hy within block
+    auto triangular = [&] (IntRange range, bool trans)
+      {
+        if (!trans)
+          for (auto i : range)
+            {
+              auto vlfact = LColBlock(i, range);
+              auto hyi = hy.Row(i);
+              for (size_t j = 0; j < vlfact.Size(); j++)
+                hy.Row(i+1+j) -= vlfact(j) * hyi;
+            }
+        else
+          if (range.Size() > 0)
+            for (size_t i = range.end()-1; i-- > range.begin(); )
+              {
+                auto vlfact = LColBlock(i, range);
+                auto hyi = hy.Row(i);
+                for (size_t j = 0; j < vlfact.Size(); j++)
+                  hyi -= vlfact(j) * hy.Row(i+1+j);
+              }
+      };
+
+    // temp = L(myr, range) * hy(range)
+    auto ext_product = [&] (int blocknr, IntRange range, IntRange myr, FlatMatrix<TVX> temp)
+      {
+        if (supernodal)
+          {
+            auto panel = this->BlockPanel(blocknr);
+            temp = panel.Rows(range.Size()+myr.First(), range.Size()+myr.Next()) * hy.Rows(range);
+            return;
+          }
+        temp = TVX(0.0);
+        for (auto i : range)
+          {
+            auto ext_lfact = LColExt(i, range).Range(myr);
+            auto hyi = hy.Row(i);
+            for (size_t j = 0; j < temp.Height(); j++)
+              temp.Row(j) += ext_lfact(j) * hyi;
+          }
+      };
+
+    // val = Trans(L(myr, range)) * temp
+    auto ext_product_trans = [&] (int blocknr, IntRange range, IntRange myr,
+                                  FlatMatrix<TVX> temp, FlatMatrix<TVX> val)
+      {
+        if (supernodal)
+          {
+            auto panel = this->BlockPanel(blocknr);
+            val = Trans(panel.Rows(range.Size()+myr.First(), range.Size()+myr.Next())) * temp;
+            return;
+          }
+        for (auto i : range)
+          {
+            auto ext_lfact = LColExt(i, range).Range(myr);
+            auto vali = val.Row(i-range.First());
+            vali = TVX(0.0);
+            for (size_t j = 0; j < temp.Height(); j++)
+              vali += ext_lfact(j) * temp.Row(j);
+          }
+      };
+    
+    timer1.Start();
+
+    if (hermitian)
+      ParallelFor (hy.Height(), [&] (size_t i)
+                   {
+                     for (size_t l = 0; l < k; l++)
+                       hy(i,l) = Conj(hy(i,l));
+                   });
+    
+    RunParallelDependency (micro_dependency, micro_dependency_trans,
+                           [&] (int nr) 
+                           {
+                             auto task = microtasks[nr];
+                             size_t blocknr = task.blocknr;
+                             auto range = BlockDofs (blocknr);
+                             if (range.Size()==0) return;
+                             this->PrefetchPanel (blocknr);
+
+                             if (task.type != MicroTask::B_BLOCK)
+                               triangular (range, false);
+                             if (task.type == MicroTask::L_BLOCK)
+                               return;
+
+                             auto all_extdofs = BlockExtDofs (blocknr);
+                             IntRange myr = Range(all_extdofs);
+                             if (task.type == MicroTask::B_BLOCK)
+                               myr = myr.Split (task.bblock, task.nbblocks);
+                             auto extdofs = all_extdofs.Range(myr);
+                             if (extdofs.Size() == 0) return;
+                             
+                             ArrayMem<TVX,1000> mem(extdofs.Size()*k);
+                             FlatMatrix<TVX> temp(extdofs.Size(), k, mem.Data());
+                             ext_product (blocknr, range, myr, temp);
+                             
+                             for (size_t j : Range(extdofs))
+                               for (size_t l = 0; l < k; l++)
+                                 AtomicAdd (hy(extdofs[j], l), -temp(j,l));
+                           });
+
+    if (hermitian)
+      ParallelFor (hy.Height(), [&] (size_t i)
+                   {
+                     for (size_t l = 0; l < k; l++)
+                       hy(i,l) = Conj(hy(i,l));
+                   });
+    
+    timer1.Stop();
+
+    // solve with the diagonal
+    ParallelFor (hy.Height(), [&] (size_t i)
+                 {
+                   hy.Row(i) *= diag[i];
+                 });
+    
+    timer2.Start();
+
+    RunParallelDependency (micro_dependency_trans, micro_dependency,
+                           [&] (int nr) 
+                           {
+                             auto task = microtasks[nr];
+                             size_t blocknr = task.blocknr;
+                             auto range = BlockDofs (blocknr);
+                             if (range.Size()==0) return;
+                             this->PrefetchPanel (blocknr);
+
+                             if (task.type != MicroTask::L_BLOCK)
+                               {
+                                 auto all_extdofs = BlockExtDofs (blocknr);
+                                 IntRange myr = Range(all_extdofs);
+                                 if (task.type == MicroTask::B_BLOCK)
+                                   myr = myr.Split (task.bblock, task.nbblocks);
+                                 auto extdofs = all_extdofs.Range(myr);
+
+                                 if (extdofs.Size())
+                                   {
+                                     ArrayMem<TVX,1000> mem(extdofs.Size()*k);
+                                     FlatMatrix<TVX> temp(extdofs.Size(), k, mem.Data());
+                                     for (size_t j : Range(extdofs))
+                                       temp.Row(j) = hy.Row(extdofs[j]);
+                                     
+                                     ArrayMem<TVX,1000> valmem(range.Size()*k);
+                                     FlatMatrix<TVX> val(range.Size(), k, valmem.Data());
+                                     ext_product_trans (blocknr, range, myr, temp, val);
+
+                                     if (task.type == MicroTask::LB_BLOCK)
+                                       hy.Rows(range) -= val;
+                                     else
+                                       for (size_t i : Range(range))
+                                         for (size_t l = 0; l < k; l++)
+                                           AtomicAdd (hy(range.First()+i, l), -val(i,l));
+                                   }
+                               }
+                             
+                             if (task.type != MicroTask::B_BLOCK)
+                               triangular (range, true);
+                           });
+    
+    timer2.Stop();
+  }
+
+
   template <class TM, class TV_ROW, class TV_COL>
   void SparseCholesky<TM, TV_ROW, TV_COL> :: 
   MultAdd (TSCAL_VEC s, const BaseVector & x, BaseVector & y) const
+  {
+    if (!this->single_precision)
+      {
+        MultAddSolve (s, x, y);
+        return;
+      }
+
+    // iterative refinement with the single precision factor
+    static Timer timer("SparseCholesky::MultAdd refinement");
+    RegionTimer reg (timer);
+
+    auto mat = dynamic_pointer_cast<const BaseMatrix> (this->matrix.lock());
+    if (!mat)
+      throw Exception("SparseCholesky: matrix not available any more, needed for iterative refinement");
+
+    auto sol = CreateColVector();
+    auto res = CreateColVector();
+    auto w = CreateColVector();
+    FlatVector<TVX> fres = res.FV<TVX>();
+    auto restrict_to_used = [&] ()
+      {
+        ParallelFor (Range(height), [&] (int i)
+                     {
+                       if (!this->IsUsedDof(i))
+                         fres(i) = TVX(0.0);
+                     });
+      };
+    
+    *res = x;
+    restrict_to_used();
+    double norm0 = L2Norm (*res);
+    double tol = this->refinement_tol * norm0;
+
+    // keep the best iterate, the refinement may stagnate or diverge
+    // if the matrix is too ill-conditioned for the float factor
+    auto best = CreateColVector();
+    *sol = 0.0;
+    *best = 0.0;
+    double bestnorm = norm0;
+    for (int it = 0; it <= this->refinement_steps && bestnorm > tol; it++)
+      {
+        *w = 0.0;
+        MultAddSolve (1, *res, *w);
+        *sol += *w;
+        *res = x - (*mat) * *sol;
+        restrict_to_used();
+        double norm = L2Norm (*res);
+        if (norm >= bestnorm)
+          break;
+        bestnorm = norm;
+        *best = *sol;
+      }
+
+    if (bestnorm > tol)
+      throw Exception ("SparseCholesky: iterative refinement not converged, relative residual = "
+                       + ToString(bestnorm/norm0)
+                       + ", factor without 'singleprecision'");
+    y += s * *best;
+  }
+
+
+  template <class TM, class TV_ROW, class TV_COL>
+  void SparseCholesky<TM, TV_ROW, TV_COL> :: 
+  MultAddSolve (TSCAL_VEC s, const BaseVector & x, BaseVector & y) const
   {
     static Timer timer("SparseCholesky<d,d,d>::MultAdd");
     RegionTimer reg (timer);
-    timer.AddFlops (2.0*lfact.Size());
+    timer.AddFlops (2.0*this->nze);
 
     // int n = Height();
     
@@ -2068,6 +2856,58 @@ namespace ngla
   
 
 
+  template <class TM, class TV_ROW, class TV_COL>
+  void SparseCholesky<TM, TV_ROW, TV_COL> :: 
+  MultAdd (FlatVector<double> alpha, const MultiVector & x, MultiVector & y) const
+  {
+    if constexpr (!IsScalar<TM>() || !IsScalar<TVX>())
+      {
+        // blocked solve only for scalar factors
+        BaseMatrix::MultAdd (alpha, x, y);
+      }
+    else
+      {
+        static Timer timer("SparseCholesky::MultAdd(mv)");
+        RegionTimer reg (timer);
+        
+        size_t k = x.Size();
+        timer.AddFlops (2.0*this->nze*k);
+        if (k == 0) return;
+        if (this->single_precision)
+          {
+            // iterative refinement is done vector by vector
+            BaseMatrix::MultAdd (alpha, x, y);
+            return;
+          }
+        
+        Array<FlatVector<TVX>> fx(k), fy(k);
+        for (size_t l = 0; l < k; l++)
+          {
+            fx[l].AssignMemory (height, x[l]->FV<TVX>().Data());
+            fy[l].AssignMemory (height, y[l]->FV<TVX>().Data());
+          }
+        
+        Matrix<TVX> hy(this->nused, k);
+        ParallelFor (Range(height), [&] (int i)
+                     {
+                       if (order[i] != -1)
+                         for (size_t l = 0; l < k; l++)
+                           hy(order[i], l) = fx[l](i);
+                     });
+        
+        SolveReorderedMulti(hy);
+        
+        ParallelFor (Range(height), [&] (int i)
+                     {
+                       if (this->IsUsedDof(i))
+                         for (size_t l = 0; l < k; l++)
+                           fy[l](i) += alpha(l) * hy(order[i], l);
+                     });
+      }
+  }
+
+
+
   template <class TM, class TV_ROW, class TV_COL>
   void SparseCholesky<TM, TV_ROW, TV_COL> :: 
   Smooth (BaseVector & u, const BaseVector & f, BaseVector & y) const
@@ -2108,6 +2948,66 @@ namespace ngla
 
 
 
+  MappedScratchFile :: MappedScratchFile (const string & dir, size_t asize)
+    : size(asize)
+  {
+#ifdef WIN32
+    throw Exception ("MappedScratchFile: out-of-core storage not available on Windows");
+#else
+    string name = dir + "/ngsolve_scratch_XXXXXX";
+    fd = mkstemp (name.data());
+    if (fd < 0)
+      throw Exception ("MappedScratchFile: cannot create scratch file in '" + dir + "'");
+    // the file is removed as soon as it is closed
+    unlink (name.c_str());
+
+    if (ftruncate (fd, max(size, size_t(1))) != 0)
+      {
+        close (fd);
+        throw Exception ("MappedScratchFile: cannot allocate " + ToString(size) + " bytes in '" + dir + "'");
+      }
+    data = mmap (nullptr, max(size, size_t(1)), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+      {
+        close (fd);
+        throw Exception ("MappedScratchFile: mmap failed");
+      }
+#endif
+  }
+
+  MappedScratchFile :: ~MappedScratchFile ()
+  {
+#ifndef WIN32
+    munmap (data, max(size, size_t(1)));
+    close (fd);
+#endif
+  }
+
+  void MappedScratchFile :: Release (size_t begin, size_t end) const
+  {
+#ifndef WIN32
+    // only pages completely inside the range
+    size_t pagesize = sysconf(_SC_PAGESIZE);
+    begin = (begin + pagesize-1) / pagesize * pagesize;
+    end = end / pagesize * pagesize;
+    if (begin >= end) return;
+    char * p = static_cast<char*>(data) + begin;
+    msync (p, end-begin, MS_SYNC);
+    madvise (p, end-begin, MADV_DONTNEED);
+#endif
+  }
+
+  void MappedScratchFile :: Prefetch (size_t begin, size_t end) const
+  {
+#ifndef WIN32
+    size_t pagesize = sysconf(_SC_PAGESIZE);
+    begin = begin / pagesize * pagesize;
+    if (begin >= end) return;
+    madvise (static_cast<char*>(data) + begin, end-begin, MADV_WILLNEED);
+#endif
+  }
+
+
   SparseFactorization ::     
   SparseFactorization (shared_ptr<const BaseSparseMatrix> amatrix,
 		       shared_ptr<BitArray> ainner,
@@ -2183,10 +3083,61 @@ namespace ngla
 
 
 
+  template <class TM> template <typename TF>
+  TF * SparseCholeskyTM<TM> :: PanelEntry (int i, int j) const
+  {
+    int bnr = block_of_dof[i];
+    auto range = BlockDofs(bnr);
+    auto col = BlockPanel<TF>(bnr).Col(i-range.First());
+    if (size_t(j) < range.Next())
+      return &col(j-range.First());
+
+    // external dofs are sorted
+    auto ext = BlockExtDofs(bnr);
+    size_t first = 0, last = ext.Size();
+    while (first < last)
+      {
+        size_t mid = (first+last)/2;
+        if (ext[mid] < j)
+          first = mid+1;
+        else
+          last = mid;
+      }
+    if (first < ext.Size() && ext[first] == j)
+      return &col(range.Size()+first);
+    return nullptr;
+  }
+  
   template <class TM>
   void SparseCholeskyTM<TM> :: Set (int i, int j, const TM & val)
   {
     // *testout << "sparse cholesky, set (" << i << ", " << j << ") = " << val << endl;
+    if (supernodal)
+      {
+        TM hval = val;
+        if (i > j)
+          {
+            swap (i, j);
+            hval = Trans (val);
+            if (hermitian)
+              hval = Conj(hval);
+          }
+        if constexpr (is_same<TM,double>::value)
+          if (single_precision)
+            {
+              if (float * entry = PanelEntry<float> (i, j))
+                *entry = hval;
+              else
+                cerr << "Position " << i << ", " << j << " not found" << endl;
+              return;
+            }
+        if (TM * entry = PanelEntry (i, j))
+          *entry = hval;
+        else
+          cerr << "Position " << i << ", " << j << " not found" << endl;
+        return;
+      }
+    
     if (i == j)
       {
 	diag[i] = val;
@@ -2229,6 +3180,9 @@ namespace ngla
   template <class TM>
   const TM & SparseCholeskyTM<TM> :: Get (int i, int j) const
   {
+    // returned for entries outside the pattern of the factor
+    static const TM zero(0.0);
+
     if (i == j)
       {
 	return diag[i];
@@ -2240,6 +3194,17 @@ namespace ngla
 	cerr << "SparseCholesky::Get: access to upper side not available" << endl;
       }
 
+    if (single_precision)
+      throw Exception ("SparseCholesky::Get: factor is stored in single precision");
+
+    if (supernodal)
+      {
+        if (TM * entry = PanelEntry (i, j))
+          return *entry;
+        cerr << "Position " << i << ", " << j << " not found" << endl;
+        return zero;
+      }
+
     size_t first = firstinrow[i];
     size_t first_ri = firstinrow_ri[i];
     size_t last = firstinrow[i+1];
@@ -2254,7 +3219,7 @@ namespace ngla
 	first_ri++;
       }
     cerr << "Position " << i << ", " << j << " not found" << endl;
-    return *new TM;
+    return zero;
   }
 
   template <class TM>
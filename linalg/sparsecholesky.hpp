@@ -67,6 +67,33 @@ namespace ngla
      L is stored column-wise
   */
 
+  /*
+    A temporary file mapped into memory, used as storage for 
+    factors which do not fit into the main memory.
+    The file is removed when the object is destroyed.
+   */
+  class NGS_DLL_HEADER MappedScratchFile
+  {
+    void * data = nullptr;
+    size_t size = 0;
+    int fd = -1;
+  public:
+    MappedScratchFile (const string & dir, size_t asize);
+    ~MappedScratchFile ();
+    void * Data() const { return data; }
+    size_t Size() const { return size; }
+    /// write back the bytes [begin,end) and release them from main memory
+    void Release (size_t begin, size_t end) const;
+    /// hint that the bytes [begin,end) will be needed soon
+    void Prefetch (size_t begin, size_t end) const;
+  };
+
+  
+
+  struct SparseCholeskySymbolicBase;
+  /// release the symbolic factorizations kept for the 'symboliccache' flag
+  NGS_DLL_HEADER void ClearSparseCholeskySymbolicCache ();
+
   template<class TM>
 	   // class TV_ROW = typename mat_traits<TM>::TV_ROW, 
 	   // class TV_COL = typename mat_traits<TM>::TV_COL>
@@ -108,9 +135,32 @@ namespace ngla
     // block i has dofs  [blocks[i], blocks[i+1])
     Array<int> blocks; 
 
+    // block of dof (index into blocks)
+    Array<int> block_of_dof;
+
     // dependency graph for elimination
     Table<int> block_dependency; 
 
+    // supernodal mode: the factor of block i is stored as a dense
+    // column-major panel of size (#dofs+#extdofs) x #dofs,
+    // starting at panels[firstinpanel[i]]
+    bool supernodal = false;
+    Array<size_t> firstinpanel;
+    NumaInterleavedArray<TM> panels;
+
+    // mixed precision: the supernodal panels are stored in float already
+    // during the factorization, solves use iterative refinement
+    bool single_precision = false;
+    NumaInterleavedArray<float> factor_single;
+    double refinement_tol = 1e-12;
+    int refinement_steps = 10;
+
+    // out-of-core: if the panels exceed the memory budget (in bytes),
+    // they are stored in a memory mapped scratch file instead of panels
+    double memory_budget = 0;
+    string scratch_dir;
+    shared_ptr<MappedScratchFile> scratch;
+
   public:      // needed for gcc 4.9, why  ??? 
     class MicroTask
     {
@@ -132,6 +182,9 @@ namespace ngla
     Table<int> micro_dependency;     
     Table<int> micro_dependency_trans;     
 
+    // symbolic cache: owner of the ordering arrays if they are shared
+    shared_ptr<SparseCholeskySymbolicBase> symbolic;
+
 
     //
     MinimumDegreeOrdering * mdo;
@@ -168,7 +221,37 @@ namespace ngla
     ///
     void Allocate (const Array<int> & aorder, 
 		   const Array<MDOVertex> & vertices,
-		   const int * blocknr);
+		   const int * blocknr,
+                   FlatArray<int> treenode = FlatArray<int>(0, nullptr));
+    /// allocate supernodal panels, in main memory or in a scratch file
+    void AllocatePanels ();
+    /// bytes per panel entry, float panels in single precision
+    size_t PanelEntrySize () const { return single_precision ? sizeof(float) : sizeof(TM); }
+    /// start of the supernodal panels
+    TM * PanelData () const
+    {
+      return (scratch && !single_precision) ?
+        static_cast<TM*> (scratch->Data()) : const_cast<TM*> (panels.Data());
+    }
+    /// out-of-core: the panel of block bnr is final, write it to disk
+    void ReleasePanel (int bnr) const
+    {
+      if (scratch)
+        scratch->Release (firstinpanel[bnr]*PanelEntrySize(), firstinpanel[bnr+1]*PanelEntrySize());
+    }
+    /// out-of-core: the panel of block bnr will be used soon
+    void PrefetchPanel (int bnr) const
+    {
+      if (scratch)
+        scratch->Prefetch (firstinpanel[bnr]*PanelEntrySize(), firstinpanel[bnr+1]*PanelEntrySize());
+    }
+    /// ordering and symbolic factorization
+    void CalcSymbolic (shared_ptr<const SparseMatrixTM<TM>> a);
+    /// hash of sparsity pattern and ordering flags, 0 if caching is disabled
+    size_t SymbolicKey (const SparseMatrixTM<TM> & a) const;
+    /// reuse / store symbolic factorization of a matrix with the same pattern
+    bool RestoreSymbolic (size_t key, const SparseMatrixTM<TM> & a);
+    void StoreSymbolic (size_t key, const SparseMatrixTM<TM> & a);
 
     void DoArchive(Archive& ar) override;
     ///
@@ -178,6 +261,11 @@ namespace ngla
     template <typename T>
     void FactorSPD1 (T dummy); 
 #endif
+    /// right-looking supernodal factorization on dense block panels
+    void FactorSupernodal ();
+    /// with panels stored in TF, every block is factored in TM
+    template <typename TF>
+    void FactorSupernodalT ();
 
     virtual bool SupportsUpdate() const override { return true; }
     virtual void Update() override
@@ -202,7 +290,11 @@ namespace ngla
 
     virtual Array<MemoryUsage> GetMemoryUsage () const override
     {
-      return { MemoryUsage ("SparseChol", nze*sizeof(TM), 1) };
+      if (scratch)
+        return { MemoryUsage ("SparseChol (out-of-core)", scratch->Size(), 1) };
+      if (single_precision)
+        return { MemoryUsage ("SparseChol", factor_single.Size()*sizeof(float), 1) };
+      return { MemoryUsage ("SparseChol", (supernodal ? panels.Size() : nze)*sizeof(TM), 1) };
     }
 
     virtual size_t NZE () const override { return nze; }
@@ -210,6 +302,9 @@ namespace ngla
     void Set (int i, int j, const TM & val);
     ///
     const TM & Get (int i, int j) const;
+    /// entry (i,j) with i <= j in the supernodal panels, nullptr if not in pattern
+    template <typename TF = TM>
+    TF * PanelEntry (int i, int j) const;
     ///
     void SetOrig (int i, int j, const TM & val)
     { Set (order[i], order[j], val); }
@@ -227,6 +322,77 @@ namespace ngla
       return rowindex2.Range(base, base+ext_size);
     }
 
+    // the dense factor panel of block bnr (supernodal mode)
+    template <typename TF = TM>
+    FlatMatrix<TF,ColMajor> BlockPanel (int bnr) const
+    {
+      auto range = BlockDofs (bnr);
+      size_t nk = firstinrow[range.First()+1]-firstinrow[range.First()]+1;
+      return FlatMatrix<TF,ColMajor> (nk, range.Size(),
+                                      FactorData<TF>()+firstinpanel[bnr]);
+    }
+
+    // number of external dofs of the block with dofs range
+    size_t BlockExtSize (IntRange range) const
+    {
+      return firstinrow[range.First()+1]-firstinrow[range.First()] - range.Size()+1;
+    }
+    
+    // offset of L-column i below the diagonal within block-range,
+    // in lfact, panels or factor_single
+    size_t LColBlockOffset (int i, IntRange range) const
+    {
+      if (supernodal)
+        {
+          size_t loc = i-range.First();
+          return firstinpanel[block_of_dof[i]] + loc*(range.Size()+BlockExtSize(range)) + loc+1;
+        }
+      return firstinrow[i];
+    }
+
+    // offset of L-column i in the external rows of its block
+    size_t LColExtOffset (int i, IntRange range) const
+    {
+      if (supernodal)
+        {
+          size_t loc = i-range.First();
+          return firstinpanel[block_of_dof[i]] + loc*(range.Size()+BlockExtSize(range)) + range.Size();
+        }
+      return firstinrow[i]+range.Next()-i-1;
+    }
+
+    // the factor in working precision TM, or the float panels
+    template <typename TF = TM>
+    TF * FactorData () const
+    {
+      if constexpr (is_same<TF,TM>::value)
+        return supernodal ? PanelData() : const_cast<TM*> (lfact.Data());
+      else
+        return scratch ? static_cast<TF*> (scratch->Data()) : const_cast<TF*> (factor_single.Data());
+    }
+    
+    // entries of L-column i below the diagonal within block-range
+    template <typename TF = TM>
+    FlatVector<TF> LColBlock (int i, IntRange range) const
+    {
+      return FlatVector<TF> (range.Next()-i-1, FactorData<TF>()+LColBlockOffset(i, range));
+    }
+
+    // entries of L-column i in the external rows of its block
+    template <typename TF = TM>
+    FlatVector<TF> LColExt (int i, IntRange range) const
+    {
+      return FlatVector<TF> (BlockExtSize(range), FactorData<TF>()+LColExtOffset(i, range));
+    }
+
+    /// dof i (original numbering) is handled by the factorization
+    bool IsUsedDof (int i) const
+    {
+      if (inner) return inner->Test(i);
+      if (cluster) return (*cluster)[i] != 0;
+      return order[i] != -1;
+    }
+
 
     FlatArray<MicroTask> GetMicroTasks() const { return microtasks; }
     FlatTable<int> GetMicroDependency() const { return micro_dependency; }
@@ -241,6 +407,9 @@ namespace ngla
     FlatArray<size_t> GetFirstInRow() const { return firstinrow; }
 
     FlatArray<TM> GetLFact() const { return lfact; }
+    bool IsSupernodal() const { return supernodal; }
+    bool IsSinglePrecision() const { return single_precision; }
+    bool IsOutOfCore() const { return scratch != nullptr; }
     FlatArray<TM> GetDiag() const { return diag; }
 
     auto GetNUsed() const { return nused; }
@@ -275,6 +444,8 @@ namespace ngla
     using BASE::block_dependency;
     using BASE::BlockDofs;
     using BASE::BlockExtDofs;
+    using BASE::LColBlock;
+    using BASE::LColExt;
     using BASE::hermitian;
   public:
     typedef TV_COL TV;
@@ -299,6 +470,8 @@ namespace ngla
     {
       MultAdd (s, x, y);
     }
+    /// blocked forward/backward substitution for all vectors of x at once
+    void MultAdd (FlatVector<double> alpha, const MultiVector & x, MultiVector & y) const override;
 
     AutoVector CreateRowVector () const override { return make_unique<VVector<TV>> (height); }
     AutoVector CreateColVector () const override { return make_unique<VVector<TV>> (height); }
@@ -309,6 +482,11 @@ namespace ngla
     void SolveBlockT (int i, FlatVector<TV> hy) const;
   private:
     void SolveReordered(FlatVector<TVX> hy) const;
+    template <typename TF>
+    void SolveReorderedT(FlatVector<TVX> hy) const;
+    void SolveReorderedMulti(SliceMatrix<TVX> hy) const;
+    // y += s A^{-1} x with the stored factor, without refinement
+    void MultAddSolve (TSCAL_VEC s, const BaseVector & x, BaseVector & y) const;
   };
 
 
@@ -2881,8 +2881,14 @@ shared_ptr<BaseMatrix> CreateSparseMatrixInverse(shared_ptr<const BaseSparseMatr
         {
           auto pos = this->GetPosition(dnums1[i], dnums2[j]);
           auto entry = FlatMatrix<TSCAL>(bheight, bwidth, (TSCAL*)data.Addr(pos*bheight*bwidth));
-
-          entry += elmat.Rows(i*bheight, (i+1)*bheight).Cols(j*bwidth, (j+1)*bwidth);
+          auto elmat_ij = elmat.Rows(i*bheight, (i+1)*bheight).Cols(j*bwidth, (j+1)*bwidth);
+
+          if (use_atomic)
+            for (int k = 0; k < bheight; k++)
+              for (int l = 0; l < bwidth; l++)
+                AtomicAdd (entry(k,l), elmat_ij(k,l));
+          else
+            entry += elmat_ij;
         }
   }
 
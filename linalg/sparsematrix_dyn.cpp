@@ -185,4 +185,168 @@ namespace ngla
 
   template class SparseMatrixVariableBlocks<double>;  
 
+
+
+
+  template <typename TSCAL>
+  SparseMatrixSELL<TSCAL> ::
+  SparseMatrixSELL (const SparseMatrixTM<TSCAL> & mat, size_t sigma)
+    : height(mat.Height()), width(mat.Width()), nze(mat.NZE())
+  {
+    static Timer t("SparseMatrixSELL - create");
+    RegionTimer reg(t);
+
+    if (dynamic_cast<const SparseMatrixSymmetric<TSCAL>*> (&mat))
+      throw Exception ("SparseMatrixSELL: symmetric storage not supported");
+
+    sigma = max(C, sigma / C * C);
+    size_t nchunks = (height+C-1) / C;
+    
+    // sort rows by decreasing length within windows of sigma rows
+    perm.SetSize (nchunks*C);
+    for (size_t i = 0; i < perm.Size(); i++)
+      perm[i] = i < height ? i : -1;
+    ParallelFor ((height+sigma-1)/sigma, [&] (size_t w)
+                 {
+                   auto rowlen = [&] (int row) -> size_t
+                     { return row < 0 ? 0 : mat.GetRowIndices(row).Size(); };
+                   std::stable_sort (perm.Data()+w*sigma, perm.Data()+min(perm.Size(), (w+1)*sigma),
+                                     [&] (int a, int b) { return rowlen(a) > rowlen(b); });
+                 });
+    
+    firstinchunk.SetSize (nchunks+1);
+    firstinchunk[0] = 0;
+    for (size_t k = 0; k < nchunks; k++)
+      {
+        size_t len = 0;
+        for (size_t l = 0; l < C; l++)
+          if (perm[k*C+l] >= 0)
+            len = max(len, mat.GetRowIndices(perm[k*C+l]).Size());
+        firstinchunk[k+1] = firstinchunk[k] + len*C;
+      }
+
+    // padding entries have value 0 and refer to column 0
+    colnr.SetSize (firstinchunk[nchunks]);
+    data.SetSize (firstinchunk[nchunks]);
+    ParallelFor (nchunks, [&] (size_t k)
+                 {
+                   size_t first = firstinchunk[k];
+                   size_t len = (firstinchunk[k+1]-first) / C;
+                   for (size_t l = 0; l < C; l++)
+                     {
+                       int row = perm[k*C+l];
+                       size_t rowlen = 0;
+                       if (row >= 0)
+                         {
+                           auto cols = mat.GetRowIndices(row);
+                           auto vals = mat.GetRowValues(row);
+                           rowlen = cols.Size();
+                           for (size_t j = 0; j < rowlen; j++)
+                             {
+                               colnr[first+j*C+l] = cols[j];
+                               data[first+j*C+l] = vals[j];
+                             }
+                         }
+                       for (size_t j = rowlen; j < len; j++)
+                         {
+                           colnr[first+j*C+l] = 0;
+                           data[first+j*C+l] = TSCAL(0.0);
+                         }
+                     }
+                 });
+  }
+
+  template <typename TSCAL> template <typename TS>
+  void SparseMatrixSELL<TSCAL> ::
+  MultAddImpl (TS s, const BaseVector & x, BaseVector & y) const
+  {
+    static Timer t("SparseMatrixSELL::MultAdd");
+    RegionTimer reg(t);
+    t.AddFlops (2*nze);
+    
+    auto fx = x.FV<TSCAL>();
+    auto fy = y.FV<TSCAL>();
+    
+    ParallelForRange
+      (firstinchunk.Size()-1, [&] (IntRange myrange)
+       {
+         for (size_t k : myrange)
+           {
+             const TSCAL * pdata = data.Data()+firstinchunk[k];
+             const int * pcol = colnr.Data()+firstinchunk[k];
+             size_t len = (firstinchunk[k+1]-firstinchunk[k]) / C;
+             const int * prow = perm.Data()+k*C;
+
+             if constexpr (is_same<TSCAL,double>::value)
+               {
+                 // one SIMD lane per row of the chunk
+                 constexpr size_t W = SIMD<double>::Size();
+                 static_assert (C % W == 0, "SELL chunk must be a multiple of the SIMD width");
+                 
+                 SIMD<double> sum[C/W];
+                 for (size_t b = 0; b < C/W; b++)
+                   sum[b] = SIMD<double>(0.0);
+                 
+                 for (size_t j = 0; j < len; j++, pdata += C, pcol += C)
+                   for (size_t b = 0; b < C/W; b++)
+                     {
+                       SIMD<double> xi([&] (int i) { return fx(pcol[b*W+i]); });
+                       sum[b] = FMA (SIMD<double>(pdata+b*W), xi, sum[b]);
+                     }
+                 
+                 for (size_t b = 0; b < C/W; b++)
+                   for (size_t i = 0; i < W; i++)
+                     if (int row = prow[b*W+i]; row >= 0)
+                       fy(row) += s * sum[b][i];
+               }
+             else
+               {
+                 TSCAL sum[C];
+                 for (size_t l = 0; l < C; l++)
+                   sum[l] = 0.0;
+                 
+                 for (size_t j = 0; j < len; j++, pdata += C, pcol += C)
+                   for (size_t l = 0; l < C; l++)
+                     sum[l] += pdata[l] * fx(pcol[l]);
+                 
+                 for (size_t l = 0; l < C; l++)
+                   if (int row = prow[l]; row >= 0)
+                     fy(row) += s * sum[l];
+               }
+           }
+       }, TasksPerThread(4));
+  }
+
+  template <typename TSCAL>
+  void SparseMatrixSELL<TSCAL> ::
+  MultAdd (double s, const BaseVector & x, BaseVector & y) const
+  {
+    MultAddImpl (s, x, y);
+  }
+
+  template <typename TSCAL>
+  void SparseMatrixSELL<TSCAL> ::
+  MultAdd (Complex s, const BaseVector & x, BaseVector & y) const
+  {
+    if constexpr (is_same<TSCAL,Complex>::value)
+      MultAddImpl (s, x, y);
+    else
+      BaseMatrix::MultAdd (s, x, y);
+  }
+  
+  template <typename TSCAL>  
+  AutoVector SparseMatrixSELL<TSCAL> :: CreateRowVector () const
+  {
+    return CreateBaseVector(width, ngbla::IsComplex<TSCAL>(), 1);
+  }
+
+  template <typename TSCAL>  
+  AutoVector SparseMatrixSELL<TSCAL> :: CreateColVector () const
+  {
+    return CreateBaseVector(height, ngbla::IsComplex<TSCAL>(), 1);
+  }
+
+  template class SparseMatrixSELL<double>;
+  template class SparseMatrixSELL<Complex>;
+
 }
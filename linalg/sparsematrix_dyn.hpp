@@ -85,6 +85,45 @@ namespace ngla
 
 
 
+  /*
+    Sparse matrix in SELL-C-sigma format:
+    rows are sorted by length within windows of sigma rows, 
+    and stored in chunks of C rows. Within a chunk, the entries are 
+    stored column by column, padded to the longest row of the chunk.
+    Suited for SIMD matrix-vector products with short rows.
+  */
+  template <class TSCAL>
+  class  NGS_DLL_HEADER SparseMatrixSELL : public S_BaseMatrix<TSCAL>
+  {
+  public:
+    static constexpr size_t C = 8;
+  protected:
+    size_t height, width, nze;
+    Array<int> perm;            // row of position i in sorted order
+    Array<size_t> firstinchunk; // chunk k: entries [firstinchunk[k], firstinchunk[k+1])
+    Array<int> colnr;
+    Array<TSCAL> data;
+
+    template <typename TS>
+    void MultAddImpl (TS s, const BaseVector & x, BaseVector & y) const;
+    
+  public:
+    SparseMatrixSELL (const SparseMatrixTM<TSCAL> & mat, size_t sigma = 256);
+
+    int VHeight() const override { return height; }
+    int VWidth() const override { return width; }
+
+    void MultAdd (double s, const BaseVector & x, BaseVector & y) const override;
+    void MultAdd (Complex s, const BaseVector & x, BaseVector & y) const override;
+
+    AutoVector CreateRowVector () const override;
+    AutoVector CreateColVector () const override;
+
+    /// non-zeros of the original matrix over stored entries (including padding)
+    double GetFillRatio () const { return data.Size() ? double(nze) / data.Size() : 1; }
+  };
+  
+
 }
 #endif
   
@@ -348,6 +348,10 @@ namespace ngla
       diag(mat.GetDiag()),
       order(mat.GetOrder())
   {
+    if (mat.IsSupernodal())
+      throw Exception("DevSparseCholesky: supernodal storage not supported");
+    if (mat.IsSinglePrecision())
+      throw Exception("DevSparseCholesky: single precision factor not supported");
     auto hostdep = mat.GetMicroDependency();
   
     host_incomingdep = 0;
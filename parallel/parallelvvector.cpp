@@ -541,6 +541,15 @@ namespace ngla
       paralleldofs = dynamic_cast<ParallelBaseVector&>(*v).GetParallelDofs();
     }
 
+    unique_ptr<MultiVector> Range (IntRange r) const override
+    {
+      // keep the parallel type, such that sub-ranges take the fast inner product
+      auto mv2 = make_unique<ParallelMultiVector>(refvec, 0);
+      for (auto i : r)
+        mv2->vecs.Append (vecs[i]);
+      return mv2;
+    }
+
     void MakeSameStatus () const
     {
       if (Size() == 0) return;
@@ -582,6 +591,16 @@ namespace ngla
             
             return res;
           }
+        else if (status1 == CUMULATED && status2 == CUMULATED)
+          {
+            // Distribute is local, so a distributed copy of v2 gives
+            // all inner products with a single reduction
+            auto dv2 = v2.RefVec()->CreateMultiVector(v2.Size());
+            *dv2 = v2;
+            for (int i = 0; i < dv2->Size(); i++)
+              (*dv2)[i]->Distribute();
+            return InnerProductD(*dv2);
+          }
 
       // fallback
       return MultiVector::InnerProductD(v2);
@@ -1,6 +1,6 @@
 
 from ngsolve import Projector, Norm, TimeFunction, BaseMatrix, Preconditioner, InnerProduct, \
-    Norm, sqrt, Vector, Matrix, BaseVector, BlockVector, BitArray
+    Norm, sqrt, Vector, Matrix, BaseVector, BlockVector, BitArray, MultiVector
 from typing import Optional, Callable, Union
 import logging
 from netgen.libngpy._meshing import _PushStatus, _GetStatus, _SetThreadPercentage
@@ -187,11 +187,17 @@ class CGSolver(LinearSolver):
 
 conjugate : bool = False
   If set to True, then the complex inner product is used, else a pseudo inner product that makes CG work with complex symmetric matrices.
+
+pipelined : bool = False
+  If set to True, the pipelined variant (Ghysels-Vanroose) is used. Both inner products
+  of an iteration are computed by one fused reduction. ngsolve.la.CGSolver(pipelined=True)
+  in addition overlaps this reduction with preconditioner and matrix application.
 """
     name = "CG"
 
     def __init__(self, *args,
                  conjugate : bool = False,
+                 pipelined : bool = False,
                  abstol : float = None,
                  maxsteps : int = None,
                  printing : bool = False,
@@ -207,6 +213,7 @@ conjugate : bool = False
             kwargs["maxiter"] = maxsteps
         super().__init__(*args, **kwargs)
         self.conjugate = conjugate
+        self.pipelined = pipelined
 
     # for backward compatibility
     @property
@@ -214,6 +221,8 @@ conjugate : bool = False
         return self.residuals
 
     def _SolveImpl(self, rhs : BaseVector, sol : BaseVector):
+        if self.pipelined:
+            return self._SolveImplPipelined(rhs, sol)
         d, w, s = [sol.CreateVector() for i in range(3)]
         conjugate = self.conjugate
         d.data = rhs - self.mat * sol
@@ -242,6 +251,54 @@ conjugate : bool = False
             s *= beta
             s.data += w
 
+    def _SolveImplPipelined(self, rhs : BaseVector, sol : BaseVector):
+        conjugate = self.conjugate
+        W = MultiVector(rhs, 1)
+        Y = MultiVector(rhs, 2)
+        w, d, aw = W[0], Y[0], Y[1]
+        m, am, p, q, s, z = [sol.CreateVector() for i in range(6)]
+        d.data = rhs - self.mat * sol
+        w.data = self.pre * d
+        aw.data = self.mat * w
+        first = True
+
+        while True:
+            # (w,d) and (w,A*w) in one reduction
+            ip = W.InnerProduct(Y, conjugate=conjugate)
+            gamma, delta = ip[0,0], ip[1,0]
+            if self.CheckResidual(sqrt(abs(gamma))):
+                return
+            m.data = self.pre * aw
+            am.data = self.mat * m
+
+            if first:
+                if delta == 0: break
+                alpha = gamma / delta
+                z.data = am
+                q.data = m
+                s.data = aw
+                p.data = w
+                first = False
+            else:
+                beta = gamma / gamma_old
+                den = delta - beta * gamma / alpha
+                if den == 0: break
+                alpha = gamma / den
+                z *= beta
+                z.data += am
+                q *= beta
+                q.data += m
+                s *= beta
+                s.data += aw
+                p *= beta
+                p.data += w
+
+            sol.data += alpha * p
+            d.data -= alpha * s
+            w.data -= alpha * q
+            aw.data -= alpha * z
+            gamma_old = gamma
+
         
 def CG(mat, rhs, pre=None, sol=None, tol=1e-12, maxsteps = 100, printrates = True, plotrates = False, initialize = True, conjugate=False, callback=None, **kwargs):
     """preconditioned conjugate gradient method
@@ -293,6 +350,81 @@ def CG(mat, rhs, pre=None, sol=None, tol=1e-12, maxsteps = 100, printrates = Tru
     return solver.sol
 
 
+class SStepCGSolver(LinearSolver):
+    """Communication avoiding (s-step) preconditioned conjugate gradient method.
+
+In every outer step the monomial basis [w, (pre*A) w, ..., (pre*A)^(s-1) w]
+with w = pre*r of the preconditioned Krylov space is built by s matrix-vector
+products without any inner products in between. All inner products of the step are then computed
+by one block reduction of the Gram matrix (one allreduce for parallel vectors
+instead of 2s). Search directions are kept A-orthogonal block-wise
+(Chronopoulos-Gear). Iterations and maxiter count outer steps, i.e. blocks of
+s cg steps.
+
+    Parameters
+    ----------
+
+""" + linear_solver_param_doc + """
+
+s : int = 4
+  Number of cg steps per outer step. The monomial basis gets ill-conditioned
+  for large s, values between 2 and 6 are recommended.
+
+conjugate : bool = False
+  If set to True, then the complex inner product is used, else a pseudo inner product that makes CG work with complex symmetric matrices.
+"""
+    name = "SStepCG"
+
+    def __init__(self, *args, s : int = 4, conjugate : bool = False, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.s = s
+        self.conjugate = conjugate
+
+    def _SolveImpl(self, rhs : BaseVector, sol : BaseVector):
+        A, pre, s, conjugate = self.mat, self.pre, self.s, self.conjugate
+        adj = (lambda m: m.H) if conjugate else (lambda m: m.T)
+        V = MultiVector(rhs, s)          # basis of preconditioned Krylov space
+        P = MultiVector(rhs, s)          # A-orthogonal search directions
+        Y = MultiVector(rhs, 2*s+1)      # [A*P | A*V | r]
+        T = MultiVector(rhs, s)
+        r = Y[2*s]
+        r.data = rhs - A * sol
+        Wold = None
+
+        while True:
+            # matrix powers kernel
+            V[0].data = pre * r
+            for i in range(s):
+                Y[s+i].data = A * V[i]
+                if i+1 < s:
+                    V[i+1].data = pre * Y[s+i]
+
+            # single block reduction: V^H [A*P | A*V | r]
+            M = adj(V.InnerProduct(Y, conjugate=conjugate))
+            if self.CheckResidual(sqrt(abs(M[0,2*s]))):
+                return
+
+            G = M[:,s:2*s]
+            g = M[:,2*s]
+            if Wold is None:
+                P[:] = V
+                Y[0:s] = Y[s:2*s]
+                W = G
+            else:
+                C = adj(M[:,0:s])
+                B = Wold.I * C
+                W = G - adj(C) * B
+                T[:] = P * B
+                P[:] = V - T
+                T[:] = Y[0:s] * B
+                Y[0:s] = Y[s:2*s] - T
+
+            alpha = W.I * g
+            sol.data += P * alpha
+            r.data -= Y[0:s] * alpha
+            Wold = W
+
+
 
 
 
@@ -1100,6 +1232,148 @@ printrates : bool = True
     return solver.Solve(rhs=b, sol=x)
 
 
+def _CholeskyUpper(S, is_complex):
+    """Upper triangular R with R^H R = S. Stops at the first pivot which is
+not positive relative to the diagonal of S, returns R and the number of
+computed rows."""
+    n = S.h
+    R = Matrix(n, n, is_complex)
+    R[:] = 0
+    for j in range(n):
+        d = S[j,j].real - sum(abs(R[k,j])**2 for k in range(j))
+        if d <= 1e-14 * abs(S[j,j]):
+            return R, j
+        R[j,j] = sqrt(d)
+        for i in range(j+1, n):
+            R[j,i] = (S[j,i] - sum(R[k,j].conjugate() * R[k,i] for k in range(j))) / R[j,j]
+    return R, n
+
+
+class SStepGMResSolver(LinearSolver):
+    """Communication avoiding (s-step) preconditioned GMRes solver. Minimizes the preconditioned residuum pre * (b-A*x).
+
+The Krylov space is extended by blocks of s vectors computed by s
+matrix-vector products in a row. Each block is orthonormalized against the
+previous ones by block classical Gram-Schmidt with Cholesky-QR, where all
+inner products of one pass are computed by a single block reduction of the
+Gram matrix. Two passes are done per block, so there are 2 global reductions
+per s iterations instead of about k+2 in iteration k of GMRes. The residual
+norm of the current iterate is tracked per iteration, the solution is only
+formed at the end.
+
+Parameters
+----------
+
+""" + linear_solver_param_doc + """
+
+s : int = 4
+  Number of Krylov vectors per block.
+
+restart : int = None
+  If given, the method is restarted with the current solution every 'restart' iterations
+  (rounded up to a multiple of s).
+"""
+    name = "SStepGMRes"
+
+    def __init__(self, *args, s : int = 4, restart : Optional[int] = None, **kwargs):
+        super().__init__(*args, **kwargs)
+        self.s = s
+        self.restart = restart
+
+    def _SolveImpl(self, rhs : BaseVector, sol : BaseVector):
+        first = True
+        while not self._Cycle(rhs, sol, first):
+            first = False
+
+    def _Orthogonalize(self, V, T, c0, k):
+        # V = [Q | W | rho] with c0 orthonormal vectors Q, k new vectors W
+        # starting at c0 and the current residual rho at c0+s.
+        # Orthonormalizes W in place, one block reduction.
+        s, is_complex = self.s, V[0].is_complex
+        M = V[0:c0+s+1].InnerProduct(V[c0:c0+s+1]).H
+        S = M[c0:c0+k,0:k]
+        wr = M[c0:c0+k,s]
+        rr = M[c0+s,s].real
+        if c0 > 0:
+            C = M[0:c0,0:k]
+            S = S - C.H * C
+            T[0:k] = V[c0:c0+k] - V[0:c0] * C
+        else:
+            C = None
+            T[0:k] = V[c0:c0+k]
+        R, rank = _CholeskyUpper(S, is_complex)
+        if rank == 0:
+            return C, R, 0, None, rr
+        Rinv = R[0:rank,0:rank].I
+        V[c0:c0+rank] = T[0:rank] * Rinv
+        return C, R, rank, Rinv.H * wr[0:rank], rr
+
+    def _Cycle(self, rhs : BaseVector, sol : BaseVector, first : bool):
+        A, pre, s = self.mat, self.pre, self.s
+        is_complex = rhs.is_complex
+        m = self.maxiter if self.restart is None else min(self.restart, self.maxiter)
+        tmp = rhs.CreateVector()
+        tmp.data = rhs - A * sol
+        V = MultiVector(rhs, s+1)         # [Q | W | rho]
+        V[s].data = pre * tmp
+        beta = Norm(V[s])
+        if first and self.CheckResidual(beta):
+            return True
+        if beta == 0:
+            return True
+        Z = MultiVector(rhs, 1)           # non-orthogonal Krylov basis
+        Z[0].data = 1./beta * V[s]
+        T = MultiVector(rhs, s)
+        R = Matrix(m+s, m+s, is_complex)  # W = Q R
+        R[:] = 0
+        g = Vector(m+s, is_complex)       # g = Q^H pre * (b-A*x)
+        c0 = 0
+        converged = False
+        while True:
+            if c0 > 0:
+                Z.Append(V[c0-1])
+            # matrix powers kernel
+            for j in range(s):
+                tmp.data = A * Z[c0+j]
+                V[c0+j].data = pre * tmp
+                if j+1 < s:
+                    Z.Append(V[c0+j])
+
+            C1, R1, k, _, _ = self._Orthogonalize(V, T, c0, s)
+            if k == 0:
+                converged = True
+                break
+            C2, R2, k, gk, rr = self._Orthogonalize(V, T, c0, k)
+            if k == 0:
+                converged = True
+                break
+            # W = Q C1 + Q1 R1,  Q1 = Q C2 + Q2 R2
+            R1 = R1[0:k,0:k]
+            if c0 > 0:
+                R[0:c0,c0:c0+k] = C1[:,0:k] + C2[:,0:k] * R1
+            R[c0:c0+k,c0:c0+k] = R2[0:k,0:k] * R1
+            g[c0:c0+k] = gk
+
+            res2 = rr
+            for j in range(k):
+                res2 -= abs(gk[j])**2
+                if self.CheckResidual(sqrt(max(res2, 0))):
+                    k = j+1
+                    converged = True
+                    break
+            if converged or k < s or c0+k >= m:
+                c0 += k
+                break
+
+            V.Extend(s)
+            V[c0+k+s].data = V[c0+s] - V[c0:c0+k] * gk
+            c0 += k
+
+        y = R[0:c0,0:c0].I * g[0:c0]
+        sol.data += Z[0:c0] * y
+        return converged or self.iterations >= self.maxiter
+
+
 
 
 from ngsolve.la import EigenValues_Preconditioner
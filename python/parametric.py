@@ -0,0 +1,56 @@
+
+import ngsolve as ngs
+from typing import Sequence, Union
+
+class ParametricBilinearForm:
+    """
+    Bilinear form  sum_k p_k a_k(u,v)  affine in the parameter values p_k,
+    e.g. A(omega) = K + i omega C - omega^2 M with components [K, C, M]
+    and values [1, 1j*omega, -omega**2].
+
+    All components live in one BilinearForm with one matrix graph. The
+    components are assembled once, for new parameter values the matrix is
+    combined from the stored component values in one pass over the
+    non-zero entries.
+
+    Parameters:
+
+    space : ngsolve.FESpace
+      trial- and test-space of all components
+
+    components : list of ngsolve.comp.SumOfIntegrals
+      the affine components a_k
+
+    kwargs :
+      flags for the BilinearForm
+    """
+    def __init__(self,
+                 space: ngs.FESpace,
+                 components: Sequence[ngs.comp.SumOfIntegrals],
+                 **kwargs):
+        self.space = space
+        pcls = ngs.ParameterC if space.is_complex else ngs.Parameter
+        self.parameters = [pcls(0) for comp in components]
+        self.bf = ngs.BilinearForm(space, affine_parameters=True, **kwargs)
+        for p, comp in zip(self.parameters, components):
+            self.bf += p * comp
+
+    def SetValues(self, values: Sequence[Union[float, complex]]):
+        if len(values) != len(self.parameters):
+            raise Exception("ParametricBilinearForm: expected " + str(len(self.parameters)) +
+                            " values, got " + str(len(values)))
+        for p, val in zip(self.parameters, values):
+            p.Set(val)
+
+    def Assemble(self, values: Sequence[Union[float, complex]]) -> ngs.BaseMatrix:
+        """
+        Set the parameter values and return the combined matrix. The first
+        call assembles the components, further calls only combine them.
+        """
+        self.SetValues(values)
+        self.bf.Assemble()
+        return self.bf.mat
+
+    @property
+    def mat(self) -> ngs.BaseMatrix:
+        return self.bf.mat
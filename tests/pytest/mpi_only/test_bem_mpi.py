@@ -0,0 +1,41 @@
+import pytest
+from ngsolve import *
+from ngsolve.bem import *
+from netgen.csg import unit_cube
+from pyngcore import MPI_Comm
+import mpi4py.MPI as mpi
+
+
+def bem_energies(mesh):
+    fes = SurfaceL2(mesh, order=0, dual_mapping=True)
+    fesH1 = H1(mesh, order=1, definedon=mesh.Boundaries(".*"))
+    u,v = fes.TnT()
+    uH1 = fesH1.TrialFunction()
+    V = LaplaceSL(u*ds)*v*ds
+    K = LaplaceDL(uH1*ds)*v*ds
+
+    gf = GridFunction(fes)
+    gf.Set(1+x*y+z, definedon=mesh.Boundaries(".*"))
+    gfH1 = GridFunction(fesH1)
+    gfH1.Set(x*x-y+2*z, definedon=mesh.Boundaries(".*"))
+    return [InnerProduct(gf.vec, (V.mat*gf.vec).Evaluate()),
+            InnerProduct(gf.vec, (V.mat.T*gf.vec).Evaluate()),
+            InnerProduct(gf.vec, (K.mat*gfH1.vec).Evaluate()),
+            InnerProduct(gfH1.vec, (K.mat.T*gf.vec).Evaluate())]
+
+# distributed FMM against the sequential operator
+def test_laplace_distributed():
+    comm = MPI_Comm(mpi.COMM_WORLD)
+    if comm.rank == 0:
+        unit_cube.GenerateMesh(maxh=0.2).Save("bem_cube.vol.gz")
+    comm.Barrier()
+
+    energies_seq = bem_energies(Mesh("bem_cube.vol.gz"))
+    mesh = Mesh("bem_cube.vol.gz", comm)
+    assert mesh.comm.size == comm.size
+    energies = bem_energies(mesh)
+
+    # element pairs touching across processes get their singular corrections
+    # from the ghost nearfield, the difference is the accuracy of the fmm
+    assert energies == pytest.approx(energies_seq, rel=1e-6)
+    comm.Barrier()
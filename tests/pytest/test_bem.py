@@ -58,3 +58,127 @@ def test_singularmltransform():
     val2 = S(mesh(1,1,4))
 
     assert val1 == pytest.approx(val2)
+
+
+def test_singularml_resetsources():
+    box = Box((-10,-10,-10), (10,10,10))
+    mesh = Mesh(OCCGeometry(box).GenerateMesh(maxh=5))
+
+    kappa = 0.01
+    num = 200
+    def charges(S, fac):
+        for i in range(num):
+            z = i/num
+            S.expansion.AddCharge((0.1, 0.2*z, z), fac*(1+z)/num)
+
+    S = SingularMLExpansionCF((0,0,0), r=1, kappa=kappa)
+    charges(S, 1)
+    S.expansion.Calc()
+    val1 = S(mesh(1,1,4))
+
+    # same tree, new charges
+    S.expansion.ResetSources()
+    charges(S, 3)
+    S.expansion.Calc()
+    val3 = S(mesh(1,1,4))
+
+    Sref = SingularMLExpansionCF((0,0,0), r=1, kappa=kappa)
+    charges(Sref, 3)
+    Sref.expansion.Calc()
+
+    assert val3 == pytest.approx(3*val1)
+    assert val3 == pytest.approx(Sref(mesh(1,1,4)))
+
+
+def test_fmm_repeated_mult():
+    sp = Sphere((0,0,0), 1)
+    mesh = Mesh(OCCGeometry(sp).GenerateMesh(maxh=0.2))
+    fesH1 = H1(mesh, order=1, definedon=mesh.Boundaries(".*"))
+    fesL2 = SurfaceL2(mesh, order=0, dual_mapping=True)
+    u = fesH1.TrialFunction()
+    v = fesL2.TestFunction()
+
+    # the double layer operator is not symmetric, MultTrans uses its own trees
+    Kfmm = LaplaceDL(u*ds, use_fmm=True)*v*ds
+    Kdense = LaplaceDL(u*ds, use_fmm=False)*v*ds
+
+    gfu = GridFunction(fesH1)
+    gfv = GridFunction(fesL2)
+    funcs = [1+x*y+z, x*x-y, sin(3*z)+x]
+    for i in range(2):
+        for f in funcs:
+            gfu.Set(f, definedon=mesh.Boundaries(".*"))
+            gfv.Set(f, definedon=mesh.Boundaries(".*"))
+            # trees and translations of the first application are reused
+            Kfresh = LaplaceDL(u*ds, use_fmm=True)*v*ds
+            y = (Kfmm.mat * gfu.vec).Evaluate()
+            yfresh = (Kfresh.mat * gfu.vec).Evaluate()
+            ydense = (Kdense.mat * gfu.vec).Evaluate()
+            assert Norm(y-yfresh) < 1e-10 * Norm(yfresh)
+            assert Norm(y-ydense) < 1e-4 * Norm(ydense)
+
+            yt = (Kfmm.mat.T * gfv.vec).Evaluate()
+            ytfresh = (Kfresh.mat.T * gfv.vec).Evaluate()
+            ytdense = (Kdense.mat.T * gfv.vec).Evaluate()
+            assert Norm(yt-ytfresh) < 1e-10 * Norm(ytfresh)
+            assert Norm(yt-ytdense) < 1e-4 * Norm(ytdense)
+
+
+def test_hmatrix_laplace():
+    sp = Sphere((0,0,0), 1)
+    mesh = Mesh(OCCGeometry(sp).GenerateMesh(maxh=0.3))
+    fes = SurfaceL2(mesh, order=0, dual_mapping=True)
+    u,v = fes.TnT()
+
+    Vdense = LaplaceSL(u*ds, use_fmm=False)*v*ds
+    Vhmat = LaplaceSL(u*ds, use_hmatrix=True, hmatrix_eps=1e-8, hmatrix_leafsize=16)*v*ds
+
+    gf = GridFunction(fes)
+    gf.Set(1+x*y+z, definedon=mesh.Boundaries(".*"))
+    y1 = (Vdense.mat * gf.vec).Evaluate()
+    y2 = (Vhmat.mat * gf.vec).Evaluate()
+    y2 -= y1
+    assert Norm(y2) < 1e-6 * Norm(y1)
+
+
+@pytest.mark.parametrize("compression", [{"use_fmm" : False},
+                                         {"use_fmm" : True},
+                                         {"use_hmatrix" : True}])
+def test_hlu_laplace(compression):
+    sp = Sphere((0,0,0), 1)
+    mesh = Mesh(OCCGeometry(sp).GenerateMesh(maxh=0.3))
+    fes = SurfaceL2(mesh, order=0, dual_mapping=True)
+    u,v = fes.TnT()
+    gf = GridFunction(fes)
+    gf.Set(1+x*y+z, definedon=mesh.Boundaries(".*"))
+
+    # with compression the far field entries are gathered from point evaluations,
+    # the H-LU approximates the dense matrix, not the compressed operator
+    V = LaplaceSL(u*ds, hmatrix_leafsize=16, **compression)*v*ds
+    Vdense = LaplaceSL(u*ds, use_fmm=False)*v*ds
+    rhs = (Vdense.mat * gf.vec).Evaluate()
+    for cholesky in [False, True]:
+        inv = V.CreateHLU(eps=1e-8, cholesky=cholesky)
+        sol = (inv * rhs).Evaluate()
+        sol -= gf.vec
+        assert Norm(sol) < 1e-5 * Norm(gf.vec)
+
+    # on flat panels the piecewise constant double layer matrix has a zero
+    # diagonal, the factorizations do not pivot
+    K = LaplaceDL(u*ds, hmatrix_leafsize=16, **compression)*v*ds
+    for cholesky in [False, True]:
+        with pytest.raises(Exception, match="pivot"):
+            K.CreateHLU(eps=1e-8, cholesky=cholesky)
+
+    # the double layer operator is not symmetric
+    fesh1 = H1(mesh, order=1, definedon=mesh.Boundaries(".*"))
+    u,v = fesh1.TnT()
+    gf = GridFunction(fesh1)
+    gf.Set(1+x*y+z, definedon=mesh.Boundaries(".*"))
+    K = LaplaceDL(u*ds, hmatrix_leafsize=16, **compression)*v*ds
+    Kdense = LaplaceDL(u*ds, use_fmm=False)*v*ds
+    rhs = (Kdense.mat * gf.vec).Evaluate()
+    inv = K.CreateHLU(eps=1e-8, cholesky=False)
+    sol = (inv * rhs).Evaluate()
+    sol -= gf.vec
+    assert Norm(sol) < 1e-4 * Norm(gf.vec)
@@ -96,6 +96,57 @@ def test_code_generation_derivatives_2d(unit_mesh_2d):
     a += InnerProduct(Grad(u), Grad(v)).Compile(realcompile=True, wait=True, keep_files=True) * dx
     a.Assemble()
 
+def test_code_generation_cache(unit_mesh_2d, tmp_path, monkeypatch):
+    monkeypatch.setenv("NGSOLVE_JIT_CACHE_DIR", str(tmp_path))
+    cf = x*x+sin(y)
+    cf1 = cf.Compile(realcompile=True, wait=True)
+    libs = list(tmp_path.glob("*.so"))
+    assert len(libs) == 1
+    inode = libs[0].stat().st_ino
+
+    # same code: the library is loaded from the cache, not compiled again
+    cf2 = cf.Compile(realcompile=True, wait=True)
+    assert list(tmp_path.glob("*.so")) == libs
+    assert libs[0].stat().st_ino == inode
+    assert not list(tmp_path.glob("*.lock"))
+
+    mip = unit_mesh_2d(0.3, 0.2)
+    assert cf1(mip) == approx(cf(mip))
+    assert cf2(mip) == approx(cf(mip))
+
+    # code with the address of a parameter is valid only in this process
+    par = Parameter(2)
+    cf3 = (par*x).Compile(realcompile=True, wait=True)
+    assert list(tmp_path.glob("*.so")) == libs
+    assert cf3(mip) == approx(0.6)
+
+def test_code_generation_cache_size(tmp_path, monkeypatch):
+    import os, time
+    monkeypatch.setenv("NGSOLVE_JIT_CACHE_DIR", str(tmp_path))
+    monkeypatch.setenv("NGSOLVE_JIT_CACHE_SIZE", "0")
+    # files not named like cache entries are never removed
+    old = time.time() - 3*24*3600
+    for name in ["mylib.so", "notes.txt", "0123456789abcdef.lock"]:
+        (tmp_path / name).write_text("x")
+        os.utime(tmp_path / name, (old, old))
+    (x*y).Compile(realcompile=True, wait=True)
+    # the cache is trimmed after installing a library
+    assert sorted(f.name for f in tmp_path.iterdir()) == ["mylib.so", "notes.txt"]
+
+def test_code_generation_cache_readonly(unit_mesh_2d, tmp_path, monkeypatch):
+    import os
+    if os.geteuid() == 0:
+        pytest.skip("root ignores file permissions")
+    monkeypatch.setenv("NGSOLVE_JIT_CACHE_DIR", str(tmp_path))
+    tmp_path.chmod(0o555)
+    try:
+        # the library is compiled without the cache
+        cf = (x+2*y).Compile(realcompile=True, wait=True)
+        assert cf(unit_mesh_2d(0.3, 0.2)) == approx(0.7)
+        assert not list(tmp_path.iterdir())
+    finally:
+        tmp_path.chmod(0o755)
+
 def test_code_generation_python_module(unit_mesh_3d):
     from ngsolve.fem import CompilePythonModule
 
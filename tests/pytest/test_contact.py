@@ -90,6 +90,30 @@ def test_calclinearized(mesh, space, space_args):
     d.data = a.mat * w.vec
     assert (InnerProduct(vr, w.vec)-InnerProduct(vl, w.vec))/2/eps == pytest.approx(InnerProduct(d, w.vec), rel=1e-10)
 
+@pytest.mark.parametrize("space, space_args", tested_spaces)
+def test_update_special_elements(mesh, space, space_args):
+    import numpy as np
+    fes = space(mesh, **space_args)
+    cb, a, u = GetForms(fes)
+    nze = 0
+    # the repeated step has the same pairs, the graph is kept
+    for yval, maxdist, same_pairs in [(-3.1, 2, False), (-3.1, 2, True),
+                                      (-3.05, 1, False), (-3.2, 2, False)]:
+        SetY(u, yval)
+        cb.Update(u, a, 4, maxdist)
+        a.AssembleLinearization(u.vec)
+        if same_pairs:
+            assert a.mat.nze == nze
+        nze = a.mat.nze
+        cbref, aref, _ = GetForms(fes)
+        cbref.Update(u, aref, 4, maxdist)
+        aref.AssembleLinearization(u.vec)
+        # a kept graph may have more entries, the extra ones are zero
+        assert a.mat.nze >= aref.mat.nze
+        A = a.mat.ToDense().NumPy()
+        Aref = aref.mat.ToDense().NumPy()
+        assert np.linalg.norm(A-Aref) <= 1e-12 * np.linalg.norm(Aref)
+
 def test_gapfunction():
     geo = CSGeometry()
     r = 0.01
@@ -99,7 +99,249 @@ def test_sparsematrix_access():
     a.Assemble()
     assert abs(a.mat[1,1][0,0] - (reference_values[3])) < 1e-8
 
+def test_sparsematrix_sell():
+    from ngsolve.la import SparseMatrixSELL
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = L2(mesh, order=3, dgjumps=True)
+    u,v = fes.TnT()
+    a = BilinearForm(fes)
+    a += u*v*dx + (u-u.Other())*(v-v.Other())*dx(skeleton=True)
+    a.Assemble()
+    # boundary elements have fewer neighbours, so chunks need padding
+    rowlen = np.diff(np.array(a.mat.CSR()[2]))
+    C = 8
+    def expected_fillratio(sigma):
+        sigma = max(C, sigma // C * C)
+        lens = np.zeros((len(rowlen)+C-1)//C*C, dtype=int)
+        for w in range(0, len(rowlen), sigma):
+            lens[w:w+sigma] = -np.sort(-rowlen[w:w+sigma])
+        stored = C * lens.reshape(-1, C).max(axis=1).sum()
+        return rowlen.sum() / stored
+
+    x = a.mat.CreateColVector()
+    x.FV().NumPy()[:] = np.random.rand(len(x))
+    y = a.mat.CreateColVector()
+    for sigma in [1, 32, 1024]:
+        sell = SparseMatrixSELL(a.mat, sigma=sigma)
+        assert sell.fillratio == pytest.approx(expected_fillratio(sigma), rel=1e-14)
+        assert sell.fillratio < 1
+        y.data = a.mat * x
+        y.data -= sell * x
+        assert Norm(y) < 1e-12 * Norm(x)
+    # sorting within larger windows never adds padding
+    assert expected_fillratio(1024) >= expected_fillratio(1)
+
+def _assert_same_entries(ref, mat, tol=1e-12):
+    d = ref.AsVector().CreateVector()
+    d.data = ref.AsVector() - mat.AsVector()
+    assert Norm(d) <= tol * Norm(ref.AsVector())
+
+def test_element_batch():
+    from netgen.occ import Circle, OCCGeometry
+    cube = Mesh(unit_cube.GenerateMesh(maxh=0.4))
+    disk = Mesh(OCCGeometry(Circle((0,0),1).Face(), dim=2).GenerateMesh(maxh=0.3))
+    disk.Curve(3)
+    c = Parameter(2)
+    for mesh in [cube, disk]:
+        gf = GridFunction(H1(mesh, order=1))
+        gf.Set(1+x*y)
+        # several element classes and orders in one region
+        mixed = H1(mesh, order=2)
+        for i in range(0, mesh.ne, 3):
+            mixed.SetOrder(ElementId(VOL, i), 3)
+        mixed.Update()
+        for fes, D in [(H1(mesh, order=1), grad), (H1(mesh, order=2), grad),
+                       (mixed, grad), (HCurl(mesh, order=1), curl)]:
+            u,v = fes.TnT()
+            # the GridFunction coefficient is not batched
+            for coef in [c*(1+x*y), gf]:
+                form = coef*InnerProduct(D(u),D(v))*dx + (1+x)*InnerProduct(u,v)*dx
+                a = BilinearForm(form).Assemble()
+                ab = BilinearForm(form, element_batch=True).Assemble()
+                _assert_same_entries(a.mat, ab.mat)
+
+def _condensation_problems(mesh):
+    # several batches: varying inner orders, a vector space, and HDG
+    h1 = H1(mesh, order=3, dirichlet=".*")
+    for i in range(0, mesh.ne, 3):
+        h1.SetOrder(ElementId(VOL, i), 4)
+    h1.Update()
+    u,v = h1.TnT()
+    yield h1, grad(u)*grad(v)*dx + (1+z)*u*v*dx, x*v*dx
+    vh1 = VectorH1(mesh, order=3, dirichlet=".*")
+    u,v = vh1.TnT()
+    yield vh1, InnerProduct(Sym(grad(u)),Sym(grad(v)))*dx + div(u)*div(v)*dx, v[2]*dx
+    order = 2
+    fes = L2(mesh, order=order) * FacetFESpace(mesh, order=order, dirichlet=".*")
+    (u,uhat), (v,vhat) = fes.TnT()
+    n = specialcf.normal(3)
+    h = specialcf.mesh_size
+    dS = dx(element_boundary=True)
+    yield fes, grad(u)*grad(v)*dx + (1+x)*u*v*dx \
+        - n*grad(u)*(v-vhat)*dS - n*grad(v)*(u-uhat)*dS + 10*order**2/h*(u-uhat)*(v-vhat)*dS, \
+        x*v*dx
+
+def test_batch_condense():
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.4))
+    for fes, form, rhs in _condensation_problems(mesh):
+        a = BilinearForm(form, condense=True).Assemble()
+        ab = BilinearForm(form, condense=True, batch_condense=True).Assemble()
+        _assert_same_entries(a.mat, ab.mat, 1e-10)
+
+        # solve with the batched condensation matrices, compare with the full system
+        f = LinearForm(rhs).Assemble()
+        afull = BilinearForm(form).Assemble()
+        ufull = GridFunction(fes)
+        ufull.vec.data = afull.mat.Inverse(fes.FreeDofs()) * f.vec
+        u = GridFunction(fes)
+        f.vec.data += ab.harmonic_extension_trans * f.vec
+        u.vec.data = ab.mat.Inverse(fes.FreeDofs(True)) * f.vec
+        u.vec.data += ab.harmonic_extension * u.vec
+        u.vec.data += ab.inner_solve * f.vec
+        u.vec.data -= ufull.vec
+        assert Norm(u.vec) < 1e-8 * Norm(ufull.vec)
+
+def _assert_same_dense(ref, mat, tol=1e-12):
+    A = ref.ToDense().NumPy()
+    B = mat.ToDense().NumPy()
+    assert np.linalg.norm(A-B) <= tol * np.linalg.norm(A)
+
+def test_atomic_assembly():
+    # the uncoloured loop only runs concurrently inside the TaskManager
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.4))
+    h1 = H1(mesh, order=3, complex=True)
+    u,v = h1.TnT()
+    # DG couples neighbours through facet terms, colours are small
+    l2 = L2(mesh, order=2, dgjumps=True)
+    p,q = l2.TnT()
+    n = specialcf.normal(3)
+    forms = [(1+x)*grad(u)*grad(v)*dx + 1j*u*v*ds,
+             p*q*dx + (p-p.Other())*(q-q.Other())*dx(skeleton=True)
+             + (n*grad(p))*q*dx(element_boundary=True)]
+    with TaskManager():
+        for form in forms:
+            a = BilinearForm(form).Assemble()
+            aa = BilinearForm(form, atomic_assembly=True).Assemble()
+            _assert_same_entries(a.mat, aa.mat)
+        # condensation matrices are stored per element
+        a = BilinearForm(forms[0], condense=True).Assemble()
+        aa = BilinearForm(forms[0], condense=True, atomic_assembly=True).Assemble()
+        _assert_same_entries(a.mat, aa.mat)
+        for ma, mb in [(a.harmonic_extension, aa.harmonic_extension),
+                       (a.inner_solve, aa.inner_solve)]:
+            _assert_same_dense(ma, mb)
+
+@pytest.mark.parametrize("storage", [{"diagonal" : True}, {"ebe" : True}])
+@pytest.mark.parametrize("is_complex", [False, True])
+def test_atomic_assembly_storage(storage, is_complex):
+    # storage without atomic add keeps the coloured loop
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.4))
+    fes = H1(mesh, order=2, complex=is_complex)
+    u,v = fes.TnT()
+    form = (1+x)*grad(u)*grad(v)*dx + u*v*dx + u*v*ds
+    with TaskManager():
+        a = BilinearForm(form, **storage).Assemble()
+        aa = BilinearForm(form, atomic_assembly=True, **storage).Assemble()
+    _assert_same_dense(a.mat, aa.mat)
+
+def test_atomic_assembly_dynblocks():
+    # dim > MAX_SYS_DIM assembles into a SparseBlockMatrix
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.4))
+    fes = H1(mesh, order=2, dim=5)
+    u,v = fes.TnT()
+    form = (1+x)*InnerProduct(grad(u),grad(v))*dx + u[0]*v[4]*dx
+    with TaskManager():
+        a = BilinearForm(form).Assemble()
+        aa = BilinearForm(form, atomic_assembly=True).Assemble()
+    _assert_same_entries(a.mat, aa.mat)
+
+def _timer_count(name):
+    return sum(t["counts"] for t in Timers() if t["name"] == name)
+
+def test_affine_parameters():
+    mesh = Mesh(unit_cube.GenerateMesh(maxh=0.4))
+    dt = Parameter(0.1)
+    kappa = Parameter(1)
+    u,v = H1(mesh, order=2).TnT()
+    affine = u*v*dx + dt*(1+x*y)*grad(u)*grad(v)*dx + kappa*u*v*ds
+    # not affine, the second one only piecewise around dt=0.15
+    nonaffine = [u*v*dx + dt*kappa*grad(u)*grad(v)*dx,
+                 u*v*dx + IfPos(dt-0.15, 1, dt)*grad(u)*grad(v)*dx]
+    for form in [affine] + nonaffine:
+        dt.Set(0.1)
+        kappa.Set(1)
+        a = BilinearForm(form, affine_parameters=True).Assemble()
+        for dtval, kval in [(0.2, 3), (-0.5, 0.1), (0.1, 2)]:
+            dt.Set(dtval)
+            kappa.Set(kval)
+            nassemble = _timer_count("Matrix assembling")
+            a.Assemble()
+            # reassembling the affine form combines the stored terms only
+            assert (_timer_count("Matrix assembling") == nassemble) == (form is affine)
+            ref = BilinearForm(form).Assemble()
+            _assert_same_entries(ref.mat, a.mat, 1e-10)
+
+def test_parametric_bilinearform():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=2, complex=True)
+    u,v = fes.TnT()
+    K = grad(u)*grad(v)*dx
+    C = u*v*ds
+    M = (1+x)*u*v*dx
+    a = ParametricBilinearForm(fes, [K, C, M])
+    mat = a.Assemble([1, 0, 0])
+    nze = mat.nze
+    for omega in [1, 2.5, 40]:
+        nassemble = _timer_count("Matrix assembling")
+        aw = a.Assemble([1, 1j*omega, -omega**2])
+        # one graph, the components are not integrated again
+        assert _timer_count("Matrix assembling") == nassemble
+        assert aw.nze == nze
+        ref = BilinearForm(K + 1j*omega*C - omega**2*M).Assemble()
+        _assert_same_entries(ref.mat, aw)
+
+def test_sumfactorization_tp():
+    # unstructured quads, and curved hexes with non-affine geometry
+    quadmesh = Mesh(unit_square.GenerateMesh(maxh=0.3, quad_dominated=True))
+    hexmesh = MakeStructured3DMesh(nx=2, ny=3, nz=2,
+                                   mapping=lambda x,y,z: (x+0.2*y*z, y+0.1*x*x, z+0.15*x*y))
+    for mesh in [MakeStructured2DMesh(nx=3, ny=3), MakeStructured3DMesh(nx=2, ny=2, nz=2),
+                 quadmesh, hexmesh]:
+        for fes, festp in [(H1(mesh, order=4), H1(mesh, order=4, tp=True)),
+                           (L2(mesh, order=3), L2(mesh, order=3, tp=True))]:
+            u,v = fes.TnT()
+            utp,vtp = festp.TnT()
+            a = BilinearForm(grad(u)*grad(v)*dx + u*v*dx).Assemble()
+            atp = BilinearForm(grad(utp)*grad(vtp)*dx + utp*vtp*dx, nonassemble=True).Assemble()
+            ngrad = _timer_count("H1TP EvaluateGrad")
+            _assert_same_dense(a.mat, atp.mat, 1e-10)
+            # the H1 elements of uniform order take the sum-factorized kernels
+            if fes.type == "h1ho":
+                assert _timer_count("H1TP EvaluateGrad") >= ngrad + mesh.ne
+
+def test_nonassemble_curved():
+    from netgen.occ import Circle, OCCGeometry
+    mesh = Mesh(OCCGeometry(Circle((0,0),1).Face(), dim=2).GenerateMesh(maxh=0.3))
+    mesh.Curve(4)
+    fes = H1(mesh, order=4)
+    u,v = fes.TnT()
+    form = (1+x*x)*grad(u)*grad(v)*dx + exp(y)*u*v*dx + u*v*ds
+    a = BilinearForm(form).Assemble()
+    with TaskManager():
+        for precompute in [False, True]:
+            amf = BilinearForm(form, nonassemble=True, precompute=precompute).Assemble()
+            _assert_same_dense(a.mat, amf.mat, 1e-10)
+
+    # the points are stored only if the integrand depends on them
+    mem = []
+    for f in [grad(u)*grad(v)*dx + u*v*dx, form]:
+        amf = BilinearForm(f, nonassemble=True, precompute=True).Assemble()
+        mem.append(sum(nbytes for name, nbytes, nblocks in amf.__memory__
+                       if name.startswith("precomputed element data")))
+    assert 0 < mem[0] < mem[1]
+
 if __name__ == "__main__":
     test_matrix()
     test_matrix_numpy()
     test_sparsematrix_access()
+    test_sparsematrix_sell()
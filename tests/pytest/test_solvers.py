@@ -1,5 +1,6 @@
 from netgen.geom2d import unit_square
 from ngsolve import *
+import ngsolve
 import pytest
 from ngsolve.krylovspace import *
 
@@ -76,6 +77,132 @@ def test_krylovspace_solvers():
         # p4 should be exact
         assert error < 1e-12
 
+def test_pipelined_cg():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=4, dirichlet=".*")
+    u,v = fes.TnT()
+    f = LinearForm(32 * (y*(1-y)+x*(1-x)) * v * dx).Assemble()
+    a = BilinearForm(grad(u)*grad(v)*dx)
+    c = Preconditioner(a, type="bddc")
+    a.Assemble()
+    u = GridFunction(fes)
+    exact = 16*x*(1-x)*y*(1-y)
+    for inv in [CGSolver(mat=a.mat, pre=c, pipelined=True),
+                ngsolve.la.CGSolver(mat=a.mat, pre=c.mat, pipelined=True,
+                                    precision=1e-12, printrates=False)]:
+        u.vec.data = inv * f.vec
+        error = sqrt(Integrate((u-exact)*(u-exact), mesh))
+        assert error < 1e-10
+
+@pytest.mark.parametrize("solver", [SStepCGSolver, SStepGMResSolver])
+@pytest.mark.parametrize("s", [1, 3, 5])
+def test_sstep_krylovspace_solvers(solver, s):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.2))
+    fes = H1(mesh, order=4, dirichlet=".*")
+    u,v = fes.TnT()
+    f = LinearForm(32 * (y*(1-y)+x*(1-x)) * v * dx).Assemble()
+    a = BilinearForm(grad(u)*grad(v)*dx)
+    c = Preconditioner(a, type="bddc")
+    a.Assemble()
+    u = GridFunction(fes)
+    exact = 16*x*(1-x)*y*(1-y)
+    inv = solver(mat=a.mat, pre=c, s=s, maxiter=200)
+    u.vec.data = inv * f.vec
+    error = sqrt(Integrate((u-exact)*(u-exact), mesh))
+    print(solver.name, ": iterations = ", inv.iterations)
+    assert error < 1e-10
+
+
+
+@pytest.mark.parametrize("flags", [{"supernodal" : True},
+                                   {"ordering" : "nesteddissection", "ndleafsize" : 16},
+                                   {"ordering" : "nesteddissection", "supernodal" : True},
+                                   {"singleprecision" : True},
+                                   {"singleprecision" : True, "supernodal" : True},
+                                   {"memorybudget" : 1000},
+                                   {"memorybudget" : 1000, "singleprecision" : True}])
+def test_sparsecholesky_flags(flags):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3, dirichlet=".*")
+    u,v = fes.TnT()
+    a = BilinearForm(grad(u)*grad(v)*dx+u*v*dx).Assemble()
+    f = LinearForm(x*v*dx).Assemble()
+    gfu = GridFunction(fes)
+    gfu.vec.data = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky") * f.vec
+    inv = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky", flags=flags)
+    w = gfu.vec.CreateVector()
+    w.data = inv * f.vec
+    w.data -= gfu.vec
+    assert Norm(w) < 1e-10 * Norm(gfu.vec)
+
+def test_sparsecholesky_singleprecision_not_converged():
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3, dirichlet=".*")
+    u,v = fes.TnT()
+    a = BilinearForm(grad(u)*grad(v)*dx+u*v*dx).Assemble()
+    f = LinearForm(x*v*dx).Assemble()
+    # a single float solve can not reach the tolerance
+    inv = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky",
+                        flags={"singleprecision" : True, "refinementsteps" : 0})
+    w = f.vec.CreateVector()
+    with pytest.raises(Exception, match="not converged"):
+        w.data = inv * f.vec
+
+@pytest.mark.parametrize("flags", [{}, {"supernodal":True}])
+def test_sparsecholesky_multivector(flags):
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3, dirichlet=".*")
+    u,v = fes.TnT()
+    a = BilinearForm(grad(u)*grad(v)*dx+u*v*dx).Assemble()
+    inv = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky", flags=flags)
+    gfu = GridFunction(fes)
+    rhs = MultiVector(gfu.vec, 5)
+    for i in range(5):
+        rhs[i].FV().NumPy()[:] = [(j*(i+1))%7 for j in range(fes.ndof)]
+    sol = MultiVector(gfu.vec, 5)
+    sol[:] = inv * rhs
+    for i in range(5):
+        gfu.vec.data = inv * rhs[i]
+        gfu.vec.data -= sol[i]
+        assert Norm(gfu.vec) < 1e-10 * Norm(sol[i])
+
+def test_sparsecholesky_symbolic_reuse():
+    def count(name):
+        return sum(t["counts"] for t in Timers() if t["name"] == name)
+    def solve(a, f, fes, cache):
+        nsymbolic = count("SparseCholesky - symbolic")
+        nreuse = count("SparseCholesky - reuse symbolic")
+        flags = {"symboliccache":True} if cache else {}
+        gfu = GridFunction(fes)
+        gfu.vec.data = a.mat.Inverse(fes.FreeDofs(), inverse="sparsecholesky", flags=flags) * f.vec
+        return gfu, count("SparseCholesky - symbolic")-nsymbolic, count("SparseCholesky - reuse symbolic")-nreuse
+
+    ngsolve.la.ClearSparseCholeskySymbolicCache()
+    mesh = Mesh(unit_square.GenerateMesh(maxh=0.1))
+    fes = H1(mesh, order=3, dirichlet=".*")
+    u,v = fes.TnT()
+    f = LinearForm(x*v*dx).Assemble()
+    for i, c in enumerate([1, 10, 100]):
+        a = BilinearForm(grad(u)*grad(v)*dx+c*u*v*dx).Assemble()
+        ref, nsymbolic, nreuse = solve(a, f, fes, cache=False)
+        # the cache is opt-in
+        assert (nsymbolic, nreuse) == (1, 0)
+        gfu, nsymbolic, nreuse = solve(a, f, fes, cache=True)
+        # the first factorization computes the ordering, the others reuse it
+        assert (nsymbolic, nreuse) == ((1, 0) if i == 0 else (0, 1))
+        gfu.vec.data -= ref.vec
+        assert Norm(gfu.vec) < 1e-10 * Norm(ref.vec)
+    # a different pattern must not pick up the cached ordering
+    fes = H1(mesh, order=2, dirichlet=".*")
+    u,v = fes.TnT()
+    a = BilinearForm(grad(u)*grad(v)*dx+u*v*dx).Assemble()
+    f = LinearForm(x*v*dx).Assemble()
+    ref, _, _ = solve(a, f, fes, cache=False)
+    gfu, nsymbolic, nreuse = solve(a, f, fes, cache=True)
+    assert (nsymbolic, nreuse) == (1, 0)
+    gfu.vec.data -= ref.vec
+    assert Norm(gfu.vec) < 1e-10 * Norm(ref.vec)
+    ngsolve.la.ClearSparseCholeskySymbolicCache()
 
 
 if __name__ == "__main__":
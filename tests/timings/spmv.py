@@ -0,0 +1,54 @@
+# compare sparse matrix-vector products in CSR and SELL-C-sigma format
+from netgen.csg import unit_cube
+from ngsolve import *
+from ngsolve.la import SparseMatrixSELL
+import time
+
+import argparse
+parser = argparse.ArgumentParser(description='Time sparse matrix-vector products')
+parser.add_argument('-n', '--nmult', type=int, default=100, help='number of products per matrix')
+parser.add_argument('-t', '--threads', type=int, default=0, help='number of threads (0 = all)')
+args = parser.parse_args()
+
+ngsglobals.msg_level=0
+mesh = Mesh(unit_cube.GenerateMesh(maxh=0.2))
+
+def TimeMult(mat, x, y):
+    y.data = mat * x
+    start = time.time()
+    for i in range(args.nmult):
+        y.data = mat * x
+    return (time.time()-start) / args.nmult
+
+def Benchmark(name, fes, form):
+    a = BilinearForm(form).Assemble()
+    sell = SparseMatrixSELL(a.mat)
+    x = a.mat.CreateColVector()
+    y = a.mat.CreateColVector()
+    x.SetRandom()
+    t_csr = TimeMult(a.mat, x, y)
+    t_sell = TimeMult(sell, x, y)
+    print ("{:12s} ndof = {:8d}, nze = {:10d}, fill = {:.2f}, CSR {:.3e} s, SELL {:.3e} s, speedup {:.2f}"
+           .format(name, fes.ndof, a.mat.nze, sell.fillratio, t_csr, t_sell, t_csr/t_sell))
+
+def RunAll():
+    for order in [1,2,4]:
+        fes = H1(mesh, order=order)
+        u,v = fes.TnT()
+        Benchmark("H1 p="+str(order), fes, grad(u)*grad(v)*dx)
+
+    for order in [1,2,3]:
+        fes = L2(mesh, order=order, dgjumps=True)
+        u,v = fes.TnT()
+        Benchmark("L2-DG p="+str(order), fes, u*v*dx + (u-u.Other())*(v-v.Other())*dx(skeleton=True))
+
+        V = L2(mesh, order=order)
+        F = FacetFESpace(mesh, order=order)
+        fes = V*F
+        (u,uhat),(v,vhat) = fes.TnT()
+        Benchmark("HDG p="+str(order), fes, (u-uhat)*(v-vhat)*dx(element_boundary=True))
+
+if args.threads:
+    SetNumThreads(args.threads)
+with TaskManager():
+    RunAll()